@@ -127,6 +127,9 @@ usage( void )
 	fprintf( stderr, _("  -E [!]<ext>[=<extparam>] search extensions (! indicates criticality)\n"));
 	fprintf( stderr, _("             [!]domainScope              (domain scope)\n"));
 	fprintf( stderr, _("             !dontUseCopy                (Don't Use Copy)\n"));
+#ifdef LDAP_CONTROL_X_EXPLAIN
+	fprintf( stderr, _("             [!]explain                  (candidate selection plan)\n"));
+#endif
 	fprintf( stderr, _("             [!]mv=<filter>              (RFC 3876 matched values filter)\n"));
 	fprintf( stderr, _("             [!]pr=<size>[/prompt|noprompt] (RFC 2696 paged results/prompt)\n"));
 	fprintf( stderr, _("             [!]sss=[-]<attr[:OID]>[/[-]<attr[:OID]>...]\n"));
@@ -210,6 +213,10 @@ static int dontUseCopy = 0;
 
 static int domainScope = 0;
 
+#ifdef LDAP_CONTROL_X_EXPLAIN
+static int explain = 0;
+#endif
+
 static int sss = 0;
 static LDAPSortKey **sss_keys = NULL;
 
@@ -465,6 +472,22 @@ handle_private_option( int i )
 
 			domainScope = 1 + crit;
 
+#ifdef LDAP_CONTROL_X_EXPLAIN
+		} else if ( strcasecmp( control, "explain" ) == 0 ) {
+			if( explain ) {
+				fprintf( stderr,
+					_("explain control previously specified\n"));
+				exit( EXIT_FAILURE );
+			}
+			if( cvalue != NULL ) {
+				fprintf( stderr,
+			         _("explain: no control value expected\n") );
+				usage();
+			}
+
+			explain = 1 + crit;
+#endif
+
 		} else if ( strcasecmp( control, "sss" ) == 0 ) {
 			char *keyp;
 			if( sss ) {
@@ -922,6 +945,9 @@ getNextPage:
 		|| derefcrit
 #endif
 		|| domainScope
+#ifdef LDAP_CONTROL_X_EXPLAIN
+		|| explain
+#endif
 		|| pagedResults
 		|| ldapsync
 		|| sss
@@ -956,6 +982,20 @@ getNextPage:
 			i++;
 		}
 
+#ifdef LDAP_CONTROL_X_EXPLAIN
+		if ( explain ) {
+			if ( ctrl_add() ) {
+				tool_exit( ld, EXIT_FAILURE );
+			}
+
+			c[i].ldctl_oid = LDAP_CONTROL_X_EXPLAIN;
+			c[i].ldctl_value.bv_val = NULL;
+			c[i].ldctl_value.bv_len = 0;
+			c[i].ldctl_iscritical = explain > 1;
+			i++;
+		}
+#endif
+
 		if ( subentries ) {
 			if ( ctrl_add() ) {
 				tool_exit( ld, EXIT_FAILURE );
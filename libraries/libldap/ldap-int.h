@@ -152,6 +152,8 @@ struct ldapmsg {
 	struct ldapmsg	*lm_chain;	/* for search - next msg in the resp */
 	struct ldapmsg	*lm_chain_tail;
 	struct ldapmsg	*lm_next;	/* next response */
+	struct ldapmsg	*lm_prev;	/* previous response */
+	struct ldapmsg	*lm_hnext;	/* next response in msgid hash bucket */
 	time_t	lm_time;	/* used to maintain cache */
 };
 
@@ -364,6 +366,7 @@ typedef struct ldapreq {
 	struct ldapreq	*lr_refnext;	/* next referral spawned */
 	struct ldapreq	*lr_prev;	/* previous request */
 	struct ldapreq	*lr_next;	/* next request */
+	struct ldapreq	*lr_hnext;	/* next request in msgid hash bucket */
 } LDAPRequest;
 
 /*
@@ -414,6 +417,25 @@ struct ldap_common {
 #define	ld_requests		ldc->ldc_requests
 #define	ld_responses		ldc->ldc_responses
 
+	/* msgid indexes of the above lists; the table size is always
+	 * a power of two, msgids are handed out sequentially so the
+	 * low bits make a perfectly good hash */
+	/* protected by req_mutex */
+	LDAPRequest	**ldc_req_hash;
+	unsigned	ldc_req_hmask;
+	unsigned	ldc_req_count;
+	/* protected by res_mutex */
+	LDAPMessage	**ldc_res_hash;
+	unsigned	ldc_res_hmask;
+	unsigned	ldc_res_count;
+#define	ld_req_hash		ldc->ldc_req_hash
+#define	ld_req_hmask		ldc->ldc_req_hmask
+#define	ld_req_count		ldc->ldc_req_count
+#define	ld_res_hash		ldc->ldc_res_hash
+#define	ld_res_hmask		ldc->ldc_res_hmask
+#define	ld_res_count		ldc->ldc_res_count
+#define	LDAP_MSGID_HASH_MIN	16
+
 	/* protected by abandon_mutex */
 	ber_len_t	ldc_nabandoned;
 	ber_int_t	*ldc_abandoned;	/* array of abandoned requests */
@@ -475,6 +497,12 @@ struct ldap_common {
 	ldap_pvt_thread_mutex_t	ldc_req_mutex;
 	ldap_pvt_thread_mutex_t	ldc_res_mutex;
 	ldap_pvt_thread_mutex_t	ldc_abandon_mutex;
+	/* protected by res_mutex: only one thread at a time reads
+	 * from the connections, the others wait on res_cond for it
+	 * to queue their responses */
+	ldap_pvt_thread_cond_t	ldc_res_cond;
+	int			ldc_res_reading;
+	int			ldc_res_waiters;
 #define	ld_ldopts_mutex		ld_options.ldo_mutex
 #define	ld_ldcmutex		ldc->ldc_mutex
 #define	ld_msgid_mutex		ldc->ldc_msgid_mutex
@@ -482,6 +510,9 @@ struct ldap_common {
 #define	ld_req_mutex		ldc->ldc_req_mutex
 #define	ld_res_mutex		ldc->ldc_res_mutex
 #define	ld_abandon_mutex	ldc->ldc_abandon_mutex
+#define	ld_res_cond		ldc->ldc_res_cond
+#define	ld_res_reading		ldc->ldc_res_reading
+#define	ld_res_waiters		ldc->ldc_res_waiters
 #endif
 };
 
@@ -711,6 +742,11 @@ LDAP_F (char *) ldap_host_connected_to( Sockbuf *sb,
 #endif
 
 LDAP_F (int) ldap_int_select( LDAP *ld, struct timeval *timeout );
+#ifdef LDAP_R_COMPILE
+LDAP_F (void *) ldap_int_select_copy( LDAP *ld );
+LDAP_F (int) ldap_int_select_wait( void *copy, struct timeval *timeout );
+LDAP_F (int) ldap_int_select_merge( LDAP *ld, void *copy );
+#endif
 LDAP_F (void *) ldap_new_select_info( void );
 LDAP_F (void) ldap_free_select_info( void *sip );
 LDAP_F (void) ldap_mark_select_write( LDAP *ld, Sockbuf *sb );
@@ -744,6 +780,7 @@ LDAP_F (int) ldap_send_server_request( LDAP *ld, BerElement *ber,
 	LDAPConn *lc, LDAPreqinfo *bind, int noconn, int m_res );
 LDAP_F (LDAPConn *) ldap_new_connection( LDAP *ld, LDAPURLDesc **srvlist,
 	int use_ldsb, int connect, LDAPreqinfo *bind, int m_req, int m_res );
+LDAP_F (void) ldap_int_link_request( LDAP *ld, LDAPRequest *lr );
 LDAP_F (LDAPRequest *) ldap_find_request_by_msgid( LDAP *ld, ber_int_t msgid );
 LDAP_F (void) ldap_return_request( LDAP *ld, LDAPRequest *lr, int freeit );
 LDAP_F (void) ldap_free_request( LDAP *ld, LDAPRequest *lr );
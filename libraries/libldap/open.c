@@ -206,6 +206,13 @@ ldap_create( LDAP **ldp )
 
 	if (( ld->ld_selectinfo = ldap_new_select_info()) == NULL ) goto nomem;
 
+	ld->ld_req_hash = LDAP_CALLOC( LDAP_MSGID_HASH_MIN, sizeof( LDAPRequest * ) );
+	if ( ld->ld_req_hash == NULL ) goto nomem;
+	ld->ld_req_hmask = LDAP_MSGID_HASH_MIN - 1;
+	ld->ld_res_hash = LDAP_CALLOC( LDAP_MSGID_HASH_MIN, sizeof( LDAPMessage * ) );
+	if ( ld->ld_res_hash == NULL ) goto nomem;
+	ld->ld_res_hmask = LDAP_MSGID_HASH_MIN - 1;
+
 	ld->ld_lberoptions = LBER_USE_DER;
 
 	ld->ld_sb = ber_sockbuf_alloc( );
@@ -218,12 +225,15 @@ ldap_create( LDAP **ldp )
 	ldap_pvt_thread_mutex_init( &ld->ld_res_mutex );
 	ldap_pvt_thread_mutex_init( &ld->ld_abandon_mutex );
 	ldap_pvt_thread_mutex_init( &ld->ld_ldcmutex );
+	ldap_pvt_thread_cond_init( &ld->ld_res_cond );
 #endif
 	ld->ld_ldcrefcnt = 1;
 	*ldp = ld;
 	return LDAP_SUCCESS;
 
 nomem:
+	LDAP_FREE( ld->ld_req_hash );
+	LDAP_FREE( ld->ld_res_hash );
 	ldap_free_select_info( ld->ld_selectinfo );
 	ldap_free_urllist( ld->ld_options.ldo_defludp );
 #ifdef HAVE_CYRUS_SASL
@@ -563,8 +573,9 @@ ldap_open_internal_connection( LDAP **ldp, ber_socket_t *fdp )
 	lr->lr_msgid = 0;
 	lr->lr_status = LDAP_REQST_INPROGRESS;
 	lr->lr_res_errno = LDAP_SUCCESS;
-	/* no mutex lock needed, we just created this ld here */
-	ld->ld_requests = lr;
+	LDAP_MUTEX_LOCK( &ld->ld_req_mutex );
+	ldap_int_link_request( ld, lr );
+	LDAP_MUTEX_UNLOCK( &ld->ld_req_mutex );
 
 	LDAP_MUTEX_LOCK( &ld->ld_conn_mutex );
 	/* Attach the passed socket as the *LDAP's connection */
@@ -846,6 +846,10 @@ ldap_host_connected_to( Sockbuf *sb, const char *host )
 
 
 struct selectinfo {
+#ifdef LDAP_R_COMPILE
+	/* bumped whenever a descriptor is removed from the set */
+	unsigned si_gen;
+#endif
 #ifdef HAVE_POLL
 	/* for UNIX poll(2) */
 	int si_maxfd;
@@ -959,6 +963,10 @@ ldap_mark_select_clear( LDAP *ld, Sockbuf *sb )
 
 	ber_sockbuf_ctrl( sb, LBER_SB_OPT_GET_FD, &sd );
 
+#ifdef LDAP_R_COMPILE
+	sip->si_gen++;
+#endif
+
 #ifdef HAVE_POLL
 	/* for UNIX poll(2) */
 	{
@@ -1118,21 +1126,15 @@ ldap_int_ip_init( void )
 #endif
 
 
-int
-ldap_int_select( LDAP *ld, struct timeval *timeout )
+static int
+ldap_int_select_sip( struct selectinfo *sip, struct timeval *timeout )
 {
 	int rc;
-	struct selectinfo	*sip;
-
-	Debug( LDAP_DEBUG_TRACE, "ldap_int_select\n", 0, 0, 0 );
 
 #ifndef HAVE_POLL
 	if ( ldap_int_tblsize == 0 ) ldap_int_ip_init();
 #endif
 
-	sip = (struct selectinfo *)ld->ld_selectinfo;
-	assert( sip != NULL );
-
 #ifdef HAVE_POLL
 	{
 		int to = timeout ? TV2MILLISEC( timeout ) : INFTIM;
@@ -1149,3 +1151,99 @@ ldap_int_select( LDAP *ld, struct timeval *timeout )
 
 	return rc;
 }
+
+int
+ldap_int_select( LDAP *ld, struct timeval *timeout )
+{
+	struct selectinfo	*sip;
+
+	Debug( LDAP_DEBUG_TRACE, "ldap_int_select\n", 0, 0, 0 );
+
+	sip = (struct selectinfo *)ld->ld_selectinfo;
+	assert( sip != NULL );
+
+	return ldap_int_select_sip( sip, timeout );
+}
+
+#ifdef LDAP_R_COMPILE
+/*
+ * Waiting on a private copy of the select set lets a thread release
+ * ld_conn_mutex for the duration of the wait, while other threads add
+ * and remove connections. ldap_int_select_copy() and
+ * ldap_int_select_merge() must be called with ld_conn_mutex held,
+ * ldap_int_select_wait() without.
+ */
+void *
+ldap_int_select_copy( LDAP *ld )
+{
+	struct selectinfo	*sip, *cp;
+	ber_len_t		len;
+
+	sip = (struct selectinfo *)ld->ld_selectinfo;
+	assert( sip != NULL );
+
+#ifdef HAVE_POLL
+	len = (char *)&sip->si_fds[sip->si_maxfd] - (char *)sip;
+#else
+	len = sizeof( struct selectinfo );
+#endif
+	cp = LDAP_MALLOC( len );
+	if ( cp != NULL ) {
+		AC_MEMCPY( cp, sip, len );
+	}
+
+	return cp;
+}
+
+int
+ldap_int_select_wait( void *copy, struct timeval *timeout )
+{
+	Debug( LDAP_DEBUG_TRACE, "ldap_int_select_wait\n", 0, 0, 0 );
+
+	return ldap_int_select_sip( (struct selectinfo *)copy, timeout );
+}
+
+/* Make the results of waiting on copy visible to ldap_is_read_ready()
+ * and ldap_is_write_ready(), and free it. If a descriptor was removed
+ * from the set meanwhile, its number may have been reused, so the
+ * results are dropped instead and 0 is returned.
+ */
+int
+ldap_int_select_merge( LDAP *ld, void *copy )
+{
+	struct selectinfo	*sip, *cp = copy;
+	int			rc;
+
+	sip = (struct selectinfo *)ld->ld_selectinfo;
+	rc = ( cp->si_gen == sip->si_gen );
+
+#ifdef HAVE_POLL
+	{
+		int i;
+
+		/* without removals, slots keep their descriptor; new ones
+		 * may only have been added to free slots or at the end */
+		for ( i = 0; i < sip->si_maxfd; i++ ) {
+			if ( rc && i < cp->si_maxfd &&
+				sip->si_fds[i].fd == cp->si_fds[i].fd )
+			{
+				sip->si_fds[i].revents = cp->si_fds[i].revents;
+			} else {
+				sip->si_fds[i].revents = 0;
+			}
+		}
+	}
+#else
+	if ( rc ) {
+		sip->si_use_readfds = cp->si_use_readfds;
+		sip->si_use_writefds = cp->si_use_writefds;
+	} else {
+		FD_ZERO( &sip->si_use_readfds );
+		FD_ZERO( &sip->si_use_writefds );
+	}
+#endif
+
+	LDAP_FREE( cp );
+	return rc;
+}
+#endif /* LDAP_R_COMPILE */
@@ -399,12 +399,7 @@ ldap_send_server_request(
 		}
 	}
 
-	lr->lr_prev = NULL;
-	lr->lr_next = ld->ld_requests;
-	if ( lr->lr_next != NULL ) {
-		lr->lr_next->lr_prev = lr;
-	}
-	ld->ld_requests = lr;
+	ldap_int_link_request( ld, lr );
 
 	ld->ld_errno = LDAP_SUCCESS;
 	if ( ldap_int_flush_request( ld, lr ) == -1 ) {
@@ -949,11 +944,82 @@ ldap_dump_requests_and_responses( LDAP *ld )
 }
 #endif /* LDAP_DEBUG */
 
+/* protected by req_mutex */
+static void
+ldap_req_hash_grow( LDAP *ld )
+{
+	LDAPRequest	**hash, *lr, *next;
+	unsigned	i, size, mask;
+
+	size = ( ld->ld_req_hmask + 1 ) << 1;
+	hash = LDAP_CALLOC( size, sizeof( LDAPRequest * ) );
+	if ( hash == NULL ) {
+		/* keep using the old table, just with longer chains */
+		return;
+	}
+	mask = size - 1;
+
+	for ( i = 0; i <= ld->ld_req_hmask; i++ ) {
+		for ( lr = ld->ld_req_hash[i]; lr != NULL; lr = next ) {
+			next = lr->lr_hnext;
+			lr->lr_hnext = hash[lr->lr_msgid & mask];
+			hash[lr->lr_msgid & mask] = lr;
+		}
+	}
+	LDAP_FREE( ld->ld_req_hash );
+	ld->ld_req_hash = hash;
+	ld->ld_req_hmask = mask;
+}
+
+/* protected by req_mutex */
+void
+ldap_int_link_request( LDAP *ld, LDAPRequest *lr )
+{
+	LDAPRequest	**lrp;
+
+	LDAP_ASSERT_MUTEX_OWNER( &ld->ld_req_mutex );
+
+	lr->lr_prev = NULL;
+	lr->lr_next = ld->ld_requests;
+	if ( lr->lr_next != NULL ) {
+		lr->lr_next->lr_prev = lr;
+	}
+	ld->ld_requests = lr;
+
+	if ( ld->ld_req_count > ld->ld_req_hmask ) {
+		ldap_req_hash_grow( ld );
+	}
+	lrp = &ld->ld_req_hash[lr->lr_msgid & ld->ld_req_hmask];
+	lr->lr_hnext = *lrp;
+	*lrp = lr;
+	ld->ld_req_count++;
+}
+
+/* protected by req_mutex */
+static void
+ldap_req_hash_delete( LDAP *ld, LDAPRequest *lr )
+{
+	LDAPRequest	**lrp;
+
+	for ( lrp = &ld->ld_req_hash[lr->lr_msgid & ld->ld_req_hmask];
+		*lrp != NULL; lrp = &(*lrp)->lr_hnext )
+	{
+		if ( *lrp == lr ) {
+			*lrp = lr->lr_hnext;
+			lr->lr_hnext = NULL;
+			ld->ld_req_count--;
+			break;
+		}
+	}
+}
+
 /* protected by req_mutex */
 static void
 ldap_free_request_int( LDAP *ld, LDAPRequest *lr )
 {
 	LDAP_ASSERT_MUTEX_OWNER( &ld->ld_req_mutex );
+
+	ldap_req_hash_delete( ld, lr );
 	/* if lr_refcnt > 0, the request has been looked up 
 	 * by ldap_find_request_by_msgid(); if in the meanwhile
 	 * the request is free()'d by someone else, just decrease
@@ -1656,12 +1722,15 @@ ldap_find_request_by_msgid( LDAP *ld, ber_int_t msgid )
 {
 	LDAPRequest	*lr;
 
-	for ( lr = ld->ld_requests; lr != NULL; lr = lr->lr_next ) {
-		if ( lr->lr_status == LDAP_REQST_COMPLETED ) {
-			continue;	/* Skip completed requests */
-		}
+	for ( lr = ld->ld_req_hash[msgid & ld->ld_req_hmask];
+		lr != NULL; lr = lr->lr_hnext )
+	{
 		if ( msgid == lr->lr_msgid ) {
-			lr->lr_refcnt++;
+			if ( lr->lr_status == LDAP_REQST_COMPLETED ) {
+				lr = NULL;	/* Skip completed requests */
+			} else {
+				lr->lr_refcnt++;
+			}
 			break;
 		}
 	}
@@ -1675,7 +1744,9 @@ ldap_return_request( LDAP *ld, LDAPRequest *lrx, int freeit )
 {
 	LDAPRequest	*lr;
 
-	for ( lr = ld->ld_requests; lr != NULL; lr = lr->lr_next ) {
+	for ( lr = ld->ld_req_hash[lrx->lr_msgid & ld->ld_req_hmask];
+		lr != NULL; lr = lr->lr_hnext )
+	{
 		if ( lr == lrx ) {
 			if ( lr->lr_refcnt > 0 ) {
 				lr->lr_refcnt--;
@@ -78,6 +78,12 @@ static LDAPMessage * chkResponseList LDAP_P(( LDAP *ld, int msgid, int all));
 
 #define LDAP_MSG_X_KEEP_LOOKING		(-2)
 
+#ifdef LDAP_R_COMPILE
+/* longest a reading thread stays in select() while other threads
+ * are waiting behind it, so they get a chance to check their timeouts */
+#define LDAP_RES_POLL_USEC		100000
+#endif
+
 
 /*
  * ldap_result - wait for an ldap result response to a message from the
@@ -123,6 +129,142 @@ ldap_result(
 	return rc;
 }
 
+/* protected by res_mutex */
+static void
+ldap_res_hash_grow( LDAP *ld )
+{
+	LDAPMessage	**hash, *lm, *next;
+	unsigned	i, size, mask;
+
+	size = ( ld->ld_res_hmask + 1 ) << 1;
+	hash = LDAP_CALLOC( size, sizeof( LDAPMessage * ) );
+	if ( hash == NULL ) {
+		/* keep using the old table, just with longer chains */
+		return;
+	}
+	mask = size - 1;
+
+	for ( i = 0; i <= ld->ld_res_hmask; i++ ) {
+		for ( lm = ld->ld_res_hash[i]; lm != NULL; lm = next ) {
+			next = lm->lm_hnext;
+			lm->lm_hnext = hash[lm->lm_msgid & mask];
+			hash[lm->lm_msgid & mask] = lm;
+		}
+	}
+	LDAP_FREE( ld->ld_res_hash );
+	ld->ld_res_hash = hash;
+	ld->ld_res_hmask = mask;
+}
+
+/* protected by res_mutex */
+static LDAPMessage *
+ldap_res_find( LDAP *ld, ber_int_t msgid )
+{
+	LDAPMessage	*lm;
+
+	for ( lm = ld->ld_res_hash[msgid & ld->ld_res_hmask];
+		lm != NULL; lm = lm->lm_hnext )
+	{
+		if ( lm->lm_msgid == msgid ) {
+			break;
+		}
+	}
+
+	return lm;
+}
+
+/* protected by res_mutex */
+static void
+ldap_res_link( LDAP *ld, LDAPMessage *lm )
+{
+	LDAPMessage	**lmp;
+
+	lm->lm_prev = NULL;
+	lm->lm_next = ld->ld_responses;
+	if ( lm->lm_next != NULL ) {
+		lm->lm_next->lm_prev = lm;
+	}
+	ld->ld_responses = lm;
+
+	if ( ld->ld_res_count > ld->ld_res_hmask ) {
+		ldap_res_hash_grow( ld );
+	}
+	lmp = &ld->ld_res_hash[lm->lm_msgid & ld->ld_res_hmask];
+	lm->lm_hnext = *lmp;
+	*lmp = lm;
+	ld->ld_res_count++;
+}
+
+/* protected by res_mutex; if nlm is not NULL, it takes the place
+ * of lm both in the list of responses and in the msgid index */
+static void
+ldap_res_unlink( LDAP *ld, LDAPMessage *lm, LDAPMessage *nlm )
+{
+	LDAPMessage	**lmp, *prev = lm->lm_prev, *next = lm->lm_next;
+
+	for ( lmp = &ld->ld_res_hash[lm->lm_msgid & ld->ld_res_hmask];
+		*lmp != lm; lmp = &(*lmp)->lm_hnext )
+	{
+		assert( *lmp != NULL );
+	}
+
+	if ( nlm != NULL ) {
+		nlm->lm_hnext = lm->lm_hnext;
+		*lmp = nlm;
+		nlm->lm_prev = prev;
+		nlm->lm_next = next;
+		if ( next != NULL ) {
+			next->lm_prev = nlm;
+		}
+
+	} else {
+		*lmp = lm->lm_hnext;
+		ld->ld_res_count--;
+		if ( next != NULL ) {
+			next->lm_prev = prev;
+		}
+		nlm = next;
+	}
+
+	if ( prev == NULL ) {
+		ld->ld_responses = nlm;
+	} else {
+		prev->lm_next = nlm;
+	}
+
+	lm->lm_next = NULL;
+	lm->lm_prev = NULL;
+	lm->lm_hnext = NULL;
+}
+
+/* protected by res_mutex */
+static void
+ldap_res_discard( LDAP *ld, LDAPMessage *lm )
+{
+	Debug( LDAP_DEBUG_ANY,
+		"response list msg abandoned, "
+		"msgid %d message type %s\n",
+		lm->lm_msgid, ldap_int_msgtype2str( lm->lm_msgtype ), 0 );
+
+	switch ( lm->lm_msgtype ) {
+	case LDAP_RES_SEARCH_ENTRY:
+	case LDAP_RES_SEARCH_REFERENCE:
+	case LDAP_RES_INTERMEDIATE:
+		break;
+
+	default:
+		/* there's no need to keep the id
+		 * in the abandoned list any longer */
+		ldap_mark_abandoned( ld, lm->lm_msgid );
+		break;
+	}
+
+	/* Remove this entry from list */
+	ldap_res_unlink( ld, lm, NULL );
+
+	ldap_msgfree( lm );
+}
+
 /* protected by res_mutex */
 static LDAPMessage *
 chkResponseList(
@@ -130,8 +272,7 @@ chkResponseList(
 	int msgid,
 	int all)
 {
-	LDAPMessage	*lm, **lastlm, *nextlm;
-	int		cnt = 0;
+	LDAPMessage	*lm, *nextlm;
 
 	/*
 	 * Look through the list of responses we have received on
@@ -146,77 +287,53 @@ chkResponseList(
 		"ldap_chkResponseList ld %p msgid %d all %d\n",
 		(void *)ld, msgid, all );
 
-	lastlm = &ld->ld_responses;
-	for ( lm = ld->ld_responses; lm != NULL; lm = nextlm ) {
-		nextlm = lm->lm_next;
-		++cnt;
-
-		if ( ldap_abandoned( ld, lm->lm_msgid ) ) {
-			Debug( LDAP_DEBUG_ANY,
-				"response list msg abandoned, "
-				"msgid %d message type %s\n",
-				lm->lm_msgid, ldap_int_msgtype2str( lm->lm_msgtype ), 0 );
-
-			switch ( lm->lm_msgtype ) {
-			case LDAP_RES_SEARCH_ENTRY:
-			case LDAP_RES_SEARCH_REFERENCE:
-			case LDAP_RES_INTERMEDIATE:
-				break;
-
-			default:
-				/* there's no need to keep the id
-				 * in the abandoned list any longer */
-				ldap_mark_abandoned( ld, lm->lm_msgid );
-				break;
-			}
-
-			/* Remove this entry from list */
-			*lastlm = nextlm;
-
-			ldap_msgfree( lm );
-
-			continue;
+	if ( msgid != LDAP_RES_ANY ) {
+		/* a specific msgid (or the unsolicited ones, msgid 0):
+		 * straight to its bucket */
+		lm = ldap_res_find( ld, msgid );
+		if ( lm != NULL && ldap_abandoned( ld, lm->lm_msgid ) ) {
+			ldap_res_discard( ld, lm );
+			lm = NULL;
 		}
 
-		if ( msgid == LDAP_RES_ANY || lm->lm_msgid == msgid ) {
-			LDAPMessage	*tmp;
+	} else {
+		for ( lm = ld->ld_responses; lm != NULL; lm = nextlm ) {
+			nextlm = lm->lm_next;
 
-			if ( all == LDAP_MSG_ONE ||
-				all == LDAP_MSG_RECEIVED ||
-				msgid == LDAP_RES_UNSOLICITED )
-			{
+			if ( !ldap_abandoned( ld, lm->lm_msgid ) ) {
 				break;
 			}
+			ldap_res_discard( ld, lm );
+		}
+	}
 
-			tmp = lm->lm_chain_tail;
-			if ( tmp->lm_msgtype == LDAP_RES_SEARCH_ENTRY ||
-				tmp->lm_msgtype == LDAP_RES_SEARCH_REFERENCE ||
-				tmp->lm_msgtype == LDAP_RES_INTERMEDIATE )
-			{
-				tmp = NULL;
-			}
-
-			if ( tmp == NULL ) {
-				lm = NULL;
-			}
+	if ( lm != NULL && all != LDAP_MSG_ONE &&
+		all != LDAP_MSG_RECEIVED &&
+		msgid != LDAP_RES_UNSOLICITED )
+	{
+		LDAPMessage	*tmp = lm->lm_chain_tail;
 
-			break;
+		/* the whole chain was asked for, and it isn't complete yet */
+		if ( tmp->lm_msgtype == LDAP_RES_SEARCH_ENTRY ||
+			tmp->lm_msgtype == LDAP_RES_SEARCH_REFERENCE ||
+			tmp->lm_msgtype == LDAP_RES_INTERMEDIATE )
+		{
+			lm = NULL;
 		}
-		lastlm = &lm->lm_next;
 	}
 
 	if ( lm != NULL ) {
 		/* Found an entry, remove it from the list */
 		if ( all == LDAP_MSG_ONE && lm->lm_chain != NULL ) {
-			*lastlm = lm->lm_chain;
-			lm->lm_chain->lm_next = lm->lm_next;
-			lm->lm_chain->lm_chain_tail = ( lm->lm_chain_tail != lm ) ? lm->lm_chain_tail : lm->lm_chain;
+			LDAPMessage	*nlm = lm->lm_chain;
+
+			nlm->lm_chain_tail = ( lm->lm_chain_tail != lm ) ? lm->lm_chain_tail : nlm;
+			ldap_res_unlink( ld, lm, nlm );
 			lm->lm_chain = NULL;
 			lm->lm_chain_tail = NULL;
 		} else {
-			*lastlm = lm->lm_next;
+			ldap_res_unlink( ld, lm, NULL );
 		}
-		lm->lm_next = NULL;
 	}
 
 #ifdef LDAP_DEBUG
@@ -297,8 +414,23 @@ wait4msg(
 		if ( ( *result = chkResponseList( ld, msgid, all ) ) != NULL ) {
 			rc = (*result)->lm_msgtype;
 
+#ifdef LDAP_R_COMPILE
+		} else if ( ld->ld_res_reading ) {
+			/* another thread is reading from the connections;
+			 * wait for it to queue what it got, then look again */
+			ld->ld_res_waiters++;
+			ldap_pvt_thread_cond_wait( &ld->ld_res_cond, &ld->ld_res_mutex );
+			ld->ld_res_waiters--;
+#endif
+
 		} else {
 			int lc_ready = 0;
+			struct timeval	*stvp = tvp;
+#ifdef LDAP_R_COMPILE
+			struct timeval	ptv;
+
+			ld->ld_res_reading = 1;
+#endif
 
 			LDAP_MUTEX_LOCK( &ld->ld_conn_mutex );
 			for ( lc = ld->ld_conns; lc != NULL; lc = lc->lconn_next ) {
@@ -311,28 +443,75 @@ wait4msg(
 			}
 
 			if ( !lc_ready ) {
-				int err;
-				rc = ldap_int_select( ld, tvp );
-				if ( rc == -1 ) {
-					err = sock_errno();
+				int err = 0, stale = 0;
+#ifdef LDAP_R_COMPILE
+				/* Don't hold the locks across select(): other threads
+				 * may send requests, and pick up responses queued for
+				 * them, meanwhile. So wait on a copy of the select set,
+				 * which they are free to change. */
+				void *sel = ldap_int_select_copy( ld );
+
+				if ( sel != NULL ) {
+					/* Waiters with a timeout rely on us coming
+					 * back every now and then. */
+					if ( ld->ld_res_waiters && ( tvp == NULL ||
+						tvp->tv_sec > 0 ||
+						tvp->tv_usec > LDAP_RES_POLL_USEC ) )
+					{
+						ptv.tv_sec = 0;
+						ptv.tv_usec = LDAP_RES_POLL_USEC;
+						stvp = &ptv;
+					}
+					LDAP_MUTEX_UNLOCK( &ld->ld_conn_mutex );
+					LDAP_MUTEX_UNLOCK( &ld->ld_res_mutex );
+					rc = ldap_int_select_wait( sel, stvp );
+					if ( rc == -1 ) {
+						err = sock_errno();
+					}
+					LDAP_MUTEX_LOCK( &ld->ld_res_mutex );
+					LDAP_MUTEX_LOCK( &ld->ld_conn_mutex );
+					stale = !ldap_int_select_merge( ld, sel );
+				} else
+#endif
+				{
+					rc = ldap_int_select( ld, stvp );
+					if ( rc == -1 ) {
+						err = sock_errno();
+					}
+				}
 #ifdef LDAP_DEBUG
+				if ( rc == -1 ) {
 					Debug( LDAP_DEBUG_TRACE,
 						"ldap_int_select returned -1: errno %d\n",
 						err, 0, 0 );
-#endif
 				}
+#endif
+
+				if ( stale && rc > 0 ) {
+					/* a connection went away while we waited;
+					 * look at the current set again */
+					rc = LDAP_MSG_X_KEEP_LOOKING;
 
-				if ( rc == 0 || ( rc == -1 && (
+				} else if ( rc == 0 && stvp != tvp ) {
+					/* only the poll interval expired */
+					rc = LDAP_MSG_X_KEEP_LOOKING;
+
+				} else if ( rc == 0 || ( rc == -1 && (
 					!LDAP_BOOL_GET(&ld->ld_options, LDAP_BOOL_RESTART)
 						|| err != EINTR ) ) )
 				{
 					ld->ld_errno = (rc == -1 ? LDAP_SERVER_DOWN :
 						LDAP_TIMEOUT);
 					LDAP_MUTEX_UNLOCK( &ld->ld_conn_mutex );
+#ifdef LDAP_R_COMPILE
+					ld->ld_res_reading = 0;
+					if ( ld->ld_res_waiters ) {
+						ldap_pvt_thread_cond_broadcast( &ld->ld_res_cond );
+					}
+#endif
 					return( rc );
-				}
 
-				if ( rc == -1 ) {
+				} else if ( rc == -1 ) {
 					rc = LDAP_MSG_X_KEEP_LOOKING;	/* select interrupted: loop */
 
 				} else {
@@ -381,6 +560,14 @@ wait4msg(
 					rc = -1;
 			}
 			LDAP_MUTEX_UNLOCK( &ld->ld_conn_mutex );
+#ifdef LDAP_R_COMPILE
+			/* hand over to the next waiter, whatever we got
+			 * may have been queued for it */
+			ld->ld_res_reading = 0;
+			if ( ld->ld_res_waiters ) {
+				ldap_pvt_thread_cond_broadcast( &ld->ld_res_cond );
+			}
+#endif
 		}
 
 		if ( rc == LDAP_MSG_X_KEEP_LOOKING && tvp != NULL ) {
@@ -444,7 +631,7 @@ try_read1msg(
 	LDAPMessage **result )
 {
 	BerElement	*ber;
-	LDAPMessage	*newmsg, *l, *prev;
+	LDAPMessage	*newmsg, *l;
 	ber_int_t	id;
 	ber_tag_t	tag;
 	ber_len_t	len;
@@ -1027,8 +1214,7 @@ nextresp2:
 			}
 			/* set up response chain */
 			if ( tmp == NULL ) {
-				newmsg->lm_next = ld->ld_responses;
-				ld->ld_responses = newmsg;
+				ldap_res_link( ld, newmsg );
 				chain_head = newmsg;
 			} else {
 				tmp->lm_chain = newmsg;
@@ -1089,13 +1275,7 @@ nextresp2:
 	 * search response.
 	 */
 
-	prev = NULL;
-	for ( l = ld->ld_responses; l != NULL; l = l->lm_next ) {
-		if ( l->lm_msgid == newmsg->lm_msgid ) {
-			break;
-		}
-		prev = l;
-	}
+	l = ldap_res_find( ld, newmsg->lm_msgid );
 
 	/* not part of an existing search response */
 	if ( l == NULL ) {
@@ -1104,8 +1284,7 @@ nextresp2:
 			goto exit;
 		}
 
-		newmsg->lm_next = ld->ld_responses;
-		ld->ld_responses = newmsg;
+		ldap_res_link( ld, newmsg );
 		goto exit;
 	}
 
@@ -1118,11 +1297,7 @@ nextresp2:
 
 	/* return the whole chain if that's what we were looking for */
 	if ( foundit ) {
-		if ( prev == NULL ) {
-			ld->ld_responses = l->lm_next;
-		} else {
-			prev->lm_next = l->lm_next;
-		}
+		ldap_res_unlink( ld, l, NULL );
 		*result = l;
 	}
 
@@ -1294,7 +1469,7 @@ ldap_msgfree( LDAPMessage *lm )
 int
 ldap_msgdelete( LDAP *ld, int msgid )
 {
-	LDAPMessage	*lm, *prev;
+	LDAPMessage	*lm;
 	int		rc = 0;
 
 	assert( ld != NULL );
@@ -1303,23 +1478,12 @@ ldap_msgdelete( LDAP *ld, int msgid )
 		(void *)ld, msgid, 0 );
 
 	LDAP_MUTEX_LOCK( &ld->ld_res_mutex );
-	prev = NULL;
-	for ( lm = ld->ld_responses; lm != NULL; lm = lm->lm_next ) {
-		if ( lm->lm_msgid == msgid ) {
-			break;
-		}
-		prev = lm;
-	}
-
+	lm = ldap_res_find( ld, msgid );
 	if ( lm == NULL ) {
 		rc = -1;
 
 	} else {
-		if ( prev == NULL ) {
-			ld->ld_responses = lm->lm_next;
-		} else {
-			prev->lm_next = lm->lm_next;
-		}
+		ldap_res_unlink( ld, lm, NULL );
 	}
 	LDAP_MUTEX_UNLOCK( &ld->ld_res_mutex );
 	if ( lm ) {
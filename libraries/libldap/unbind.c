@@ -111,6 +111,8 @@ ldap_ld_free(
 	while ( ld->ld_requests != NULL ) {
 		ldap_free_request( ld, ld->ld_requests );
 	}
+	LDAP_FREE( ld->ld_req_hash );
+	ld->ld_req_hash = NULL;
 	LDAP_MUTEX_UNLOCK( &ld->ld_req_mutex );
 	LDAP_MUTEX_LOCK( &ld->ld_conn_mutex );
 
@@ -125,6 +127,9 @@ ldap_ld_free(
 		ldap_msgfree( lm );
 	}
 
+	LDAP_FREE( ld->ld_res_hash );
+	ld->ld_res_hash = NULL;
+
 	if ( ld->ld_abandoned != NULL ) {
 		LDAP_FREE( ld->ld_abandoned );
 		ld->ld_abandoned = NULL;
@@ -229,6 +234,7 @@ ldap_ld_free(
 	ldap_pvt_thread_mutex_destroy( &ld->ld_abandon_mutex );
 	ldap_pvt_thread_mutex_destroy( &ld->ld_ldopts_mutex );
 	ldap_pvt_thread_mutex_destroy( &ld->ld_ldcmutex );
+	ldap_pvt_thread_cond_destroy( &ld->ld_res_cond );
 #endif
 #ifndef NDEBUG
 	LDAP_TRASH(ld);
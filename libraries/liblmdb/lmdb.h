@@ -705,6 +705,69 @@ int  mdb_env_copy2(MDB_env *env, const char *path, unsigned int flags);
 	 */
 int  mdb_env_copyfd2(MDB_env *env, mdb_filehandle_t fd, unsigned int flags);
 
+	/** @brief Write an incremental copy of an LMDB environment to the
+	 *	specified path.
+	 *
+	 * Only the pages that differ from those of a previous copy are
+	 * written, along with the meta pages. Applying the result to that
+	 * copy with #mdb_env_apply_incr() turns it into a copy of the
+	 * environment as of this call.
+	 * @note This call can trigger significant file size growth if run in
+	 * parallel with write transactions, because it employs a read-only
+	 * transaction. See long-lived transactions under @ref caveats_sec.
+	 * @param[in] env An environment handle returned by #mdb_env_create(). It
+	 * must have already been opened successfully.
+	 * @param[in] path The file to write the incremental copy to. It must
+	 * not already exist.
+	 * @param[in] base An environment handle opened on the previous copy,
+	 * which must have been made by #mdb_env_copy() without compaction, or
+	 * brought up to date with #mdb_env_apply_incr(). It should be opened
+	 * with #MDB_RDONLY and #MDB_NOLOCK.
+	 * @return A non-zero error value on failure and 0 on success. Some
+	 * possible errors are:
+	 * <ul>
+	 *	<li>#MDB_INCOMPATIBLE - \b base has a different page size or is
+	 *		newer than \b env.
+	 * </ul>
+	 */
+int  mdb_env_copy_incr(MDB_env *env, const char *path, MDB_env *base);
+
+	/** @brief Write an incremental copy of an LMDB environment to the
+	 *	specified file descriptor.
+	 *
+	 * See #mdb_env_copy_incr() for details.
+	 * @param[in] env An environment handle returned by #mdb_env_create(). It
+	 * must have already been opened successfully.
+	 * @param[in] fd The filedescriptor to write the incremental copy to.
+	 * It must have already been opened for Write access.
+	 * @param[in] base An environment handle opened on the previous copy.
+	 * @return A non-zero error value on failure and 0 on success.
+	 */
+int  mdb_env_copyfd_incr(MDB_env *env, mdb_filehandle_t fd, MDB_env *base);
+
+	/** @brief Apply an incremental copy to a copy of an LMDB environment.
+	 *
+	 * The incremental copy must have been made against exactly the state
+	 * \b env is in. If this call fails after writing has begun the copy
+	 * is left unusable, so it should be applied to a scratch copy of the
+	 * backup rather than the only one. The environment should be closed
+	 * afterward, since its handle still describes the previous state.
+	 * @param[in] env An environment handle opened on the copy, with
+	 * #MDB_NOLOCK, by a process which has exclusive use of it. It must
+	 * not be opened with #MDB_RDONLY.
+	 * @param[in] fd The filedescriptor to read the incremental copy from.
+	 * It is read sequentially, so it may be a pipe.
+	 * @return A non-zero error value on failure and 0 on success. Some
+	 * possible errors are:
+	 * <ul>
+	 *	<li>#MDB_INVALID - the input is not a complete incremental copy.
+	 *	<li>#MDB_INCOMPATIBLE - the incremental copy was made against a
+	 *		different state of the environment.
+	 *	<li>EACCES - the environment is read-only or in use.
+	 * </ul>
+	 */
+int  mdb_env_apply_incr(MDB_env *env, mdb_filehandle_t fd);
+
 	/** @brief Return statistics about the LMDB environment.
 	 *
 	 * @param[in] env An environment handle returned by #mdb_env_create()
@@ -1286,6 +1286,7 @@ struct MDB_env {
 	unsigned int	*me_dbiseqs;	/**< array of dbi sequence numbers */
 	pthread_key_t	me_txkey;	/**< thread-key for readers */
 	txnid_t		me_pgoldest;	/**< ID of oldest reader last time we looked */
+	txnid_t		me_pgoldest_txn;	/**< write txn in which me_pgoldest was found */
 	MDB_pgstate	me_pgstate;		/**< state of old pages from freeDB */
 #	define		me_pglast	me_pgstate.mf_pglast
 #	define		me_pghead	me_pgstate.mf_pghead
@@ -2090,22 +2091,36 @@ done:
 	return rc;
 }
 
-/** Find oldest txnid still referenced. Expects txn->mt_txnid > 0. */
+/** Find oldest txnid still referenced. Expects txn->mt_txnid > 0.
+ *
+ *	Readers only ever start on the latest committed txn, so the
+ *	result of the previous scan is a lower bound for this one; once
+ *	a reader is found still pinned there the rest of the table
+ *	cannot lower it further. The result is remembered for the rest
+ *	of the write txn so that allocating many pages does not rescan
+ *	the reader table for each of them.
+ */
 static txnid_t
 mdb_find_oldest(MDB_txn *txn)
 {
+	MDB_env *env = txn->mt_env;
 	int i;
-	txnid_t mr, oldest = txn->mt_txnid - 1;
-	if (txn->mt_env->me_txns) {
-		MDB_reader *r = txn->mt_env->me_txns->mti_readers;
-		for (i = txn->mt_env->me_txns->mti_numreaders; --i >= 0; ) {
+	txnid_t mr, oldest = txn->mt_txnid - 1, floor = env->me_pgoldest;
+	if (env->me_txns) {
+		MDB_reader *r = env->me_txns->mti_readers;
+		for (i = env->me_txns->mti_numreaders; --i >= 0; ) {
 			if (r[i].mr_pid) {
 				mr = r[i].mr_txnid;
-				if (oldest > mr)
+				if (oldest > mr) {
 					oldest = mr;
+					if (mr <= floor)
+						break;
+				}
 			}
 		}
 	}
+	env->me_pgoldest = oldest;
+	env->me_pgoldest_txn = txn->mt_txnid;
 	return oldest;
 }
 
@@ -2166,7 +2181,8 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 	txnid_t oldest = 0, last;
 	MDB_cursor_op op;
 	MDB_cursor m2;
-	int found_old = 0;
+	/* The reader table was already scanned during this txn */
+	int found_old = env->me_pgoldest_txn == txn->mt_txnid;
 
 	/* If there are any loose pages, just use them */
 	if (num == 1 && txn->mt_loose_pgs) {
@@ -2227,7 +2243,6 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		if (oldest <= last) {
 			if (!found_old) {
 				oldest = mdb_find_oldest(txn);
-				env->me_pgoldest = oldest;
 				found_old = 1;
 			}
 			if (oldest <= last)
@@ -2243,7 +2258,6 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		if (oldest <= last) {
 			if (!found_old) {
 				oldest = mdb_find_oldest(txn);
-				env->me_pgoldest = oldest;
 				found_old = 1;
 			}
 			if (oldest <= last)
@@ -9548,6 +9562,382 @@ mdb_env_copy(MDB_env *env, const char *path)
 	return mdb_env_copy2(env, path, 0);
 }
 
+/** Header page of an incremental copy.
+ *	It is followed by the meta pages of the new state, then by any
+ *	number of index pages, each holding a count and that many page
+ *	numbers and followed by those pages. An index page with a count
+ *	of zero ends the copy.
+ */
+typedef struct MDB_incr {
+	uint32_t	mi_magic;		/**< #MDB_INCR_MAGIC */
+	uint32_t	mi_version;		/**< #MDB_INCR_VERSION */
+	uint32_t	mi_psize;		/**< page size of the environment */
+	uint32_t	mi_pad;
+	txnid_t		mi_base;		/**< txnid of the copy this applies to */
+	txnid_t		mi_txnid;		/**< txnid of the copy this produces */
+	pgno_t		mi_npages;		/**< size of the copy this produces */
+} MDB_incr;
+
+#define MDB_INCR_MAGIC		0xBEEFD1FF
+#define MDB_INCR_VERSION	1
+
+	/** Write a buffer to a sequential stream. */
+static int ESECT
+mdb_incr_write(HANDLE fd, const char *ptr, size_t wsize)
+{
+	int rc = MDB_SUCCESS;
+#ifdef _WIN32
+	DWORD len, w2;
+#else
+	ssize_t len;
+	size_t w2;
+#endif
+
+	while (wsize > 0) {
+		if (wsize > MAX_WRITE)
+			w2 = MAX_WRITE;
+		else
+			w2 = wsize;
+		DO_WRITE(rc, fd, ptr, w2, len);
+		if (!rc) {
+			rc = ErrCode();
+			break;
+		} else if (len > 0) {
+			rc = MDB_SUCCESS;
+			ptr += len;
+			wsize -= len;
+		} else {
+			rc = EIO;
+			break;
+		}
+	}
+	return rc;
+}
+
+	/** Read a buffer from a sequential stream. */
+static int ESECT
+mdb_incr_read(HANDLE fd, char *ptr, size_t rsize)
+{
+	size_t r2;
+#ifdef _WIN32
+	DWORD len;
+#else
+	ssize_t len;
+#endif
+
+	while (rsize > 0) {
+		r2 = rsize > MAX_WRITE ? MAX_WRITE : rsize;
+#ifdef _WIN32
+		if (!ReadFile(fd, ptr, r2, &len, NULL))
+			return ErrCode();
+#else
+		len = read(fd, ptr, r2);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return ErrCode();
+		}
+#endif
+		if (len == 0)		/* truncated input */
+			return MDB_INVALID;
+		ptr += len;
+		rsize -= len;
+	}
+	return MDB_SUCCESS;
+}
+
+	/** Write a buffer at the given position of a file. */
+static int ESECT
+mdb_incr_pwrite(HANDLE fd, const char *ptr, size_t wsize, size_t pos)
+{
+#ifdef _WIN32
+	DWORD len;
+	OVERLAPPED ov;
+	memset(&ov, 0, sizeof(ov));
+	ov.Offset = pos & 0xffffffff;
+	ov.OffsetHigh = pos >> 16 >> 16;
+	if (!WriteFile(fd, ptr, wsize, &len, &ov))
+		return ErrCode();
+	if (len != wsize)
+		return EIO;
+#else
+	ssize_t len;
+
+	while (wsize > 0) {
+		len = pwrite(fd, ptr, wsize, pos);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return ErrCode();
+		}
+		if (len == 0)
+			return EIO;
+		ptr += len;
+		wsize -= len;
+		pos += len;
+	}
+#endif
+	return MDB_SUCCESS;
+}
+
+	/** Write the pages listed in an index page, coalescing runs. */
+static int ESECT
+mdb_incr_flush(MDB_env *env, HANDLE fd, pgno_t *idx)
+{
+	size_t psize = env->me_psize;
+	pgno_t i, j, n = idx[0];
+	int rc;
+
+	memset(idx + n + 1, 0, psize - (n + 1) * sizeof(pgno_t));
+	rc = mdb_incr_write(fd, (char *)idx, psize);
+	for (i = 1; i <= n && !rc; i = j) {
+		for (j = i + 1; j <= n && idx[j] == idx[j-1] + 1; j++) ;
+		rc = mdb_incr_write(fd, env->me_map + idx[i] * psize,
+			(j - i) * psize);
+	}
+	return rc;
+}
+
+int ESECT
+mdb_env_copyfd_incr(MDB_env *env, HANDLE fd, MDB_env *base)
+{
+	MDB_txn *txn = NULL;
+	mdb_mutexref_t wmutex = NULL;
+	MDB_incr *hdr;
+	MDB_meta *bmeta;
+	pgno_t *idx, pg, npages, bpages, max;
+	size_t psize = env->me_psize, fsize = 0, bsize = 0;
+	char *buf = NULL;
+	int rc;
+
+	if (!base || !(base->me_flags & MDB_ENV_ACTIVE))
+		return EINVAL;
+	if (base->me_psize != psize)
+		return MDB_INCOMPATIBLE;
+
+	/* Pages of the base copy that can be compared */
+	bmeta = mdb_env_pick_meta(base);
+	if ((rc = mdb_fsize(base->me_fd, &bsize)))
+		return rc;
+	if (bsize > base->me_mapsize)
+		bsize = base->me_mapsize;
+	bpages = bmeta->mm_last_pg + 1;
+	if (bpages > bsize / psize)
+		bpages = bsize / psize;
+
+	/* Header page plus meta pages; the first page is later reused
+	 * for the index pages.
+	 */
+	bsize = psize * (1 + NUM_METAS);
+#ifdef _WIN32
+	buf = _aligned_malloc(bsize, env->me_os_psize);
+	if (buf == NULL)
+		return ERROR_NOT_ENOUGH_MEMORY;
+#elif defined(HAVE_MEMALIGN)
+	buf = memalign(env->me_os_psize, bsize);
+	if (buf == NULL)
+		return errno;
+#else
+	{
+		void *p;
+		if ((rc = posix_memalign(&p, env->me_os_psize, bsize)) != 0)
+			return rc;
+		buf = p;
+	}
+#endif
+	memset(buf, 0, bsize);
+
+	/* Do the lock/unlock of the reader mutex before starting the
+	 * write txn.  Otherwise other read txns could block writers.
+	 */
+	rc = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+	if (rc)
+		goto leave;
+
+	if (env->me_txns) {
+		/* We must start the actual read txn after blocking writers */
+		mdb_txn_end(txn, MDB_END_RESET_TMP);
+
+		/* Temporarily block writers until we snapshot the meta pages */
+		wmutex = env->me_wmutex;
+		if (LOCK_MUTEX(rc, env, wmutex))
+			goto leave;
+
+		rc = mdb_txn_renew0(txn);
+		if (rc) {
+			UNLOCK_MUTEX(wmutex);
+			goto leave;
+		}
+	}
+	memcpy(buf + psize, env->me_map, psize * NUM_METAS);
+	if (wmutex)
+		UNLOCK_MUTEX(wmutex);
+
+	if (bmeta->mm_txnid > txn->mt_txnid) {
+		rc = MDB_INCOMPATIBLE;
+		goto leave;
+	}
+
+	npages = txn->mt_next_pgno;
+	if ((rc = mdb_fsize(env->me_fd, &fsize)))
+		goto leave;
+	if (npages > fsize / psize)
+		npages = fsize / psize;
+
+	hdr = (MDB_incr *)buf;
+	hdr->mi_magic = MDB_INCR_MAGIC;
+	hdr->mi_version = MDB_INCR_VERSION;
+	hdr->mi_psize = psize;
+	hdr->mi_base = bmeta->mm_txnid;
+	hdr->mi_txnid = txn->mt_txnid;
+	hdr->mi_npages = npages;
+	if ((rc = mdb_incr_write(fd, buf, psize * (1 + NUM_METAS))))
+		goto leave;
+
+	/* Pages outside the base copy are always sent; the others only
+	 * when their contents changed.
+	 */
+	idx = (pgno_t *)buf;
+	idx[0] = 0;
+	max = psize / sizeof(pgno_t) - 1;
+	for (pg = NUM_METAS; pg < npages; pg++) {
+		if (pg < bpages && !memcmp(env->me_map + pg * psize,
+			base->me_map + pg * psize, psize))
+			continue;
+		idx[++idx[0]] = pg;
+		if (idx[0] == max) {
+			if ((rc = mdb_incr_flush(env, fd, idx)))
+				goto leave;
+			idx[0] = 0;
+		}
+	}
+	if (idx[0] && (rc = mdb_incr_flush(env, fd, idx)))
+		goto leave;
+	idx[0] = 0;
+	rc = mdb_incr_flush(env, fd, idx);
+
+leave:
+	mdb_txn_abort(txn);
+#ifdef _WIN32
+	_aligned_free(buf);
+#else
+	free(buf);
+#endif
+	return rc;
+}
+
+int ESECT
+mdb_env_copy_incr(MDB_env *env, const char *path, MDB_env *base)
+{
+	int rc;
+	MDB_name fname;
+	HANDLE newfd = INVALID_HANDLE_VALUE;
+
+	rc = mdb_fname_init(path, MDB_NOSUBDIR|MDB_NOLOCK, &fname);
+	if (rc == MDB_SUCCESS) {
+		rc = mdb_fopen(env, &fname, MDB_O_COPY, 0666, &newfd);
+		mdb_fname_destroy(fname);
+	}
+	if (rc == MDB_SUCCESS) {
+		rc = mdb_env_copyfd_incr(env, newfd, base);
+		if (close(newfd) < 0 && rc == MDB_SUCCESS)
+			rc = ErrCode();
+	}
+	return rc;
+}
+
+int ESECT
+mdb_env_apply_incr(MDB_env *env, HANDLE fd)
+{
+	MDB_incr hdr;
+	MDB_page *mp;
+	pgno_t *idx, i, j, n, max, last;
+	size_t psize = env->me_psize;
+	char *buf, *metas, *pages;
+	int rc;
+
+	if (!(env->me_flags & MDB_ENV_ACTIVE))
+		return EINVAL;
+	if ((env->me_flags & (MDB_RDONLY|MDB_NOLOCK)) != MDB_NOLOCK || env->me_txn)
+		return EACCES;
+
+	if ((rc = mdb_incr_read(fd, (char *)&hdr, sizeof(hdr))))
+		return rc;
+	if (hdr.mi_magic != MDB_INCR_MAGIC || hdr.mi_version != MDB_INCR_VERSION)
+		return MDB_INVALID;
+	if (hdr.mi_psize != psize ||
+		hdr.mi_base != mdb_env_pick_meta(env)->mm_txnid)
+		return MDB_INCOMPATIBLE;
+
+	/* The meta pages, one index page, and the pages it lists */
+	max = psize / sizeof(pgno_t) - 1;
+	buf = malloc(psize * (NUM_METAS + 1 + max));
+	if (!buf)
+		return ENOMEM;
+	metas = buf;
+	idx = (pgno_t *)(metas + psize * NUM_METAS);
+	pages = (char *)idx + psize;
+
+	/* rest of the header page */
+	rc = mdb_incr_read(fd, metas, psize - sizeof(hdr));
+	if (!rc)
+		rc = mdb_incr_read(fd, metas, psize * NUM_METAS);
+	if (rc)
+		goto leave;
+	for (i = 0; i < NUM_METAS; i++) {
+		mp = (MDB_page *)(metas + i * psize);
+		if (!F_ISSET(mp->mp_flags, P_META) ||
+			((MDB_meta *)METADATA(mp))->mm_magic != MDB_MAGIC) {
+			rc = MDB_INVALID;
+			goto leave;
+		}
+	}
+
+	/* Data pages first, so the new meta pages are only written
+	 * once everything they refer to is on disk.
+	 */
+	last = NUM_METAS - 1;
+	for (;;) {
+		if ((rc = mdb_incr_read(fd, (char *)idx, psize)))
+			goto leave;
+		n = idx[0];
+		if (!n)
+			break;
+		if (n > max) {
+			rc = MDB_INVALID;
+			goto leave;
+		}
+		for (i = 1; i <= n; i++) {
+			if (idx[i] <= last || idx[i] >= hdr.mi_npages) {
+				rc = MDB_INVALID;
+				goto leave;
+			}
+			last = idx[i];
+		}
+		if ((rc = mdb_incr_read(fd, pages, n * psize)))
+			goto leave;
+		for (i = 1; i <= n; i = j) {
+			for (j = i + 1; j <= n && idx[j] == idx[j-1] + 1; j++) ;
+			rc = mdb_incr_pwrite(env->me_fd, pages + (i - 1) * psize,
+				(j - i) * psize, idx[i] * psize);
+			if (rc)
+				goto leave;
+		}
+	}
+
+	if (MDB_FDATASYNC(env->me_fd)) {
+		rc = ErrCode();
+		goto leave;
+	}
+	rc = mdb_incr_pwrite(env->me_fd, metas, psize * NUM_METAS, 0);
+	if (!rc && MDB_FDATASYNC(env->me_fd))
+		rc = ErrCode();
+
+leave:
+	free(buf);
+	return rc;
+}
+
 int ESECT
 mdb_env_set_flags(MDB_env *env, unsigned int flag, int onoff)
 {
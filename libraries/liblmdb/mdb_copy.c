@@ -30,8 +30,8 @@ sighandle(int sig)
 int main(int argc,char * argv[])
 {
 	int rc;
-	MDB_env *env;
-	const char *progname = argv[0], *act;
+	MDB_env *env, *base = NULL;
+	const char *progname = argv[0], *act, *basepath = NULL;
 	unsigned flags = MDB_RDONLY;
 	unsigned cpflags = 0;
 
@@ -40,6 +40,10 @@ int main(int argc,char * argv[])
 			flags |= MDB_NOSUBDIR;
 		else if (argv[1][1] == 'c' && argv[1][2] == '\0')
 			cpflags |= MDB_CP_COMPACT;
+		else if (argv[1][1] == 'i' && argv[1][2] == '\0' && argc > 2) {
+			basepath = argv[2];
+			argc--, argv++;
+		}
 		else if (argv[1][1] == 'V' && argv[1][2] == '\0') {
 			printf("%s\n", MDB_VERSION_STRING);
 			exit(0);
@@ -47,8 +51,8 @@ int main(int argc,char * argv[])
 			argc = 0;
 	}
 
-	if (argc<2 || argc>3) {
-		fprintf(stderr, "usage: %s [-V] [-c] [-n] srcpath [dstpath]\n", progname);
+	if (argc<2 || argc>3 || (basepath && cpflags)) {
+		fprintf(stderr, "usage: %s [-V] [-c | -i basepath] [-n] srcpath [dstpath]\n", progname);
 		exit(EXIT_FAILURE);
 	}
 
@@ -66,7 +70,20 @@ int main(int argc,char * argv[])
 	if (rc == MDB_SUCCESS) {
 		rc = mdb_env_open(env, argv[1], flags, 0600);
 	}
-	if (rc == MDB_SUCCESS) {
+	if (rc == MDB_SUCCESS && basepath) {
+		act = "opening base copy";
+		rc = mdb_env_create(&base);
+		if (rc == MDB_SUCCESS)
+			rc = mdb_env_open(base, basepath,
+				(flags & MDB_NOSUBDIR) | MDB_RDONLY | MDB_NOLOCK, 0600);
+		if (rc == MDB_SUCCESS) {
+			act = "copying";
+			if (argc == 2)
+				rc = mdb_env_copyfd_incr(env, MDB_STDOUT, base);
+			else
+				rc = mdb_env_copy_incr(env, argv[2], base);
+		}
+	} else if (rc == MDB_SUCCESS) {
 		act = "copying";
 		if (argc == 2)
 			rc = mdb_env_copyfd2(env, MDB_STDOUT, cpflags);
@@ -76,6 +93,8 @@ int main(int argc,char * argv[])
 	if (rc)
 		fprintf(stderr, "%s: %s failed, error %d (%s)\n",
 			progname, act, rc, mdb_strerror(rc));
+	if (base)
+		mdb_env_close(base);
 	mdb_env_close(env);
 
 	return rc ? EXIT_FAILURE : EXIT_SUCCESS;
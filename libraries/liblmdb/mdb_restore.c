@@ -0,0 +1,113 @@
+/* mdb_restore.c - apply incremental copies to an LMDB backup */
+/*
+ * Copyright 2012-2018 Howard Chu, Symas Corp.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+#ifdef _WIN32
+#include <windows.h>
+#define	MDB_STDIN	GetStdHandle(STD_INPUT_HANDLE)
+#define	MDB_OPEN(path)	CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, \
+	NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL)
+#define	MDB_CLOSE(fd)	CloseHandle(fd)
+#define	MDB_BADFD	INVALID_HANDLE_VALUE
+#define	MDB_ERRNO	GetLastError()
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#define	MDB_STDIN	0
+#define	MDB_OPEN(path)	open(path, O_RDONLY)
+#define	MDB_CLOSE(fd)	close(fd)
+#define	MDB_BADFD	(-1)
+#define	MDB_ERRNO	errno
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include "lmdb.h"
+
+static void
+sighandle(int sig)
+{
+}
+
+int main(int argc,char * argv[])
+{
+	int i, rc;
+	MDB_env *env;
+	mdb_filehandle_t fd;
+	const char *progname = argv[0], *act;
+	unsigned flags = MDB_NOLOCK;
+
+	for (; argc > 1 && argv[1][0] == '-'; argc--, argv++) {
+		if (argv[1][1] == 'n' && argv[1][2] == '\0')
+			flags |= MDB_NOSUBDIR;
+		else if (argv[1][1] == 'V' && argv[1][2] == '\0') {
+			printf("%s\n", MDB_VERSION_STRING);
+			exit(0);
+		} else
+			argc = 0;
+	}
+
+	if (argc<2) {
+		fprintf(stderr, "usage: %s [-V] [-n] dstpath [incrfile ...]\n", progname);
+		exit(EXIT_FAILURE);
+	}
+
+#ifdef SIGPIPE
+	signal(SIGPIPE, sighandle);
+#endif
+#ifdef SIGHUP
+	signal(SIGHUP, sighandle);
+#endif
+	signal(SIGINT, sighandle);
+	signal(SIGTERM, sighandle);
+
+	act = "opening environment";
+	rc = mdb_env_create(&env);
+	if (rc == MDB_SUCCESS) {
+		rc = mdb_env_open(env, argv[1], flags, 0600);
+	}
+	if (rc == MDB_SUCCESS) {
+		act = "applying";
+		if (argc == 2) {
+			rc = mdb_env_apply_incr(env, MDB_STDIN);
+		} else for (i = 2; i < argc && rc == MDB_SUCCESS; i++) {
+			/* Each increment moves the copy on to a new txn, so
+			 * the environment is reopened to pick up its meta page.
+			 */
+			if (i > 2) {
+				mdb_env_close(env);
+				env = NULL;
+				act = "opening environment";
+				rc = mdb_env_create(&env);
+				if (rc == MDB_SUCCESS)
+					rc = mdb_env_open(env, argv[1], flags, 0600);
+				if (rc)
+					break;
+			}
+			act = argv[i];
+			fd = MDB_OPEN(argv[i]);
+			if (fd == MDB_BADFD) {
+				rc = MDB_ERRNO;
+				break;
+			}
+			rc = mdb_env_apply_incr(env, fd);
+			MDB_CLOSE(fd);
+		}
+	}
+	if (rc)
+		fprintf(stderr, "%s: %s failed, error %d (%s)\n",
+			progname, act, rc, mdb_strerror(rc));
+	mdb_env_close(env);
+
+	return rc ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/* mtest7.c - memory-mapped database tester/toy */
+/*
+ * Copyright 2011-2018 Howard Chu, Symas Corp.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* Tests for incremental copies */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "lmdb.h"
+
+#define E(expr) CHECK((rc = (expr)) == MDB_SUCCESS, #expr)
+#define RES(err, expr) ((rc = expr) == (err) || (CHECK(!rc, #expr), 0))
+#define CHECK(test, msg) ((test) ? (void)0 : ((void)fprintf(stderr, \
+	"%s:%d: %s: %s\n", __FILE__, __LINE__, msg, mdb_strerror(rc)), abort()))
+
+#define	DBPATH	"./testdb/data.mdb"
+#define	BASE	"./testdb/base.mdb"
+#define	INCR	"./testdb/incr"
+#define	NOSUB	(MDB_NOSUBDIR|MDB_NOLOCK)
+
+static void
+update(MDB_env *env, int count, int del)
+{
+	int i, rc;
+	MDB_dbi dbi;
+	MDB_txn *txn;
+	MDB_val key, data;
+	char kval[32], sval[32];
+
+	E(mdb_txn_begin(env, NULL, 0, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	for (i = 0; i < count; i++) {
+		int k = rand() % (count * 4);
+		sprintf(kval, "%08x", k);
+		key.mv_size = sizeof(kval);
+		key.mv_data = kval;
+		if (del && i % 3 == 0) {
+			RES(MDB_NOTFOUND, mdb_del(txn, dbi, &key, NULL));
+			continue;
+		}
+		sprintf(sval, "%03x %d foo bar", k, i);
+		data.mv_size = sizeof(sval);
+		data.mv_data = sval;
+		E(mdb_put(txn, dbi, &key, &data, 0));
+	}
+	E(mdb_txn_commit(txn));
+}
+
+/* Check that two environments hold the same records */
+static void
+compare(MDB_env *e1, MDB_env *e2)
+{
+	int rc, rc2, n = 0;
+	MDB_dbi d1, d2;
+	MDB_txn *t1, *t2;
+	MDB_cursor *c1, *c2;
+	MDB_val k1, v1, k2, v2;
+
+	E(mdb_txn_begin(e1, NULL, MDB_RDONLY, &t1));
+	E(mdb_txn_begin(e2, NULL, MDB_RDONLY, &t2));
+	E(mdb_dbi_open(t1, NULL, 0, &d1));
+	E(mdb_dbi_open(t2, NULL, 0, &d2));
+	E(mdb_cursor_open(t1, d1, &c1));
+	E(mdb_cursor_open(t2, d2, &c2));
+	for (;;) {
+		rc = mdb_cursor_get(c1, &k1, &v1, MDB_NEXT);
+		rc2 = mdb_cursor_get(c2, &k2, &v2, MDB_NEXT);
+		CHECK(rc == rc2, "record count differs");
+		if (rc == MDB_NOTFOUND)
+			break;
+		CHECK(rc == MDB_SUCCESS, "mdb_cursor_get");
+		CHECK(k1.mv_size == k2.mv_size && v1.mv_size == v2.mv_size &&
+			!memcmp(k1.mv_data, k2.mv_data, k1.mv_size) &&
+			!memcmp(v1.mv_data, v2.mv_data, v1.mv_size), "record differs");
+		n++;
+	}
+	mdb_cursor_close(c1);
+	mdb_cursor_close(c2);
+	mdb_txn_abort(t1);
+	mdb_txn_abort(t2);
+	printf("%d records match\n", n);
+}
+
+static void
+apply(const char *incr)
+{
+	int rc, fd;
+	MDB_env *copy;
+
+	E(mdb_env_create(&copy));
+	E(mdb_env_open(copy, BASE, NOSUB, 0664));
+	fd = open(incr, O_RDONLY);
+	CHECK(fd >= 0, incr);
+	E(mdb_env_apply_incr(copy, fd));
+	close(fd);
+	mdb_env_close(copy);
+}
+
+int main(int argc,char * argv[])
+{
+	int rc;
+	MDB_env *env, *base;
+	struct stat st, sb;
+
+	srand(time(NULL));
+
+	unlink(BASE);
+	unlink(INCR);
+	unlink(INCR "2");
+	E(mdb_env_create(&env));
+	E(mdb_env_set_mapsize(env, 10485760));
+	E(mdb_env_open(env, DBPATH, MDB_NOSUBDIR, 0664));
+
+	update(env, 5000, 0);
+	E(mdb_env_copy(env, BASE));
+
+	/* One increment, checked against a fresh full copy */
+	update(env, 500, 1);
+	E(mdb_env_create(&base));
+	E(mdb_env_open(base, BASE, NOSUB|MDB_RDONLY, 0664));
+	E(mdb_env_copy_incr(env, INCR, base));
+	mdb_env_close(base);
+
+	stat(DBPATH, &st);
+	stat(INCR, &sb);
+	printf("data file %ld bytes, increment %ld bytes\n",
+		(long)st.st_size, (long)sb.st_size);
+	CHECK(sb.st_size < st.st_size, "increment not smaller than data file");
+
+	/* The increment no longer applies once the base has moved on */
+	apply(INCR);
+	E(mdb_env_create(&base));
+	E(mdb_env_open(base, BASE, NOSUB, 0664));
+	{
+		int fd = open(INCR, O_RDONLY);
+		CHECK(fd >= 0, INCR);
+		RES(MDB_INCOMPATIBLE, mdb_env_apply_incr(base, fd));
+		close(fd);
+	}
+	mdb_env_close(base);
+
+	E(mdb_env_create(&base));
+	E(mdb_env_open(base, BASE, NOSUB|MDB_RDONLY, 0664));
+	compare(env, base);
+
+	/* A second increment on top of the first */
+	update(env, 2000, 1);
+	E(mdb_env_copy_incr(env, INCR "2", base));
+	mdb_env_close(base);
+	apply(INCR "2");
+
+	E(mdb_env_create(&base));
+	E(mdb_env_open(base, BASE, NOSUB|MDB_RDONLY, 0664));
+	compare(env, base);
+	mdb_env_close(base);
+
+	mdb_env_close(env);
+	return 0;
+}
@@ -40,6 +40,7 @@ rewrite_parse_builtin_map(
  *
  *      rewriteEngine 		{on|off}
  *      rewriteMaxPasses        numPasses [numPassesPerRule]
+ *      rewriteMemo             numEntries
  *      rewriteContext 		contextName [alias aliasedContextName]
  *      rewriteRule 		pattern substPattern [ruleFlags]
  *      rewriteMap 		mapType mapName [mapArgs]
@@ -60,6 +61,11 @@ rewrite_parse(
 	assert( fname != NULL );
 	assert( argv != NULL );
 	assert( argc > 0 );
+
+	/*
+	 * Whatever changes, previous results no longer apply
+	 */
+	info->li_memo_gen++;
 	
 	/*
 	 * Switch on the rewrite engine
@@ -137,6 +143,32 @@ rewrite_parse(
 			info->li_max_passes_per_rule = info->li_max_passes;
 		}
 		rc = REWRITE_SUCCESS;
+
+	/*
+	 * Size of the memo of each context
+	 */
+	} else if ( strcasecmp( argv[ 0 ], "rewriteMemo" ) == 0 ) {
+		if ( argc < 2 ) {
+			Debug( LDAP_DEBUG_ANY,
+					"[%s:%d] rewriteMemo needs 'value'\n%s",
+					fname, lineno, "" );
+			return -1;
+		}
+
+		if ( lutil_atoi( &info->li_memo_size, argv[ 1 ] ) != 0 ) {
+			Debug( LDAP_DEBUG_ANY,
+					"[%s:%d] unable to parse rewriteMemo=\"%s\"\n",
+					fname, lineno, argv[ 1 ] );
+			return -1;
+		}
+
+		if ( info->li_memo_size < 0 ) {
+			Debug( LDAP_DEBUG_ANY,
+					"[%s:%d] negative rewriteMemo\n",
+					fname, lineno, 0 );
+			return -1;
+		}
+		rc = REWRITE_SUCCESS;
 	
 	/*
 	 * Start a new rewrite context and set current context
@@ -140,6 +140,15 @@ rewrite_context_create(
 		return NULL;
 	}
 	memset( context->lc_rule, 0, sizeof( struct rewrite_rule ) );
+
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+	if ( ldap_pvt_thread_mutex_init( &context->lc_memo_mutex ) ) {
+		free( context->lc_rule );
+		free( context->lc_name );
+		free( context );
+		return NULL;
+	}
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
 	
 	/*
 	 * Add context to tree
@@ -147,6 +156,9 @@ rewrite_context_create(
 	rc = avl_insert( &info->li_context, (caddr_t)context,
 			rewrite_context_cmp, rewrite_context_dup );
 	if ( rc == -1 ) {
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+		ldap_pvt_thread_mutex_destroy( &context->lc_memo_mutex );
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
 		free( context->lc_rule );
 		free( context->lc_name );
 		free( context );
@@ -463,6 +475,8 @@ rewrite_context_destroy(
 	free( context->lc_rule );
 	context->lc_rule = NULL;
 
+	rewrite_memo_destroy( context );
+
 	assert( context->lc_name != NULL );
 	free( context->lc_name );
 	context->lc_name = NULL;
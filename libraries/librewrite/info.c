@@ -42,6 +42,9 @@ rewrite_info_init(
 {
 	struct rewrite_info *info;
 	struct rewrite_context *context;
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+	int i;
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
 	switch ( mode ) {
 	case REWRITE_MODE_ERR:
@@ -69,6 +72,7 @@ rewrite_info_init(
 	info->li_max_passes = REWRITE_MAX_PASSES;
 	info->li_max_passes_per_rule = REWRITE_MAX_PASSES;
 	info->li_rewrite_mode = mode;
+	info->li_memo_size = REWRITE_MEMO_SIZE;
 
 	/*
 	 * Add the default (empty) rule
@@ -80,13 +84,20 @@ rewrite_info_init(
 	}
 
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-	if ( ldap_pvt_thread_rdwr_init( &info->li_cookies_mutex ) ) {
-		avl_free( info->li_context, rewrite_context_free );
-		free( info );
-		return NULL;
+	for ( i = 0; i < REWRITE_COOKIE_BUCKETS; i++ ) {
+		if ( ldap_pvt_thread_rdwr_init( &info->li_cookies_mutex[ i ] ) ) {
+			while ( --i >= 0 ) {
+				ldap_pvt_thread_rdwr_destroy( &info->li_cookies_mutex[ i ] );
+			}
+			avl_free( info->li_context, rewrite_context_free );
+			free( info );
+			return NULL;
+		}
 	}
 	if ( ldap_pvt_thread_rdwr_init( &info->li_params_mutex ) ) {
-		ldap_pvt_thread_rdwr_destroy( &info->li_cookies_mutex );
+		for ( i = 0; i < REWRITE_COOKIE_BUCKETS; i++ ) {
+			ldap_pvt_thread_rdwr_destroy( &info->li_cookies_mutex[ i ] );
+		}
 		avl_free( info->li_context, rewrite_context_free );
 		free( info );
 		return NULL;
@@ -105,6 +116,9 @@ rewrite_info_delete(
 )
 {
 	struct rewrite_info	*info;
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+	int i;
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
 	assert( pinfo != NULL );
 	assert( *pinfo != NULL );
@@ -124,7 +138,9 @@ rewrite_info_delete(
 	rewrite_session_destroy( info );
 
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-	ldap_pvt_thread_rdwr_destroy( &info->li_cookies_mutex );
+	for ( i = 0; i < REWRITE_COOKIE_BUCKETS; i++ ) {
+		ldap_pvt_thread_rdwr_destroy( &info->li_cookies_mutex[ i ] );
+	}
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
 	rewrite_param_destroy( info );
@@ -234,6 +250,13 @@ rewrite_session(
 	}
 #endif
 	
+	/*
+	 * The same string may have been rewritten recently
+	 */
+	if ( rewrite_memo_get( info, context, string, &rc, result ) == 0 ) {
+		goto rc_return;
+	}
+
 	/*
 	 * Applies rewrite context
 	 */
@@ -274,6 +297,8 @@ rewrite_session(
 		break;
 	}
 
+	rewrite_memo_put( info, context, string, rc, *result );
+
 rc_return:;
 	if ( op.lo_vars ) {
 		rewrite_var_delete( op.lo_vars );
@@ -0,0 +1,264 @@
+/* $OpenLDAP$ */
+/* This work is part of OpenLDAP Software <http://www.openldap.org/>.
+ *
+ * Copyright 2000-2018 The OpenLDAP Foundation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+#include <portable.h>
+
+#include "rewrite-int.h"
+
+/*
+ * Longer strings are not worth remembering
+ */
+#define REWRITE_MEMO_MAXLEN		1024
+
+/*
+ * The same DNs and filters are rewritten over and over again
+ * (e.g. the suffix of each entry returned by a search, or the
+ * values of the member attribute); if the outcome of a context
+ * only depends on the input string, the last few results are
+ * kept in a small direct-mapped table, indexed by a hash of the
+ * input.  Contexts whose rules use maps, variables or parameters
+ * are never memoized, since their results may change from one
+ * operation to the next.
+ */
+
+static unsigned
+rewrite_memo_hash(
+		const char *s,
+		ber_len_t len
+)
+{
+	unsigned h = 2166136261U;
+	ber_len_t i;
+
+	for ( i = 0; i < len; i++ ) {
+		h ^= (unsigned char)s[ i ];
+		h *= 16777619U;
+	}
+
+	return h;
+}
+
+static void
+rewrite_memo_free(
+		struct rewrite_memo *memo
+)
+{
+	int i;
+
+	if ( memo == NULL ) {
+		return;
+	}
+
+	for ( i = 0; i < memo->lm_size; i++ ) {
+		if ( memo->lm_entries[ i ].lme_in.bv_val != NULL ) {
+			free( memo->lm_entries[ i ].lme_in.bv_val );
+		}
+	}
+	free( memo );
+}
+
+int
+rewrite_memo_get(
+		struct rewrite_info *info,
+		struct rewrite_context *context,
+		const char *string,
+		int *rc,
+		char **result
+)
+{
+	struct rewrite_memo *memo;
+	struct rewrite_memo_entry *e;
+	ber_len_t len;
+	unsigned h;
+	int found = -1;
+
+	assert( info != NULL );
+	assert( context != NULL );
+	assert( string != NULL );
+	assert( rc != NULL );
+	assert( result != NULL );
+
+	if ( info->li_memo_size <= 0 || context->lc_nomemo ) {
+		return -1;
+	}
+
+	len = strlen( string );
+	if ( len > REWRITE_MEMO_MAXLEN ) {
+		return -1;
+	}
+	h = rewrite_memo_hash( string, len );
+
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+	ldap_pvt_thread_mutex_lock( &context->lc_memo_mutex );
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
+
+	memo = context->lc_memo;
+	if ( memo == NULL || memo->lm_gen != info->li_memo_gen ) {
+		goto done;
+	}
+
+	e = &memo->lm_entries[ h % memo->lm_size ];
+	if ( e->lme_in.bv_val == NULL || e->lme_hash != h
+			|| e->lme_in.bv_len != len
+			|| memcmp( e->lme_in.bv_val, string, len ) != 0 )
+	{
+		goto done;
+	}
+
+	switch ( e->lme_type ) {
+	case REWRITE_MEMO_NULL:
+		*result = NULL;
+		break;
+
+	case REWRITE_MEMO_ASIS:
+		*result = (char *)string;
+		break;
+
+	case REWRITE_MEMO_STRING:
+		*result = strdup( e->lme_out.bv_val );
+		if ( *result == NULL ) {
+			goto done;
+		}
+		break;
+	}
+	*rc = e->lme_rc;
+	found = 0;
+
+done:;
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+	ldap_pvt_thread_mutex_unlock( &context->lc_memo_mutex );
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
+
+	return found;
+}
+
+void
+rewrite_memo_put(
+		struct rewrite_info *info,
+		struct rewrite_context *context,
+		const char *string,
+		int rc,
+		const char *result
+)
+{
+	struct rewrite_memo *memo;
+	struct rewrite_memo_entry *e;
+	ber_len_t len, outlen = 0;
+	unsigned h;
+	int type;
+	char *buf;
+
+	assert( info != NULL );
+	assert( context != NULL );
+	assert( string != NULL );
+
+	/*
+	 * Errors may be transient (e.g. out of memory)
+	 */
+	if ( info->li_memo_size <= 0 || context->lc_nomemo
+			|| rc == REWRITE_REGEXEC_ERR )
+	{
+		return;
+	}
+
+	len = strlen( string );
+	if ( len > REWRITE_MEMO_MAXLEN ) {
+		return;
+	}
+	h = rewrite_memo_hash( string, len );
+
+	if ( result == NULL ) {
+		type = REWRITE_MEMO_NULL;
+
+	} else if ( result == string ) {
+		type = REWRITE_MEMO_ASIS;
+
+	} else {
+		type = REWRITE_MEMO_STRING;
+		outlen = strlen( result );
+		if ( outlen > REWRITE_MEMO_MAXLEN ) {
+			return;
+		}
+	}
+
+	/* input and output share the same buffer */
+	buf = malloc( len + 1 + outlen + 1 );
+	if ( buf == NULL ) {
+		return;
+	}
+	AC_MEMCPY( buf, string, len + 1 );
+	if ( type == REWRITE_MEMO_STRING ) {
+		AC_MEMCPY( &buf[ len + 1 ], result, outlen + 1 );
+	}
+
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+	ldap_pvt_thread_mutex_lock( &context->lc_memo_mutex );
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
+
+	memo = context->lc_memo;
+	if ( memo == NULL || memo->lm_gen != info->li_memo_gen
+			|| memo->lm_size != info->li_memo_size )
+	{
+		rewrite_memo_free( memo );
+		memo = calloc( 1, sizeof( struct rewrite_memo )
+			+ info->li_memo_size * sizeof( struct rewrite_memo_entry ) );
+		context->lc_memo = memo;
+		if ( memo == NULL ) {
+			free( buf );
+			goto done;
+		}
+		memo->lm_size = info->li_memo_size;
+		memo->lm_gen = info->li_memo_gen;
+		memo->lm_entries = (struct rewrite_memo_entry *)&memo[ 1 ];
+	}
+
+	e = &memo->lm_entries[ h % memo->lm_size ];
+	if ( e->lme_in.bv_val != NULL ) {
+		free( e->lme_in.bv_val );
+	}
+	e->lme_hash = h;
+	e->lme_rc = rc;
+	e->lme_type = type;
+	e->lme_in.bv_val = buf;
+	e->lme_in.bv_len = len;
+	if ( type == REWRITE_MEMO_STRING ) {
+		e->lme_out.bv_val = &buf[ len + 1 ];
+		e->lme_out.bv_len = outlen;
+
+	} else {
+		e->lme_out.bv_val = NULL;
+		e->lme_out.bv_len = 0;
+	}
+
+done:;
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+	ldap_pvt_thread_mutex_unlock( &context->lc_memo_mutex );
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
+}
+
+void
+rewrite_memo_destroy(
+		struct rewrite_context *context
+)
+{
+	assert( context != NULL );
+
+	rewrite_memo_free( context->lc_memo );
+	context->lc_memo = NULL;
+
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+	ldap_pvt_thread_mutex_destroy( &context->lc_memo_mutex );
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
+}
@@ -37,7 +37,8 @@ parse_line(
 	
 	for ( p = buf; isspace( (unsigned char) p[ 0 ] ); p++ );
 	
-	if ( p[ 0 ] == '#' ) {
+	/* comments and blank lines */
+	if ( p[ 0 ] == '#' || p[ 0 ] == '\0' ) {
 		return 0;
 	}
 	
@@ -224,6 +224,14 @@ struct rewrite_rule {
 	 */
 
 	struct rewrite_subst           *lr_subst;
+
+	/*
+	 * Literal text the pattern requires at the start and at the
+	 * end of the string, if any; checked before calling regexec
+	 * so that most non-matching strings are rejected cheaply
+	 */
+	struct berval			lr_prefix;
+	struct berval			lr_suffix;
 	
 #define REWRITE_REGEX_ICASE		REG_ICASE
 #define REWRITE_REGEX_EXTENDED		REG_EXTENDED	
@@ -244,6 +252,36 @@ struct rewrite_context {
 	char                           *lc_name;
 	struct rewrite_context         *lc_alias;
 	struct rewrite_rule            *lc_rule;
+
+	/*
+	 * Results of recent rewrites; only used if no rule
+	 * in the context uses maps, variables or parameters
+	 */
+	int				lc_nomemo;
+	struct rewrite_memo            *lc_memo;
+#ifdef USE_REWRITE_LDAP_PVT_THREADS
+	ldap_pvt_thread_mutex_t		lc_memo_mutex;
+#endif /* USE_REWRITE_LDAP_PVT_THREADS */
+};
+
+/*
+ * Memo of the rewrites of a context
+ */
+struct rewrite_memo_entry {
+	unsigned			lme_hash;
+	int				lme_rc;
+#define REWRITE_MEMO_NULL		0x0000
+#define REWRITE_MEMO_ASIS		0x0001
+#define REWRITE_MEMO_STRING		0x0002
+	int				lme_type;
+	struct berval			lme_in;
+	struct berval			lme_out;
+};
+
+struct rewrite_memo {
+	int				lm_size;
+	unsigned long			lm_gen;
+	struct rewrite_memo_entry      *lm_entries;
 };
 
 /*
@@ -298,12 +336,22 @@ struct rewrite_info {
 	 * config time
 	 */
 	Avlnode                        *li_params;
-	Avlnode                        *li_cookies;
-	int                             li_num_cookies;
+
+	/*
+	 * Sessions are spread over several trees, selected
+	 * by the cookie, so that sessions of different
+	 * connections do not contend for the same lock
+	 */
+#define REWRITE_COOKIE_BUCKETS		16
+#define REWRITE_COOKIE_BUCKET(c) \
+	((unsigned)(((unsigned long)(c) >> 4) * 2654435761UL >> 8) \
+		% REWRITE_COOKIE_BUCKETS)
+	Avlnode                        *li_cookies[ REWRITE_COOKIE_BUCKETS ];
+	int                             li_num_cookies[ REWRITE_COOKIE_BUCKETS ];
 
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
 	ldap_pvt_thread_rdwr_t          li_params_mutex;
-        ldap_pvt_thread_rdwr_t          li_cookies_mutex;
+        ldap_pvt_thread_rdwr_t          li_cookies_mutex[ REWRITE_COOKIE_BUCKETS ];
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
 	/*
@@ -324,6 +372,19 @@ struct rewrite_info {
 	 * Behavior in case a NULL or non-existent context is required
 	 */
 	int                             li_rewrite_mode;
+
+	/*
+	 * Defaults to REWRITE_MEMO_SIZE entries per context;
+	 * use `rewriteMemo numEntries' directive to alter
+	 */
+#define REWRITE_MEMO_SIZE		256
+	int				li_memo_size;
+
+	/*
+	 * Bumped whenever the configuration changes,
+	 * invalidating all memoized results
+	 */
+	unsigned long			li_memo_gen;
 };
 
 /***********
@@ -623,5 +684,39 @@ rewrite_context_free(
 		void *tmp
 );
 
+/*
+ * Memo
+ */
+
+/*
+ * Looks up a previous rewrite of string by context;
+ * returns 0 and fills rc and result if found, -1 otherwise
+ */
+LDAP_REWRITE_F (int)
+rewrite_memo_get(
+		struct rewrite_info *info,
+		struct rewrite_context *context,
+		const char *string,
+		int *rc,
+		char **result
+);
+
+/*
+ * Records the rewrite of string by context
+ */
+LDAP_REWRITE_F (void)
+rewrite_memo_put(
+		struct rewrite_info *info,
+		struct rewrite_context *context,
+		const char *string,
+		int rc,
+		const char *result
+);
+
+LDAP_REWRITE_F (void)
+rewrite_memo_destroy(
+		struct rewrite_context *context
+);
+
 #endif /* REWRITE_INT_H */
 
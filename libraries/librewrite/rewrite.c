@@ -39,26 +39,23 @@ int ldap_syslog_level;
 
 static void
 apply( 
-		FILE *fin, 
-		const char *rewriteContext,
+		struct rewrite_info *info,
+		void *cookie,
+		const char *rewriteContexts,
 		const char *arg
 )
 {
-	struct rewrite_info *info;
-	char *string, *sep, *result = NULL;
+	char *rewriteContext, *string, *sep, *result = NULL;
+	char *ctxs;
 	int rc;
-	void *cookie = &info;
-
-	info = rewrite_info_init( REWRITE_MODE_ERR );
 
-	if ( rewrite_read( fin, info ) != 0 ) {
+	/* the list is split in place */
+	ctxs = strdup( rewriteContexts );
+	if ( ctxs == NULL ) {
 		exit( EXIT_FAILURE );
 	}
 
-	rewrite_param_set( info, "prog", "rewrite" );
-
-	rewrite_session_init( info, cookie );
-
+	rewriteContext = ctxs;
 	string = (char *)arg;
 	for ( sep = strchr( rewriteContext, ',' );
 			rewriteContext != NULL;
@@ -117,26 +114,36 @@ apply(
 		free( result );
 	}
 
-	rewrite_session_delete( info, cookie );
-
-	rewrite_info_delete( &info );
+	free( ctxs );
 }
 
 int
 main( int argc, char *argv[] )
 {
-	FILE	*fin = NULL;
+	FILE	*fin = NULL, *fadd = NULL;
 	char	*rewriteContext = REWRITE_DEFAULT_CONTEXT;
 	int	debug = 0;
+	struct rewrite_info *info;
+	void	*cookie = &info;
+	int	i;
 
 	while ( 1 ) {
-		int opt = getopt( argc, argv, "d:f:hr:" );
+		int opt = getopt( argc, argv, "a:d:f:hr:" );
 
 		if ( opt == EOF ) {
 			break;
 		}
 
 		switch ( opt ) {
+		case 'a':
+			fadd = fopen( optarg, "r" );
+			if ( fadd == NULL ) {
+				fprintf( stderr, "unable to open file '%s'\n",
+						optarg );
+				exit( EXIT_FAILURE );
+			}
+			break;
+
 		case 'd':
 			if ( lutil_atoi( &debug, optarg ) != 0 ) {
 				fprintf( stderr, "illegal log level '%s'\n",
@@ -156,9 +163,11 @@ main( int argc, char *argv[] )
 			
 		case 'h':
 			fprintf( stderr, 
-	"usage: rewrite [options] string\n"
+	"usage: rewrite [options] string [...]\n"
 	"\n"
 	"\t\t-f file\t\tconfiguration file\n"
+	"\t\t-a file\t\tmore configuration, read once all strings\n"
+	"\t\t\t\tare rewritten; they are then rewritten again\n"
 	"\t\t-r rule[s]\tlist of comma-separated rules\n"
 	"\n"
 	"\tsyntax:\n"
@@ -184,7 +193,34 @@ main( int argc, char *argv[] )
 		return -1;
 	}
 
-	apply( ( fin ? fin : stdin ), rewriteContext, argv[ optind ] );
+	info = rewrite_info_init( REWRITE_MODE_ERR );
+
+	if ( rewrite_read( ( fin ? fin : stdin ), info ) != 0 ) {
+		exit( EXIT_FAILURE );
+	}
+
+	rewrite_param_set( info, "prog", "rewrite" );
+
+	rewrite_session_init( info, cookie );
+
+	for ( i = optind; i < argc; i++ ) {
+		apply( info, cookie, rewriteContext, argv[ i ] );
+	}
+
+	if ( fadd ) {
+		/* results remembered so far must not survive this */
+		if ( rewrite_read( fadd, info ) != 0 ) {
+			exit( EXIT_FAILURE );
+		}
+		for ( i = optind; i < argc; i++ ) {
+			apply( info, cookie, rewriteContext, argv[ i ] );
+		}
+		fclose( fadd );
+	}
+
+	rewrite_session_delete( info, cookie );
+
+	rewrite_info_delete( &info );
 
 	if ( fin ) {
 		fclose( fin );
@@ -192,4 +228,3 @@ main( int argc, char *argv[] )
 
 	return 0;
 }
-
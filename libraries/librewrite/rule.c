@@ -44,6 +44,226 @@ append_rule(
 	return REWRITE_SUCCESS;
 }
 
+/*
+ * Finds the literal text an extended regex requires at the start
+ * (after a leading '^') and at the end (before a trailing '$') of
+ * the string it matches; anything that is not plain text, or is
+ * made optional or repeated by a quantifier, ends the literal.
+ * Patterns with alternatives are left alone.
+ * Helper for rewrite_rule_compile
+ */
+#define RULE_TOK_OTHER	(-1)
+#define RULE_TOK_BOL	(-2)
+#define RULE_TOK_EOL	(-3)
+
+static int
+rule_literals(
+		struct rewrite_rule *rule,
+		const char *pattern
+)
+{
+	int *tok, ntok = 0, *group, ngroup = 0;
+	const char *p;
+	int i, j, rc = REWRITE_ERR;
+
+	tok = malloc( ( strlen( pattern ) + 1 ) * 2 * sizeof( int ) );
+	if ( tok == NULL ) {
+		return REWRITE_ERR;
+	}
+	group = &tok[ strlen( pattern ) + 1 ];
+
+	for ( p = pattern; p[ 0 ] != '\0'; p++ ) {
+		switch ( p[ 0 ] ) {
+		case '\\':
+			p++;
+			if ( p[ 0 ] == '\0' ) {
+				goto done;
+			}
+			/* \w, \< and the like are GNU operators, not text */
+			tok[ ntok++ ] = ( isalnum( (unsigned char)p[ 0 ] )
+					|| strchr( "<>`'", p[ 0 ] ) != NULL )
+				? RULE_TOK_OTHER : (unsigned char)p[ 0 ];
+			break;
+
+		case '[':
+			p++;
+			if ( p[ 0 ] == '^' ) {
+				p++;
+			}
+			if ( p[ 0 ] == ']' ) {
+				p++;
+			}
+			for ( ; p[ 0 ] != ']'; p++ ) {
+				if ( p[ 0 ] == '\0' ) {
+					goto done;
+				}
+				if ( p[ 0 ] == '[' && ( p[ 1 ] == ':'
+						|| p[ 1 ] == '.' || p[ 1 ] == '=' ) )
+				{
+					char c = p[ 1 ];
+
+					for ( p += 2; p[ 0 ] != c || p[ 1 ] != ']'; p++ ) {
+						if ( p[ 0 ] == '\0' ) {
+							goto done;
+						}
+					}
+					p++;
+				}
+			}
+			tok[ ntok++ ] = RULE_TOK_OTHER;
+			break;
+
+		case '(':
+			group[ ngroup++ ] = ntok;
+			tok[ ntok++ ] = RULE_TOK_OTHER;
+			break;
+
+		case ')':
+			tok[ ntok++ ] = RULE_TOK_OTHER;
+			if ( ngroup > 0 && ( p[ 1 ] == '*' || p[ 1 ] == '+'
+					|| p[ 1 ] == '?' || p[ 1 ] == '{' ) )
+			{
+				/* the whole group is quantified */
+				for ( i = group[ ngroup - 1 ]; i < ntok; i++ ) {
+					tok[ i ] = RULE_TOK_OTHER;
+				}
+			}
+			if ( ngroup > 0 ) {
+				ngroup--;
+			}
+			break;
+
+		case '{':
+			for ( ; p[ 0 ] != '}'; p++ ) {
+				if ( p[ 0 ] == '\0' ) {
+					goto done;
+				}
+			}
+			/* fallthru */
+		case '*':
+		case '+':
+		case '?':
+			if ( ntok > 0 ) {
+				tok[ ntok - 1 ] = RULE_TOK_OTHER;
+			}
+			tok[ ntok++ ] = RULE_TOK_OTHER;
+			break;
+
+		case '|':
+			/* no literals with alternatives */
+			rc = REWRITE_SUCCESS;
+			goto done;
+
+		case '^':
+			tok[ ntok++ ] = RULE_TOK_BOL;
+			break;
+
+		case '$':
+			tok[ ntok++ ] = RULE_TOK_EOL;
+			break;
+
+		case '.':
+			tok[ ntok++ ] = RULE_TOK_OTHER;
+			break;
+
+		default:
+			tok[ ntok++ ] = (unsigned char)p[ 0 ];
+			break;
+		}
+	}
+
+	/*
+	 * Case-insensitive matching of non-ASCII characters
+	 * depends on the locale; stop the literals there
+	 */
+	if ( rule->lr_flags & REWRITE_REGEX_ICASE ) {
+		for ( i = 0; i < ntok; i++ ) {
+			if ( tok[ i ] >= 0x80 ) {
+				tok[ i ] = RULE_TOK_OTHER;
+			}
+		}
+	}
+
+	if ( ntok > 1 && tok[ 0 ] == RULE_TOK_BOL ) {
+		for ( i = 1; i < ntok && tok[ i ] >= 0; i++ )
+			/* count */ ;
+		if ( i > 1 ) {
+			rule->lr_prefix.bv_len = i - 1;
+			rule->lr_prefix.bv_val = malloc( i );
+			if ( rule->lr_prefix.bv_val == NULL ) {
+				goto done;
+			}
+			for ( j = 1; j < i; j++ ) {
+				rule->lr_prefix.bv_val[ j - 1 ] = tok[ j ];
+			}
+			rule->lr_prefix.bv_val[ i - 1 ] = '\0';
+		}
+	}
+
+	if ( ntok > 1 && tok[ ntok - 1 ] == RULE_TOK_EOL ) {
+		for ( i = ntok - 1; i > 0 && tok[ i - 1 ] >= 0; i-- )
+			/* count */ ;
+		if ( i < ntok - 1 ) {
+			rule->lr_suffix.bv_len = ntok - 1 - i;
+			rule->lr_suffix.bv_val = malloc( ntok - i );
+			if ( rule->lr_suffix.bv_val == NULL ) {
+				goto done;
+			}
+			for ( j = i; j < ntok - 1; j++ ) {
+				rule->lr_suffix.bv_val[ j - i ] = tok[ j ];
+			}
+			rule->lr_suffix.bv_val[ ntok - 1 - i ] = '\0';
+		}
+	}
+
+	rc = REWRITE_SUCCESS;
+
+done:;
+	free( tok );
+	return rc;
+}
+
+/*
+ * Checks the literals found by rule_literals;
+ * returns 0 if the string cannot match the rule
+ * Helper for rewrite_rule_apply
+ */
+static int
+rule_literals_match(
+		struct rewrite_rule *rule,
+		const char *string
+)
+{
+	size_t len;
+
+	if ( rule->lr_prefix.bv_len > 0 ) {
+		if ( ( rule->lr_flags & REWRITE_REGEX_ICASE )
+				? strncasecmp( string, rule->lr_prefix.bv_val,
+					rule->lr_prefix.bv_len )
+				: strncmp( string, rule->lr_prefix.bv_val,
+					rule->lr_prefix.bv_len ) )
+		{
+			return 0;
+		}
+	}
+
+	if ( rule->lr_suffix.bv_len > 0 ) {
+		len = strlen( string );
+		if ( len < rule->lr_suffix.bv_len ) {
+			return 0;
+		}
+		string += len - rule->lr_suffix.bv_len;
+		if ( ( rule->lr_flags & REWRITE_REGEX_ICASE )
+				? strcasecmp( string, rule->lr_suffix.bv_val )
+				: strcmp( string, rule->lr_suffix.bv_val ) )
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
 /*
  * Appends an action to the linked list of actions
  * Helper for rewrite_rule_compile
@@ -126,6 +346,7 @@ rewrite_rule_compile(
 	int flags = REWRITE_REGEX_EXTENDED | REWRITE_REGEX_ICASE;
 	int mode = REWRITE_RECURSE;
 	int max_passes;
+	int i;
 
 	struct rewrite_rule *rule = NULL;
 	struct rewrite_subst *subst = NULL;
@@ -361,10 +582,31 @@ rewrite_rule_compile(
 	/*
 	 * Set various parameters
 	 */
-	rule->lr_flags = flags;		/* don't really need any longer ... */
+	rule->lr_flags = flags;
 	rule->lr_mode = mode;
 	rule->lr_max_passes = max_passes;
 	rule->lr_action = first_action;
+
+	/*
+	 * Literal text required by extended regexes
+	 */
+	if ( ( flags & REWRITE_REGEX_EXTENDED )
+			&& rule_literals( rule, pattern ) != REWRITE_SUCCESS )
+	{
+		regfree( &rule->lr_regex );
+		goto fail;
+	}
+
+	/*
+	 * Results depending on anything but the input string
+	 * cannot be memoized
+	 */
+	for ( i = 0; i < subst->lt_num_submatch; i++ ) {
+		if ( subst->lt_submatch[ i ].ls_type != REWRITE_SUBMATCH_ASIS ) {
+			context->lc_nomemo = 1;
+			break;
+		}
+	}
 	
 	/*
 	 * Append rule at the end of the rewrite context
@@ -375,6 +617,8 @@ rewrite_rule_compile(
 
 fail:
 	if ( rule ) {
+		if ( rule->lr_prefix.bv_val ) free( rule->lr_prefix.bv_val );
+		if ( rule->lr_suffix.bv_val ) free( rule->lr_suffix.bv_val );
 		if ( rule->lr_pattern ) free( rule->lr_pattern );
 		if ( rule->lr_subststring ) free( rule->lr_subststring );
 		if ( rule->lr_flagstring ) free( rule->lr_flagstring );
@@ -430,7 +674,12 @@ recurse:;
 	
 	op->lo_num_passes++;
 
-	rc = regexec( &rule->lr_regex, string, nmatch, match, 0 );
+	if ( !rule_literals_match( rule, string ) ) {
+		rc = REG_NOMATCH;
+
+	} else {
+		rc = regexec( &rule->lr_regex, string, nmatch, match, 0 );
+	}
 	if ( rc != 0 ) {
 		if ( *result == NULL && string != arg ) {
 			free( string );
@@ -494,6 +743,18 @@ rewrite_rule_destroy(
 		rule->lr_flagstring = NULL;
 	}
 
+	if ( rule->lr_prefix.bv_val ) {
+		free( rule->lr_prefix.bv_val );
+		rule->lr_prefix.bv_val = NULL;
+		rule->lr_prefix.bv_len = 0;
+	}
+
+	if ( rule->lr_suffix.bv_val ) {
+		free( rule->lr_suffix.bv_val );
+		rule->lr_suffix.bv_val = NULL;
+		rule->lr_suffix.bv_len = 0;
+	}
+
 	if ( rule->lr_subst ) {
 		rewrite_subst_destroy( &rule->lr_subst );
 	}
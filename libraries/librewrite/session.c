@@ -78,22 +78,24 @@ rewrite_session_init(
 )
 {
 	struct rewrite_session 	*session, tmp;
-	int			rc;
+	int			rc, b;
 
 	assert( info != NULL );
 	assert( cookie != NULL );
 
+	b = REWRITE_COOKIE_BUCKET( cookie );
+
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-	ldap_pvt_thread_rdwr_wlock( &info->li_cookies_mutex );
+	ldap_pvt_thread_rdwr_wlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
 	tmp.ls_cookie = ( void * )cookie;
-	session = ( struct rewrite_session * )avl_find( info->li_cookies, 
+	session = ( struct rewrite_session * )avl_find( info->li_cookies[ b ], 
 			( caddr_t )&tmp, rewrite_cookie_cmp );
 	if ( session ) {
 		session->ls_count++;
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-		ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex );
+		ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 		return session;
 	}
@@ -101,7 +103,7 @@ rewrite_session_init(
 	session = calloc( sizeof( struct rewrite_session ), 1 );
 	if ( session == NULL ) {
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-		ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex );
+		ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 		return NULL;
 	}
@@ -111,23 +113,23 @@ rewrite_session_init(
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
 	if ( ldap_pvt_thread_mutex_init( &session->ls_mutex ) ) {
 		free( session );
-		ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex );
+		ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex[ b ] );
 		return NULL;
 	}
 	if ( ldap_pvt_thread_rdwr_init( &session->ls_vars_mutex ) ) {
 		ldap_pvt_thread_mutex_destroy( &session->ls_mutex );
 		free( session );
-		ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex );
+		ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex[ b ] );
 		return NULL;
 	}
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
-	rc = avl_insert( &info->li_cookies, ( caddr_t )session,
+	rc = avl_insert( &info->li_cookies[ b ], ( caddr_t )session,
 			rewrite_cookie_cmp, rewrite_cookie_dup );
-	info->li_num_cookies++;
+	info->li_num_cookies[ b ]++;
 
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-	ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex );
+	ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 	
 	if ( rc != 0 ) {
@@ -153,22 +155,24 @@ rewrite_session_find(
 )
 {
 	struct rewrite_session *session, tmp;
+	int b;
 
 	assert( info != NULL );
 	assert( cookie != NULL );
-	
+
+	b = REWRITE_COOKIE_BUCKET( cookie );
 	tmp.ls_cookie = ( void * )cookie;
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-	ldap_pvt_thread_rdwr_rlock( &info->li_cookies_mutex );
+	ldap_pvt_thread_rdwr_rlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
-	session = ( struct rewrite_session * )avl_find( info->li_cookies,
+	session = ( struct rewrite_session * )avl_find( info->li_cookies[ b ],
 			( caddr_t )&tmp, rewrite_cookie_cmp );
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
 	if ( session ) {
 		ldap_pvt_thread_mutex_lock( &session->ls_mutex );
 		session->ls_count++;
 	}
-	ldap_pvt_thread_rdwr_runlock( &info->li_cookies_mutex );
+	ldap_pvt_thread_rdwr_runlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
 	return session;
@@ -344,10 +348,13 @@ rewrite_session_delete(
 )
 {
 	struct rewrite_session *session, tmp = { 0 };
+	int b;
 
 	assert( info != NULL );
 	assert( cookie != NULL );
 
+	b = REWRITE_COOKIE_BUCKET( cookie );
+
 	session = rewrite_session_find( info, cookie );
 
 	if ( session == NULL ) {
@@ -362,22 +369,22 @@ rewrite_session_delete(
 	rewrite_session_clean( session );
 
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-	ldap_pvt_thread_rdwr_wlock( &info->li_cookies_mutex );
+	ldap_pvt_thread_rdwr_wlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
-	assert( info->li_num_cookies > 0 );
-	info->li_num_cookies--;
+	assert( info->li_num_cookies[ b ] > 0 );
+	info->li_num_cookies[ b ]--;
 	
 	/*
 	 * There is nothing to delete in the return value
 	 */
 	tmp.ls_cookie = ( void * )cookie;
-	avl_delete( &info->li_cookies, ( caddr_t )&tmp, rewrite_cookie_cmp );
+	avl_delete( &info->li_cookies[ b ], ( caddr_t )&tmp, rewrite_cookie_cmp );
 
 	free( session );
 
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-	ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex );
+	ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
 	return REWRITE_SUCCESS;
@@ -391,32 +398,34 @@ rewrite_session_destroy(
 		struct rewrite_info *info
 )
 {
-	int count;
+	int b, count;
 
 	assert( info != NULL );
-	
+
+	for ( b = 0; b < REWRITE_COOKIE_BUCKETS; b++ ) {
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-	ldap_pvt_thread_rdwr_wlock( &info->li_cookies_mutex );
+		ldap_pvt_thread_rdwr_wlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
 
-	/*
-	 * Should call per-session destruction routine ...
-	 */
-	
-	count = avl_free( info->li_cookies, rewrite_session_free );
-	info->li_cookies = NULL;
+		/*
+		 * Should call per-session destruction routine ...
+		 */
+		
+		count = avl_free( info->li_cookies[ b ], rewrite_session_free );
+		info->li_cookies[ b ] = NULL;
 
 #if 0
-	fprintf( stderr, "count = %d; num_cookies = %d\n", 
-			count, info->li_num_cookies );
+		fprintf( stderr, "count = %d; num_cookies = %d\n", 
+				count, info->li_num_cookies[ b ] );
 #endif
-	
-	assert( count == info->li_num_cookies );
-	info->li_num_cookies = 0;
+		
+		assert( count == info->li_num_cookies[ b ] );
+		info->li_num_cookies[ b ] = 0;
 
 #ifdef USE_REWRITE_LDAP_PVT_THREADS
-	ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex );
+		ldap_pvt_thread_rdwr_wunlock( &info->li_cookies_mutex[ b ] );
 #endif /* USE_REWRITE_LDAP_PVT_THREADS */
+	}
 
 	return REWRITE_SUCCESS;
 }
@@ -374,6 +374,7 @@ access_allowed_mask(
 	slap_mask_t			mask;
 	slap_access_t			access_level;
 	const char			*attr;
+	struct timeval			tv;
 
 	assert( e != NULL );
 	assert( desc != NULL );
@@ -444,6 +445,7 @@ access_allowed_mask(
 	}
 	assert( op->o_bd != NULL );
 
+	SLAP_PHASE_BEGIN( tv );
 	/* this is enforced in backend_add() */
 	if ( op->o_bd->bd_info->bi_access_allowed ) {
 		/* delegate to backend */
@@ -456,6 +458,7 @@ access_allowed_mask(
 		ret = frontendDB->bd_info->bi_access_allowed( op, e,
 				desc, val, access, state, &mask );
 	}
+	SLAP_PHASE_END( op, SLAP_PHASE_ACL, tv );
 
 	if ( !ret ) {
 		if ( ACL_IS_INVALID( mask ) ) {
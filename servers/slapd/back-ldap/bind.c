@@ -908,14 +908,27 @@ ldap_back_getconn(
 retry_lock:
 		ldap_pvt_thread_mutex_lock( &li->li_conninfo.lai_mutex );
 		if ( LDAP_BACK_PCONN_ISPRIV( &lc_curr ) ) {
-			/* lookup a conn that's not binding */
+			ldapconn_t	*lc_least = NULL;
+
+			/* lookup a conn that's not binding; meanwhile,
+			 * remember the least loaded one, so that when
+			 * the pool is saturated requests are multiplexed
+			 * evenly across the pooled connections */
 			LDAP_TAILQ_FOREACH( lc,
 				&li->li_conn_priv[ LDAP_BACK_CONN2PRIV( &lc_curr ) ].lic_priv,
 				lc_q )
 			{
-				if ( !LDAP_BACK_CONN_BINDING( lc ) && lc->lc_refcnt == 0 ) {
+				if ( LDAP_BACK_CONN_BINDING( lc ) ) {
+					continue;
+				}
+
+				if ( lc->lc_refcnt == 0 ) {
 					break;
 				}
+
+				if ( lc_least == NULL || lc->lc_refcnt < lc_least->lc_refcnt ) {
+					lc_least = lc;
+				}
 			}
 
 			if ( lc != NULL ) {
@@ -932,7 +945,12 @@ retry_lock:
 			} else if ( !LDAP_BACK_USE_TEMPORARIES( li )
 				&& li->li_conn_priv[ LDAP_BACK_CONN2PRIV( &lc_curr ) ].lic_num == li->li_conn_priv_max )
 			{
-				lc = LDAP_TAILQ_FIRST( &li->li_conn_priv[ LDAP_BACK_CONN2PRIV( &lc_curr ) ].lic_priv );
+				/* pool is full: share the least loaded conn;
+				 * if all of them are binding, wait on the first one */
+				lc = lc_least;
+				if ( lc == NULL ) {
+					lc = LDAP_TAILQ_FIRST( &li->li_conn_priv[ LDAP_BACK_CONN2PRIV( &lc_curr ) ].lic_priv );
+				}
 			}
 			
 		} else {
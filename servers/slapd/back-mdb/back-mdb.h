@@ -83,6 +83,20 @@ struct mdb_info {
 	int			mi_readers;
 
 	uint32_t	mi_rtxn_size;
+	uint32_t	mi_rtxn_maxage;
+	uint32_t	mi_prefetch;
+
+	/* search candidate cache */
+	ldap_pvt_thread_mutex_t	mi_sc_mutex;
+	struct mdb_scentry	**mi_sc_hash;
+	struct mdb_scentry	*mi_sc_head, *mi_sc_tail;	/* LRU order */
+	unsigned	mi_sc_hashsize;
+	unsigned	mi_sc_num;
+	unsigned	mi_sc_max;
+	unsigned long	mi_sc_hits;
+	unsigned long	mi_sc_misses;
+	size_t		mi_dn2id_lastmod;	/* last txn that wrote to dn2id */
+
 	int			mi_txn_cp;
 	uint32_t	mi_txn_cp_min;
 	uint32_t	mi_txn_cp_kbyte;
@@ -133,6 +147,28 @@ typedef struct mdb_op_info {
 #define MOI_FREEIT	0x02
 #define MOI_KEEPER	0x04
 
+/* Rough cardinality estimates used to order the terms of AND/OR lists.
+ * Equality and presence terms are costed by counting the IDs under
+ * their index key; other indexed terms can't be costed cheaply.
+ */
+#define MDB_COST_ALL		NOID
+#define MDB_COST_UNKNOWN	(NOID-1)
+
+/* per-search state for the EXPLAIN control */
+typedef struct mdb_explain {
+	BerVarray	mx_plan;	/* one line per filter term */
+	int			mx_nplan;
+	int			mx_depth;
+	ID			mx_cost;	/* estimate for the next term evaluated */
+	unsigned long	mx_tested;
+	unsigned long	mx_rejected;
+} mdb_explain;
+
+extern int mdb_explain_cid;
+#define mdb_explain_get(op) \
+	((op)->o_ctrlflag[mdb_explain_cid] > SLAP_CONTROL_IGNORED \
+		? (mdb_explain *)(op)->o_controls[mdb_explain_cid] : NULL)
+
 LDAP_END_DECL
 
 /* for the cache of attribute information (which are indexed, etc.) */
@@ -149,6 +185,7 @@ typedef struct mdb_attrinfo {
 	MDB_dbi ai_dbi;
 	unsigned ai_multi_hi;
 	unsigned ai_multi_lo;
+	size_t ai_lastmod;	/* last txn that wrote to this index */
 } AttrInfo;
 
 /* tool threaded indexer state */
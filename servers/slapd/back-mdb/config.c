@@ -41,6 +41,7 @@ enum {
 	MDB_MODE,
 	MDB_SSTACK,
 	MDB_MULTIVAL,
+	MDB_SCACHE,
 };
 
 static ConfigTable mdbcfg[] = {
@@ -94,6 +95,20 @@ static ConfigTable mdbcfg[] = {
 		"( OLcfgDbAt:12.5 NAME 'olcDbRtxnSize' "
 		"DESC 'Number of entries to process in one read transaction' "
 		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
+	{ "prefetch", "entries", 2, 2, 0, ARG_UINT|ARG_OFFSET,
+		(void *)offsetof(struct mdb_info, mi_prefetch),
+		"( OLcfgDbAt:12.8 NAME 'olcDbPrefetch' "
+		"DESC 'Number of search candidates to read ahead' "
+		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
+	{ "rtxnmaxage", "seconds", 2, 2, 0, ARG_UINT|ARG_OFFSET,
+		(void *)offsetof(struct mdb_info, mi_rtxn_maxage),
+		"( OLcfgDbAt:12.7 NAME 'olcDbRtxnMaxAge' "
+		"DESC 'Seconds a search may keep one read transaction' "
+		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
+	{ "searchcache", "entries", 2, 2, 0, ARG_UINT|ARG_MAGIC|MDB_SCACHE,
+		mdb_cf_gen, "( OLcfgDbAt:12.9 NAME 'olcDbSearchCache' "
+		"DESC 'Number of search candidate lists to cache' "
+		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "searchstack", "depth", 2, 2, 0, ARG_INT|ARG_MAGIC|MDB_SSTACK,
 		mdb_cf_gen, "( OLcfgDbAt:1.9 NAME 'olcDbSearchStack' "
 		"DESC 'Depth of search stack in IDLs' "
@@ -112,7 +127,8 @@ static ConfigOCs mdbocs[] = {
 		"MAY ( olcDbCheckpoint $ olcDbEnvFlags $ "
 		"olcDbNoSync $ olcDbIndex $ olcDbMaxReaders $ olcDbMaxSize $ "
 		"olcDbMode $ olcDbSearchStack $ olcDbMaxEntrySize $ olcDbRtxnSize $ "
-		"olcDbMultival ) )",
+		"olcDbMultival $ olcDbRtxnMaxAge $ olcDbPrefetch $ "
+		"olcDbSearchCache ) )",
 		 	Cft_Database, mdbcfg },
 	{ NULL, 0, NULL }
 };
@@ -133,7 +149,15 @@ mdb_checkpoint( void *ctx, void *arg )
 	struct re_s *rtask = arg;
 	struct mdb_info *mdb = rtask->arg;
 
+	int dead = 0;
+
 	mdb_env_sync( mdb->mi_dbenv, 1 );
+	/* also release slots left behind by processes that died */
+	mdb_reader_check( mdb->mi_dbenv, &dead );
+	if ( dead ) {
+		Debug( LDAP_DEBUG_TRACE, LDAP_XSTRING(mdb_checkpoint)
+			": cleared %d stale reader slots\n", dead, 0, 0 );
+	}
 	ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
 	ldap_pvt_runqueue_stoptask( &slapd_rq, rtask );
 	ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
@@ -358,6 +382,10 @@ mdb_cf_gen( ConfigArgs *c )
 			mdb_attr_multi_unparse( mdb, &c->rvalue_vals );
 			if ( !c->rvalue_vals ) rc = 1;
 			break;
+
+		case MDB_SCACHE:
+			c->value_uint = mdb->mi_sc_max;
+			break;
 		}
 		return rc;
 	} else if ( c->op == LDAP_MOD_DELETE ) {
@@ -377,6 +405,11 @@ mdb_cf_gen( ConfigArgs *c )
 		case MDB_MAXSIZE:
 			break;
 
+		case MDB_SCACHE:
+			mdb->mi_sc_max = 0;
+			mdb_scache_flush( mdb );
+			break;
+
 		case MDB_CHKPT:
 			if ( mdb->mi_txn_cp_task ) {
 				struct re_s *re = mdb->mi_txn_cp_task;
@@ -437,6 +470,7 @@ mdb_cf_gen( ConfigArgs *c )
 			break;
 
 		case MDB_INDEX:
+			mdb_scache_flush( mdb );
 			if ( c->valx == -1 ) {
 				int i;
 
@@ -699,6 +733,7 @@ mdb_cf_gen( ConfigArgs *c )
 		break;
 
 	case MDB_INDEX:
+		mdb_scache_flush( mdb );
 		rc = mdb_attr_index_config( mdb, c->fname, c->lineno,
 			c->argc - 1, &c->argv[1], &c->reply);
 
@@ -757,6 +792,11 @@ mdb_cf_gen( ConfigArgs *c )
 
 		if( rc != LDAP_SUCCESS ) return 1;
 		break;
+
+	case MDB_SCACHE:
+		mdb_scache_flush( mdb );
+		mdb->mi_sc_max = c->value_uint;
+		break;
 	}
 	return 0;
 }
@@ -99,6 +99,9 @@ mdb_dn2id_add(
 	Debug( LDAP_DEBUG_TRACE, "=> mdb_dn2id_add 0x%lx: \"%s\"\n",
 		e->e_id, e->e_ndn ? e->e_ndn : "", 0 );
 
+	/* for the search candidate cache */
+	mdb->mi_dn2id_lastmod = mdb_txn_id( mdb_cursor_txn( mcd ));
+
 	nrlen = dn_rdnlen( op->o_bd, &e->e_nname );
 	if (nrlen) {
 		rlen = dn_rdnlen( op->o_bd, &e->e_name );
@@ -207,6 +210,7 @@ mdb_dn2id_delete(
 	ID id,
 	ID nsubs )
 {
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
 	ID nid;
 	char *ptr;
 	int rc;
@@ -214,6 +218,9 @@ mdb_dn2id_delete(
 	Debug( LDAP_DEBUG_TRACE, "=> mdb_dn2id_delete 0x%lx\n",
 		id, 0, 0 );
 
+	/* for the search candidate cache */
+	mdb->mi_dn2id_lastmod = mdb_txn_id( mdb_cursor_txn( mc ));
+
 	/* Delete our ID from the parent's list */
 	rc = mdb_cursor_del( mc, 0 );
 
@@ -549,6 +556,71 @@ mdb_dn2id_children(
 	return rc;
 }
 
+/* Return the number of immediate children and the number of
+ * descendants of an entry. The former is the number of child
+ * records under the entry's ID, the latter is the subtree count
+ * kept in the entry's record under its parent, less the entry
+ * itself. Either pointer may be NULL.
+ */
+int
+mdb_dn2id_counts(
+	Operation *op,
+	MDB_txn *txn,
+	Entry *e,
+	ID *nkids,
+	ID *nsubs )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	MDB_val		key, data;
+	MDB_cursor	*cursor;
+	int		rc;
+	ID		id;
+
+	rc = mdb_cursor_open( txn, mdb->mi_dn2id, &cursor );
+	if ( rc ) return rc;
+
+	if ( nkids ) {
+		size_t dkids = 0;
+
+		key.mv_size = sizeof(ID);
+		key.mv_data = &id;
+		id = e->e_id;
+		rc = mdb_cursor_get( cursor, &key, &data, MDB_SET );
+		if ( rc == 0 )
+			rc = mdb_cursor_count( cursor, &dkids );
+		if ( rc == MDB_NOTFOUND && !e->e_id ) {
+			/* nothing was ever added at the top */
+			rc = 0;
+		}
+		if ( rc ) goto done;
+		/* Besides its children, an entry's ID holds its own node;
+		 * entryID 0 has none, but the dummy root node that
+		 * mdb_dn2id_add() writes with the first top-level entry
+		 * takes its place.
+		 */
+		*nkids = dkids ? dkids - 1 : 0;
+	}
+
+	if ( nsubs && !e->e_id ) {
+		/* no subtree count is kept for entryID 0; like search,
+		 * take the number of entries from id2entry instead */
+		MDB_stat ms;
+		rc = mdb_stat( txn, mdb->mi_id2entry, &ms );
+		if ( rc == 0 )
+			*nsubs = ms.ms_entries;
+	} else if ( nsubs ) {
+		rc = mdb_dn2id( op, txn, cursor, &e->e_nname, &id, nsubs, NULL, NULL );
+		if ( rc == 0 && id != e->e_id )
+			rc = MDB_NOTFOUND;
+		if ( rc == 0 && *nsubs )
+			(*nsubs)--;
+	}
+
+done:
+	mdb_cursor_close( cursor );
+	return rc;
+}
+
 int
 mdb_id2name(
 	Operation *op,
@@ -616,6 +688,83 @@ mdb_id2name(
 	return rc;
 }
 
+/* Like mdb_id2name(), for callers visiting many entries in ID order.
+ * Siblings tend to come together, so the DN of the last parent seen
+ * is kept in *pid, pdn and pndn and reused instead of walking up the
+ * tree for each entry. *pid must start out as NOID.
+ */
+int
+mdb_id2name_sibling(
+	Operation *op,
+	MDB_txn *txn,
+	MDB_cursor **mcp,
+	ID id,
+	ID *pid,
+	struct berval *pdn,
+	struct berval *pndn,
+	struct berval *dn,
+	struct berval *ndn )
+{
+	MDB_val key, data;
+	diskNode *d;
+	char *ptr;
+	unsigned int nrlen, rlen;
+	ID nid;
+	int rc;
+
+	if ( !*mcp ) {
+		struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+		rc = mdb_cursor_open( txn, mdb->mi_dn2id, mcp );
+		if ( rc ) return rc;
+	}
+
+	key.mv_size = sizeof(ID);
+	key.mv_data = &id;
+	rc = mdb_cursor_get( *mcp, &key, &data, MDB_SET );
+	if ( rc ) return rc;
+	ptr = (char *)data.mv_data + data.mv_size - sizeof(ID);
+	memcpy( &nid, ptr, sizeof(ID) );
+	d = data.mv_data;
+	nrlen = (d->nrdnlen[0] << 8) | d->nrdnlen[1];
+	rlen = data.mv_size - sizeof(diskNode) - nrlen;
+
+	if ( nid != *pid ) {
+		op->o_tmpfree( pdn->bv_val, op->o_tmpmemctx );
+		op->o_tmpfree( pndn->bv_val, op->o_tmpmemctx );
+		BER_BVZERO( pdn );
+		BER_BVZERO( pndn );
+		*pid = NOID;
+		if ( nid ) {
+			/* data stays valid, the page is in the txn's snapshot */
+			rc = mdb_id2name( op, txn, mcp, nid, pdn, pndn );
+			if ( rc ) return rc;
+		}
+		*pid = nid;
+	}
+
+	dn->bv_len = rlen;
+	ndn->bv_len = nrlen;
+	if ( pdn->bv_len ) {
+		dn->bv_len += pdn->bv_len + 1;
+		ndn->bv_len += pndn->bv_len + 1;
+	}
+	dn->bv_val = op->o_tmpalloc( dn->bv_len + 1, op->o_tmpmemctx );
+	ndn->bv_val = op->o_tmpalloc( ndn->bv_len + 1, op->o_tmpmemctx );
+	ptr = lutil_strncopy( dn->bv_val, d->nrdn + nrlen + 1, rlen );
+	if ( pdn->bv_len ) {
+		*ptr++ = ',';
+		ptr = lutil_strcopy( ptr, pdn->bv_val );
+	}
+	*ptr = '\0';
+	ptr = lutil_strncopy( ndn->bv_val, d->nrdn, nrlen );
+	if ( pndn->bv_len ) {
+		*ptr++ = ',';
+		ptr = lutil_strcopy( ptr, pndn->bv_val );
+	}
+	*ptr = '\0';
+	return 0;
+}
+
 /* Find each id in ids that is a child of base and move it to res.
  */
 int
@@ -97,6 +97,73 @@ ava_comp_candidates (
 		ID *stack);
 #endif
 
+/* reserve a line in the EXPLAIN plan; it is filled in by explain_line()
+ * once the term has been evaluated, so parents precede their children
+ */
+static int
+explain_slot( Operation *op, mdb_explain *mx )
+{
+	mx->mx_plan = op->o_tmprealloc( mx->mx_plan,
+		( mx->mx_nplan + 1 ) * sizeof( struct berval ), op->o_tmpmemctx );
+	BER_BVZERO( &mx->mx_plan[mx->mx_nplan] );
+	return mx->mx_nplan++;
+}
+
+static void
+explain_line(
+	Operation *op,
+	mdb_explain *mx,
+	int slot,
+	int depth,
+	Filter *f,
+	ID *ids,
+	ID cost )
+{
+	struct berval fstr, *bv = &mx->mx_plan[slot];
+	char tail[ 96 ], *ptr;
+	int len = 0;
+
+	switch ( f->f_choice ) {
+	case LDAP_FILTER_AND:
+		BER_BVSTR( &fstr, "&" );
+		break;
+	case LDAP_FILTER_OR:
+		BER_BVSTR( &fstr, "|" );
+		break;
+	default:
+		filter2bv_x( op, f, &fstr );
+		break;
+	}
+
+	if ( ids == NULL ) {
+		len = snprintf( tail, sizeof( tail ), ": skipped" );
+	} else if ( MDB_IDL_IS_RANGE( ids )) {
+		len = snprintf( tail, sizeof( tail ), ": range %lu-%lu",
+			(unsigned long) MDB_IDL_FIRST( ids ),
+			(unsigned long) MDB_IDL_LAST( ids ));
+	} else {
+		len = snprintf( tail, sizeof( tail ), ": %lu ids",
+			(unsigned long) MDB_IDL_N( ids ));
+	}
+	if ( cost == MDB_COST_ALL ) {
+		len += snprintf( tail + len, sizeof( tail ) - len,
+			" (not indexed)" );
+	} else if ( cost != MDB_COST_UNKNOWN ) {
+		len += snprintf( tail + len, sizeof( tail ) - len,
+			" (est %lu)", (unsigned long) cost );
+	}
+
+	bv->bv_len = 2 * depth + fstr.bv_len + len;
+	ptr = bv->bv_val = op->o_tmpalloc( bv->bv_len + 1, op->o_tmpmemctx );
+	memset( ptr, ' ', 2 * depth );
+	ptr += 2 * depth;
+	ptr = lutil_strncopy( ptr, fstr.bv_val, fstr.bv_len );
+	ptr = lutil_strcopy( ptr, tail );
+
+	if ( f->f_choice != LDAP_FILTER_AND && f->f_choice != LDAP_FILTER_OR )
+		op->o_tmpfree( fstr.bv_val, op->o_tmpmemctx );
+}
+
 int
 mdb_filter_candidates(
 	Operation *op,
@@ -110,8 +177,19 @@ mdb_filter_candidates(
 #ifdef LDAP_COMP_MATCH
 	AttributeAliasing *aa;
 #endif
+	mdb_explain *mx = mdb_explain_get( op );
+	int xslot = 0;
+	ID xcost = MDB_COST_UNKNOWN;
+
 	Debug( LDAP_DEBUG_FILTER, "=> mdb_filter_candidates\n", 0, 0, 0 );
 
+	if ( mx ) {
+		xcost = mx->mx_cost;
+		mx->mx_cost = MDB_COST_UNKNOWN;
+		xslot = explain_slot( op, mx );
+		mx->mx_depth++;
+	}
+
 	if ( f->f_choice & SLAPD_FILTER_UNDEFINED ) {
 		MDB_IDL_ZERO( ids );
 		goto out;
@@ -238,6 +316,11 @@ mdb_filter_candidates(
 	}
 
 out:
+	if ( mx ) {
+		mx->mx_depth--;
+		explain_line( op, mx, xslot, mx->mx_depth, f, ids, xcost );
+	}
+
 	Debug( LDAP_DEBUG_FILTER,
 		"<= mdb_filter_candidates: id=%ld first=%ld last=%ld\n",
 		(long) ids[0],
@@ -558,6 +641,146 @@ base:
 	return 0;
 }
 
+/* Once an AND has narrowed the candidates to this many IDs, testing
+ * the entries directly is cheaper than reading more index keys.
+ */
+#define MDB_AND_CUTOFF	16
+
+typedef struct mdb_term {
+	Filter *mt_filter;
+	ID mt_cost;
+} mdb_term;
+
+static ID
+key_cost(
+	Operation *op,
+	MDB_txn *rtxn,
+	AttributeDescription *desc,
+	struct berval *value )
+{
+	MDB_dbi dbi;
+	slap_mask_t mask;
+	struct berval prefix = {0, NULL};
+	struct berval *keys = NULL;
+	MatchingRule *mr;
+	ID cost, n;
+	int i, rc;
+
+	if ( value == NULL ) {
+		if ( desc == slap_schema.si_ad_objectClass )
+			return MDB_COST_ALL;
+		rc = mdb_index_param( op->o_bd, desc, LDAP_FILTER_PRESENT,
+			&dbi, &mask, &prefix );
+		if ( rc != LDAP_SUCCESS )
+			return MDB_COST_ALL;
+		if ( prefix.bv_val == NULL )
+			return MDB_COST_UNKNOWN;
+		rc = mdb_key_count( op->o_bd, rtxn, dbi, &prefix, &cost );
+		if ( rc == MDB_NOTFOUND )
+			return 0;
+		return rc ? MDB_COST_UNKNOWN : cost;
+	}
+
+	if ( desc == slap_schema.si_ad_entryDN )
+		return 1;
+
+	rc = mdb_index_param( op->o_bd, desc, LDAP_FILTER_EQUALITY,
+		&dbi, &mask, &prefix );
+	if ( rc != LDAP_SUCCESS )
+		return MDB_COST_ALL;
+
+	mr = desc->ad_type->sat_equality;
+	if ( !mr || !mr->smr_filter )
+		return MDB_COST_ALL;
+
+	rc = (mr->smr_filter)( LDAP_FILTER_EQUALITY, mask,
+		desc->ad_type->sat_syntax, mr, &prefix, value,
+		&keys, op->o_tmpmemctx );
+	if ( rc != LDAP_SUCCESS || keys == NULL )
+		return MDB_COST_ALL;
+
+	/* the keys are intersected, so the smallest one bounds the result */
+	cost = MDB_COST_UNKNOWN;
+	for ( i = 0; keys[i].bv_val != NULL; i++ ) {
+		rc = mdb_key_count( op->o_bd, rtxn, dbi, &keys[i], &n );
+		if ( rc == MDB_NOTFOUND ) {
+			cost = 0;
+			break;
+		}
+		if ( rc == 0 && n < cost )
+			cost = n;
+	}
+	ber_bvarray_free_x( keys, op->o_tmpmemctx );
+
+	return cost;
+}
+
+static ID
+filter_cost(
+	Operation *op,
+	MDB_txn *rtxn,
+	Filter *f )
+{
+	Filter *l;
+	ID cost, c;
+
+	if ( f->f_choice & SLAPD_FILTER_UNDEFINED )
+		return 0;
+
+	switch ( f->f_choice ) {
+	case SLAPD_FILTER_COMPUTED:
+		return f->f_result == LDAP_COMPARE_TRUE ? MDB_COST_ALL : 0;
+
+	case LDAP_FILTER_PRESENT:
+		return key_cost( op, rtxn, f->f_desc, NULL );
+
+	case LDAP_FILTER_EQUALITY:
+#ifdef LDAP_COMP_MATCH
+		if ( is_aliased_attribute && is_aliased_attribute( f->f_ava->aa_desc ) )
+			return MDB_COST_UNKNOWN;
+#endif
+		return key_cost( op, rtxn, f->f_ava->aa_desc, &f->f_ava->aa_value );
+
+	case LDAP_FILTER_GE:
+	case LDAP_FILTER_LE:
+		if( f->f_ava->aa_desc->ad_type->sat_ordering &&
+			( f->f_ava->aa_desc->ad_type->sat_ordering->smr_usage & SLAP_MR_ORDERED_INDEX ) )
+			return MDB_COST_UNKNOWN;
+		return key_cost( op, rtxn, f->f_ava->aa_desc, NULL );
+
+	case LDAP_FILTER_NOT:
+		return MDB_COST_ALL;
+
+	case LDAP_FILTER_AND:
+		cost = MDB_COST_ALL;
+		for ( l = f->f_and; l; l = l->f_next ) {
+			if ( l->f_choice == SLAPD_FILTER_COMPUTED &&
+				l->f_result == LDAP_SUCCESS )
+				continue;
+			c = filter_cost( op, rtxn, l );
+			if ( c < cost )
+				cost = c;
+			if ( cost == 0 )
+				break;
+		}
+		return cost;
+
+	case LDAP_FILTER_OR:
+		cost = 0;
+		for ( l = f->f_or; l; l = l->f_next ) {
+			c = filter_cost( op, rtxn, l );
+			if ( c >= MDB_COST_UNKNOWN - cost )
+				return c == MDB_COST_ALL ? MDB_COST_ALL : MDB_COST_UNKNOWN;
+			cost += c;
+		}
+		return cost;
+
+	default:
+		/* substrings, approx, extensible */
+		return MDB_COST_UNKNOWN;
+	}
+}
+
 static int
 list_candidates(
 	Operation *op,
@@ -569,15 +792,58 @@ list_candidates(
 	ID *save )
 {
 	int rc = 0;
+	int i, j, n, first = 1;
 	Filter	*f;
+	mdb_term *terms, term;
+	mdb_explain *mx = mdb_explain_get( op );
 
 	Debug( LDAP_DEBUG_FILTER, "=> mdb_list_candidates 0x%x\n", ftype, 0, 0 );
-	for ( f = flist; f != NULL; f = f->f_next ) {
+
+	for ( n = 0, f = flist; f != NULL; f = f->f_next ) {
 		/* ignore precomputed scopes */
 		if ( f->f_choice == SLAPD_FILTER_COMPUTED &&
 		     f->f_result == LDAP_SUCCESS ) {
 			continue;
 		}
+		n++;
+	}
+	if ( n == 0 )
+		goto done;
+
+	/* Evaluate the cheapest terms first. For AND this shrinks the
+	 * intersection early; for OR an unindexed term makes the whole
+	 * union ALL, so there's no point reading the others.
+	 */
+	terms = op->o_tmpalloc( n * sizeof(mdb_term), op->o_tmpmemctx );
+	for ( i = 0, f = flist; f != NULL; f = f->f_next ) {
+		if ( f->f_choice == SLAPD_FILTER_COMPUTED &&
+		     f->f_result == LDAP_SUCCESS ) {
+			continue;
+		}
+		term.mt_filter = f;
+		term.mt_cost = n > 1 ? filter_cost( op, rtxn, f ) : 0;
+		/* insertion sort, keeping the client's order for ties */
+		for ( j = i; j > 0 && terms[j-1].mt_cost > term.mt_cost; j-- )
+			terms[j] = terms[j-1];
+		terms[j] = term;
+		i++;
+	}
+
+	if ( ftype == LDAP_FILTER_OR && terms[n-1].mt_cost == MDB_COST_ALL ) {
+		Debug( LDAP_DEBUG_FILTER,
+			"<= mdb_list_candidates: OR term not indexed\n", 0, 0, 0 );
+		MDB_IDL_ALL( ids );
+		for ( i = 0; mx && i < n; i++ ) {
+			explain_line( op, mx, explain_slot( op, mx ), mx->mx_depth,
+				terms[i].mt_filter, NULL, terms[i].mt_cost );
+		}
+		goto freeterms;
+	}
+
+	for ( i = 0; i < n; i++ ) {
+		f = terms[i].mt_filter;
+		if ( mx )
+			mx->mx_cost = terms[i].mt_cost;
 		MDB_IDL_ZERO( save );
 		rc = mdb_filter_candidates( op, rtxn, f, save, tmp,
 			save+MDB_IDL_UM_SIZE );
@@ -590,24 +856,40 @@ list_candidates(
 			break;
 		}
 
-		
+		if ( first ) {
+			MDB_IDL_CPY( ids, save );
+			first = 0;
+		} else if ( ftype == LDAP_FILTER_AND ) {
+			mdb_idl_intersection( ids, save );
+		} else {
+			mdb_idl_union( ids, save );
+		}
+
 		if ( ftype == LDAP_FILTER_AND ) {
-			if ( f == flist ) {
-				MDB_IDL_CPY( ids, save );
-			} else {
-				mdb_idl_intersection( ids, save );
-			}
 			if( MDB_IDL_IS_ZERO( ids ) )
 				break;
-		} else {
-			if ( f == flist ) {
-				MDB_IDL_CPY( ids, save );
-			} else {
-				mdb_idl_union( ids, save );
+			/* the search tests every candidate against the
+			 * filter anyway, so a small superset is fine
+			 */
+			if ( MDB_IDL_N( ids ) <= MDB_AND_CUTOFF && i < n-1 ) {
+				Debug( LDAP_DEBUG_FILTER,
+					"<= mdb_list_candidates: %ld candidates, "
+					"skipping %d terms\n",
+					(long) MDB_IDL_N( ids ), n-1-i, 0 );
+				for ( i++; mx && i < n; i++ ) {
+					explain_line( op, mx, explain_slot( op, mx ),
+						mx->mx_depth, terms[i].mt_filter, NULL,
+						terms[i].mt_cost );
+				}
+				break;
 			}
 		}
 	}
 
+freeterms:
+	op->o_tmpfree( terms, op->o_tmpmemctx );
+
+done:
 	if( rc == LDAP_SUCCESS ) {
 		Debug( LDAP_DEBUG_FILTER,
 			"<= mdb_list_candidates: id=%ld first=%ld last=%ld\n",
@@ -944,6 +1226,80 @@ approx_candidates(
 	return( rc );
 }
 
+/* Narrow ids by the positional n-gram keys of one substring component.
+ * Within each alignment all the n-grams must be present; any alignment
+ * will do, except that an initial component can only be at offset 0.
+ */
+static int
+ngram_candidates(
+	Operation *op,
+	MDB_txn *rtxn,
+	MDB_dbi dbi,
+	MatchingRule *mr,
+	AttributeDescription *desc,
+	struct berval *prefix,
+	struct berval *value,
+	int initial,
+	ID *ids,
+	ID *comp,
+	ID *tmp )
+{
+	ID *grp = comp + MDB_IDL_UM_SIZE;
+	struct berval *keys = NULL;
+	int i, o, m, ngroups, rc;
+
+	rc = (mr->smr_ngram)(
+		desc->ad_type->sat_syntax,
+		mr,
+		prefix,
+		value,
+		&keys, op->o_tmpmemctx );
+
+	if ( rc != LDAP_SUCCESS || keys == NULL ) {
+		/* too short; nothing to add */
+		return 0;
+	}
+
+	for ( m = 0; keys[m].bv_val != NULL; m++ )
+		;
+	m /= SLAP_INDEX_SUBSTR_NGRAM_POS;
+	ngroups = initial ? 1 : SLAP_INDEX_SUBSTR_NGRAM_POS;
+
+	MDB_IDL_ZERO( comp );
+	for ( o = 0; o < ngroups; o++ ) {
+		for ( i = 0; i < m; i++ ) {
+			rc = mdb_key_read( op->o_bd, rtxn, dbi, &keys[o*m + i],
+				tmp, NULL, 0 );
+			if ( rc == MDB_NOTFOUND ) {
+				MDB_IDL_ZERO( grp );
+				rc = 0;
+				break;
+			} else if ( rc != LDAP_SUCCESS ) {
+				Debug( LDAP_DEBUG_TRACE,
+					"<= mdb_substring_candidates: (%s) "
+					"ngram key read failed (%d)\n",
+					desc->ad_cname.bv_val, rc, 0 );
+				goto done;
+			}
+
+			if ( i == 0 ) {
+				MDB_IDL_CPY( grp, tmp );
+			} else {
+				mdb_idl_intersection( grp, tmp );
+			}
+			if ( MDB_IDL_IS_ZERO( grp ))
+				break;
+		}
+		mdb_idl_union( comp, grp );
+	}
+
+	mdb_idl_intersection( ids, comp );
+
+done:
+	ber_bvarray_free_x( keys, op->o_tmpmemctx );
+	return rc;
+}
+
 static int
 substring_candidates(
 	Operation *op,
@@ -1014,10 +1370,12 @@ substring_candidates(
 		Debug( LDAP_DEBUG_TRACE,
 			"<= mdb_substring_candidates: (0x%04lx) no keys (%s)\n",
 			mask, sub->sa_desc->ad_cname.bv_val, 0 );
-		return 0;
+		if (( mask & SLAP_INDEX_SUBSTR_NGRAM ) != SLAP_INDEX_SUBSTR_NGRAM ||
+			!mr->smr_ngram )
+			return 0;
 	}
 
-	for ( i= 0; keys[i].bv_val != NULL; i++ ) {
+	for ( i= 0; keys && keys[i].bv_val != NULL; i++ ) {
 		rc = mdb_key_read( op->o_bd, rtxn, dbi, &keys[i], tmp, NULL, 0 );
 
 		if( rc == MDB_NOTFOUND ) {
@@ -1050,7 +1408,38 @@ substring_candidates(
 			break;
 	}
 
-	ber_bvarray_free_x( keys, op->o_tmpmemctx );
+	if ( keys )
+		ber_bvarray_free_x( keys, op->o_tmpmemctx );
+
+	if ( rc == LDAP_SUCCESS && !MDB_IDL_IS_ZERO( ids ) &&
+		( mask & SLAP_INDEX_SUBSTR_NGRAM ) == SLAP_INDEX_SUBSTR_NGRAM &&
+		mr->smr_ngram )
+	{
+		ID *comp = ch_malloc( 2 * MDB_IDL_UM_SIZEOF );
+		struct berval *value;
+
+		value = &sub->sa_initial;
+		if ( !BER_BVISNULL( value ))
+			rc = ngram_candidates( op, rtxn, dbi, mr, sub->sa_desc,
+				&prefix, value, 1, ids, comp, tmp );
+
+		for ( i = 0; rc == LDAP_SUCCESS && !MDB_IDL_IS_ZERO( ids ) &&
+			sub->sa_any && !BER_BVISNULL( &sub->sa_any[i] ); i++ )
+		{
+			rc = ngram_candidates( op, rtxn, dbi, mr, sub->sa_desc,
+				&prefix, &sub->sa_any[i], 0, ids, comp, tmp );
+		}
+
+		value = &sub->sa_final;
+		if ( rc == LDAP_SUCCESS && !MDB_IDL_IS_ZERO( ids ) &&
+			!BER_BVISNULL( value ))
+		{
+			rc = ngram_candidates( op, rtxn, dbi, mr, sub->sa_desc,
+				&prefix, value, 0, ids, comp, tmp );
+		}
+
+		ch_free( comp );
+	}
 
 	Debug( LDAP_DEBUG_TRACE, "<= mdb_substring_candidates: %ld, first=%ld, last=%ld\n",
 		(long) ids[0],
@@ -392,12 +392,14 @@ int mdb_id2entry(
 {
 	MDB_val key, data;
 	int rc = 0;
+	struct timeval tv;
 
 	*e = NULL;
 
 	key.mv_data = &id;
 	key.mv_size = sizeof(ID);
 
+	SLAP_PHASE_BEGIN( tv );
 	/* fetch it */
 	rc = mdb_cursor_get( mc, &key, &data, MDB_SET );
 	if ( rc == MDB_NOTFOUND ) {
@@ -438,6 +440,7 @@ int mdb_id2entry(
 	if ( rc ) return rc;
 
 	rc = mdb_entry_decode( op, mdb_cursor_txn( mc ), &data, id, e );
+	SLAP_PHASE_END( op, SLAP_PHASE_ENTRY, tv );
 	if ( rc ) return rc;
 
 	(*e)->e_id = id;
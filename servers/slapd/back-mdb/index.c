@@ -180,6 +180,9 @@ static int indexer(
 
 	assert( mask != 0 );
 
+	/* for the search candidate cache */
+	ai->ai_lastmod = mdb_txn_id( txn );
+
 	if ( !mc ) {
 		err = "c_open";
 		rc = mdb_cursor_open( txn, ai->ai_dbi, &mc );
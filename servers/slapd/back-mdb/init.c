@@ -67,6 +67,8 @@ mdb_db_init( BackendDB *be, ConfigReply *cr )
 	mdb->mi_multi_hi = UINT_MAX;
 	mdb->mi_multi_lo = UINT_MAX;
 
+	ldap_pvt_thread_mutex_init( &mdb->mi_sc_mutex );
+
 	be->be_private = mdb;
 	be->be_cf_ocs = be->bd_info->bi_cf_ocs;
 
@@ -172,8 +174,9 @@ mdb_db_open( BackendDB *be, ConfigReply *cr )
 	if ( slapMode & SLAP_TOOL_QUICK )
 		flags |= MDB_NOSYNC|MDB_WRITEMAP;
 
+	/* MDB_NOTLS lets mdb_tool_entry_scan() hand read txns to its threads */
 	if ( slapMode & SLAP_TOOL_READONLY)
-		flags |= MDB_RDONLY;
+		flags |= MDB_RDONLY|MDB_NOTLS;
 
 	rc = mdb_env_open( mdb->mi_dbenv, dbhome,
 			flags, mdb->mi_dbenv_mode );
@@ -186,6 +189,21 @@ mdb_db_open( BackendDB *be, ConfigReply *cr )
 		goto fail;
 	}
 
+	/* Reclaim reader slots left behind by slapd or tool processes
+	 * that exited without releasing them; they would otherwise pin
+	 * old snapshots and keep freed pages from being reused.
+	 */
+	{
+		int dead = 0;
+		mdb_reader_check( mdb->mi_dbenv, &dead );
+		if ( dead ) {
+			Debug( LDAP_DEBUG_ANY,
+				LDAP_XSTRING(mdb_db_open) ": database \"%s\": "
+				"cleared %d stale reader slots\n",
+				be->be_suffix[0].bv_val, dead, 0 );
+		}
+	}
+
 	rc = mdb_txn_begin( mdb->mi_dbenv, NULL, flags & MDB_RDONLY, &txn );
 	if ( rc ) {
 		Debug( LDAP_DEBUG_ANY,
@@ -319,6 +337,9 @@ mdb_db_close( BackendDB *be, ConfigReply *cr )
 
 	mdb->mi_flags &= ~MDB_IS_OPEN;
 
+	/* cached candidates refer to the AttrInfo of each index */
+	mdb_scache_flush( mdb );
+
 	if( mdb->mi_dbenv ) {
 		mdb_reader_flush( mdb->mi_dbenv );
 	}
@@ -375,6 +396,9 @@ mdb_db_destroy( BackendDB *be, ConfigReply *cr )
 
 	mdb_attr_index_destroy( mdb );
 
+	mdb_scache_flush( mdb );
+	ldap_pvt_thread_mutex_destroy( &mdb->mi_sc_mutex );
+
 	ch_free( mdb );
 	be->be_private = NULL;
 
@@ -396,6 +420,7 @@ mdb_back_initialize(
 		LDAP_CONTROL_POST_READ,
 		LDAP_CONTROL_SUBENTRIES,
 		LDAP_CONTROL_X_PERMISSIVE_MODIFY,
+		LDAP_CONTROL_X_EXPLAIN,
 #ifdef LDAP_X_TXN
 		LDAP_CONTROL_X_TXN_SPEC,
 #endif
@@ -415,6 +440,20 @@ mdb_back_initialize(
 
 	bi->bi_controls = controls;
 
+	rc = register_supported_control2( LDAP_CONTROL_X_EXPLAIN,
+		SLAP_CTRL_SEARCH, NULL, mdb_explain_parse, 1, &mdb_explain_cid );
+	if ( rc != LDAP_SUCCESS ) {
+		Debug( LDAP_DEBUG_ANY,
+			LDAP_XSTRING(mdb_back_initialize) ": "
+			"unable to register explain control (%d)\n", rc, 0, 0 );
+		return rc;
+	}
+
+	rc = mdb_operational_initialize();
+	if ( rc ) {
+		return rc;
+	}
+
 	{	/* version check */
 		int major, minor, patch, ver;
 		char *version = mdb_version( &major, &minor, &patch );
@@ -490,6 +529,7 @@ mdb_back_initialize(
 	bi->bi_tool_dn2id_get = mdb_tool_dn2id_get;
 	bi->bi_tool_entry_modify = mdb_tool_entry_modify;
 	bi->bi_tool_entry_delete = mdb_tool_entry_delete;
+	bi->bi_tool_entry_scan = mdb_tool_entry_scan;
 
 	bi->bi_connection_init = 0;
 	bi->bi_connection_destroy = 0;
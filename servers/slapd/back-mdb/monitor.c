@@ -32,6 +32,22 @@
 static ObjectClass		*oc_olmMDBDatabase;
 
 static AttributeDescription *ad_olmDbDirectory;
+static AttributeDescription *ad_olmMDBIndexStats;
+
+static int
+mdb_monitor_idxstats_entry_add(
+	Operation	*op,
+	struct mdb_info	*mdb,
+	Entry		*e );
+
+static int
+mdb_monitor_snapshot(
+	Operation	*op,
+	BackendDB	*be,
+	void		*priv,
+	const char	*labels,
+	char		*buf,
+	int		len );
 
 #ifdef MDB_MONITOR_IDX
 static int
@@ -88,6 +104,17 @@ static struct {
 		&ad_olmDbNotIndexed },
 #endif /* MDB_MONITOR_IDX */
 
+	/* olmMDBAttributes shares its arc with back-bdb's
+	 * olmBDBAttributes, which uses 1 through 3 */
+	{ "( olmMDBAttributes:4 "
+		"NAME ( 'olmMDBIndexStats' ) "
+		"DESC 'Key count and posting list length histogram "
+			"of each attribute index' "
+		"SUP monitoredInfo "
+		"NO-USER-MODIFICATION "
+		"USAGE dSAOperation )",
+		&ad_olmMDBIndexStats },
+
 	{ NULL }
 };
 
@@ -105,6 +132,7 @@ static struct {
 #ifdef MDB_MONITOR_IDX
 			"$ olmDbNotIndexed "
 #endif /* MDB_MONITOR_IDX */
+			"$ olmMDBIndexStats "
 			") )",
 		&oc_olmMDBDatabase },
 
@@ -118,12 +146,21 @@ mdb_monitor_update(
 	Entry		*e,
 	void		*priv )
 {
-#ifdef MDB_MONITOR_IDX
 	struct mdb_info		*mdb = (struct mdb_info *) priv;
 
+#ifdef MDB_MONITOR_IDX
 	mdb_monitor_idx_entry_add( mdb, e );
 #endif /* MDB_MONITOR_IDX */
 
+	/* walking the indices is not free; only do it when asked to */
+	if ( op->o_tag == LDAP_REQ_SEARCH &&
+		ad_inlist( ad_olmMDBIndexStats, op->ors_attrs ) )
+	{
+		mdb_monitor_idxstats_entry_add( op, mdb, e );
+	} else {
+		attr_delete( &e->e_attrs, ad_olmMDBIndexStats );
+	}
+
 	return SLAP_CB_CONTINUE;
 }
 
@@ -390,6 +427,10 @@ mdb_monitor_db_open( BackendDB *be )
 		rc = mbe->register_entry_attrs( &mdb->mi_monitor.mdm_ndn, a, cb,
 			NULL, -1, NULL );
 	}
+	if ( rc == 0 ) {
+		(void)mbe->register_snapshot( be, mdb_monitor_snapshot,
+			(void *)mdb );
+	}
 
 cleanup:;
 	if ( rc != 0 ) {
@@ -433,6 +474,7 @@ mdb_monitor_db_close( BackendDB *be )
 			mbe->unregister_entry_callback( &mdb->mi_monitor.mdm_ndn,
 				(monitor_callback_t *)mdb->mi_monitor.mdm_cb,
 				NULL, 0, NULL );
+			mbe->unregister_snapshot( be );
 		}
 
 		memset( &mdb->mi_monitor, 0, sizeof( mdb->mi_monitor ) );
@@ -458,6 +500,180 @@ mdb_monitor_db_destroy( BackendDB *be )
 	return 0;
 }
 
+#define MDB_IDXSTATS_BUCKETS	(6)
+
+static const char *idxstats_bucket[MDB_IDXSTATS_BUCKETS] = {
+	"1", "<10", "<100", "<1000", "<10000", ">=10000"
+};
+
+static int
+mdb_monitor_idxstats_entry_add(
+	Operation	*op,
+	struct mdb_info	*mdb,
+	Entry		*e )
+{
+	mdb_op_info	opinfo = {{{0}}}, *moi = &opinfo;
+	BerVarray	vals = NULL;
+	int		i, b, rc;
+
+	rc = mdb_opinfo_get( op, mdb, 1, &moi );
+	if ( rc )
+		return rc;
+
+	for ( i = 0; i < mdb->mi_nattrs; i++ ) {
+		AttrInfo	*ai = mdb->mi_attrs[i];
+		MDB_cursor	*mc;
+		MDB_val		key, data;
+		unsigned long	hist[MDB_IDXSTATS_BUCKETS] = { 0 },
+				nkeys = 0, nids = 0, nranges = 0;
+		char		buf[ SLAP_TEXT_BUFLEN ];
+		struct berval	bv;
+
+		if ( !ai->ai_dbi || ( ai->ai_indexmask & MDB_INDEX_DELETING ))
+			continue;
+		if ( mdb_cursor_open( moi->moi_txn, ai->ai_dbi, &mc ))
+			continue;
+
+		for ( rc = mdb_cursor_get( mc, &key, &data, MDB_FIRST ); rc == 0;
+			rc = mdb_cursor_get( mc, &key, &data, MDB_NEXT_NODUP ))
+		{
+			ID id, lo, hi;
+			size_t n = 0;
+
+			memcpy( &id, data.mv_data, sizeof( ID ));
+			if ( id == 0 ) {
+				/* a range: 0, lo, hi */
+				if ( mdb_cursor_get( mc, &key, &data, MDB_NEXT_DUP ))
+					break;
+				memcpy( &lo, data.mv_data, sizeof( ID ));
+				if ( mdb_cursor_get( mc, &key, &data, MDB_NEXT_DUP ))
+					break;
+				memcpy( &hi, data.mv_data, sizeof( ID ));
+				n = hi - lo + 1;
+				nranges++;
+			} else {
+				mdb_cursor_count( mc, &n );
+			}
+			nkeys++;
+			nids += n;
+
+			if ( n <= 1 ) {
+				b = 0;
+			} else {
+				size_t lim;
+				for ( b = 1, lim = 10; b < MDB_IDXSTATS_BUCKETS - 1 && n >= lim;
+					b++, lim *= 10 )
+					;
+			}
+			hist[b]++;
+		}
+		mdb_cursor_close( mc );
+
+		bv.bv_val = buf;
+		bv.bv_len = snprintf( buf, sizeof( buf ),
+			"%s keys=%lu ids=%lu ranges=%lu",
+			ai->ai_desc->ad_cname.bv_val, nkeys, nids, nranges );
+		for ( b = 0; b < MDB_IDXSTATS_BUCKETS && bv.bv_len < sizeof( buf ); b++ ) {
+			bv.bv_len += snprintf( buf + bv.bv_len, sizeof( buf ) - bv.bv_len,
+				" %s:%lu", idxstats_bucket[b], hist[b] );
+		}
+		if ( bv.bv_len >= sizeof( buf ))
+			bv.bv_len = sizeof( buf ) - 1;
+		value_add_one( &vals, &bv );
+	}
+
+	if ( moi == &opinfo ) {
+		mdb_txn_reset( moi->moi_txn );
+		LDAP_SLIST_REMOVE( &op->o_extra, &moi->moi_oe, OpExtra, oe_next );
+	} else {
+		moi->moi_ref--;
+	}
+
+	attr_delete( &e->e_attrs, ad_olmMDBIndexStats );
+	if ( vals != NULL ) {
+		attr_merge_normalize( e, ad_olmMDBIndexStats, vals, NULL );
+		ber_bvarray_free( vals );
+	}
+
+	return 0;
+}
+
+/*
+ * environment and per-index counters for cn=Snapshot,cn=Monitor;
+ * unlike olmMDBIndexStats these only read the DB headers
+ */
+static int
+mdb_monitor_snapshot(
+	Operation	*op,
+	BackendDB	*be,
+	void		*priv,
+	const char	*labels,
+	char		*buf,
+	int		len )
+{
+	struct mdb_info	*mdb = (struct mdb_info *) priv;
+	mdb_op_info	opinfo = {{{0}}}, *moi = &opinfo;
+	MDB_envinfo	mei;
+	MDB_stat	mst;
+	int		i, n = 0;
+
+	if ( mdb_env_info( mdb->mi_dbenv, &mei ) == 0 &&
+		mdb_env_stat( mdb->mi_dbenv, &mst ) == 0 )
+	{
+		n += snprintf( buf + n, len - n,
+			"mdb_map_size{%s} %lu\n"
+			"mdb_pages_max{%s} %lu\n"
+			"mdb_pages_used{%s} %lu\n"
+			"mdb_readers_max{%s} %u\n"
+			"mdb_readers_used{%s} %u\n",
+			labels, (unsigned long)mei.me_mapsize,
+			labels, (unsigned long)( mei.me_mapsize / mst.ms_psize ),
+			labels, (unsigned long)( mei.me_last_pgno + 1 ),
+			labels, mei.me_maxreaders,
+			labels, mei.me_numreaders );
+		if ( n >= len )
+			return len - 1;
+	}
+
+	if ( mdb_opinfo_get( op, mdb, 1, &moi ))
+		return n;
+
+	if ( mdb_stat( moi->moi_txn, mdb->mi_id2entry, &mst ) == 0 ) {
+		n += snprintf( buf + n, len - n, "mdb_entries{%s} %lu\n",
+			labels, (unsigned long)mst.ms_entries );
+	}
+
+	for ( i = 0; i < mdb->mi_nattrs && n < len; i++ ) {
+		AttrInfo	*ai = mdb->mi_attrs[i];
+
+		if ( !ai->ai_dbi || ( ai->ai_indexmask & MDB_INDEX_DELETING ))
+			continue;
+		if ( mdb_stat( moi->moi_txn, ai->ai_dbi, &mst ))
+			continue;
+		n += snprintf( buf + n, len - n,
+			"mdb_index_items{%s,attr=\"%s\"} %lu\n",
+			labels, ai->ai_desc->ad_cname.bv_val,
+			(unsigned long)mst.ms_entries );
+	}
+
+	if ( mdb->mi_sc_max && n < len ) {
+		n += snprintf( buf + n, len - n,
+			"mdb_searchcache_hits{%s} %lu\n"
+			"mdb_searchcache_misses{%s} %lu\n",
+			labels, mdb->mi_sc_hits,
+			labels, mdb->mi_sc_misses );
+	}
+
+	if ( moi == &opinfo ) {
+		mdb_txn_reset( moi->moi_txn );
+		LDAP_SLIST_REMOVE( &op->o_extra, &moi->moi_oe, OpExtra, oe_next );
+	} else {
+		moi->moi_ref--;
+	}
+
+	return n < len ? n : len - 1;
+}
+
 #ifdef MDB_MONITOR_IDX
 
 #define MDB_MONITOR_IDX_TYPES	(4)
@@ -24,6 +24,87 @@
 #include "slap.h"
 #include "back-mdb.h"
 
+static AttributeDescription	*ad_numSubordinates;
+static AttributeDescription	*ad_numAllSubordinates;
+
+static struct {
+	char			*desc;
+	AttributeDescription	**ad;
+} s_at[] = {
+	{ "( 1.3.6.1.4.1.453.16.2.103 "
+		"NAME 'numSubordinates' "
+		"DESC 'Number of immediate subordinates' "
+		"EQUALITY integerMatch "
+		"ORDERING integerOrderingMatch "
+		"SYNTAX 1.3.6.1.4.1.1466.115.121.1.27 "
+		"SINGLE-VALUE "
+		"NO-USER-MODIFICATION "
+		"USAGE directoryOperation )",
+		&ad_numSubordinates },
+	{ "( 1.3.6.1.4.1.4203.666.1.61 "
+		"NAME 'numAllSubordinates' "
+		"DESC 'Number of entries below this entry' "
+		"EQUALITY integerMatch "
+		"ORDERING integerOrderingMatch "
+		"SYNTAX 1.3.6.1.4.1.1466.115.121.1.27 "
+		"SINGLE-VALUE "
+		"NO-USER-MODIFICATION "
+		"USAGE directoryOperation )",
+		&ad_numAllSubordinates },
+	{ NULL }
+};
+
+int
+mdb_operational_initialize( void )
+{
+	int i, code;
+
+	for ( i = 0; s_at[ i ].desc != NULL; i++ ) {
+		code = register_at( s_at[ i ].desc, s_at[ i ].ad, 1 );
+		if ( code != LDAP_SUCCESS ) {
+			Debug( LDAP_DEBUG_ANY,
+				LDAP_XSTRING(mdb_operational_initialize)
+				": register_at failed for attributeType (%s)\n",
+				s_at[ i ].desc, 0, 0 );
+			return code;
+		}
+	}
+
+	return 0;
+}
+
+/* like ad_inlist(), but "+" does not count */
+static int
+mdb_ad_named( AttributeDescription *ad, AttributeName *an )
+{
+	if ( an == NULL ) return 0;
+
+	for ( ; !BER_BVISNULL( &an->an_name ); an++ ) {
+		if ( an->an_desc == ad ) return 1;
+	}
+	return 0;
+}
+
+static Attribute *
+mdb_count_attr( AttributeDescription *ad, ID count )
+{
+	Attribute	*a;
+	char		buf[ LDAP_PVT_INTTYPE_CHARS(unsigned long) ];
+	struct berval	bv;
+
+	bv.bv_val = buf;
+	bv.bv_len = snprintf( buf, sizeof( buf ), "%lu", (unsigned long)count );
+
+	a = attr_alloc( ad );
+	a->a_numvals = 1;
+	a->a_vals = ch_malloc( 2 * sizeof( struct berval ) );
+	ber_dupbv( &a->a_vals[0], &bv );
+	BER_BVZERO( &a->a_vals[1] );
+	a->a_nvals = a->a_vals;
+
+	return a;
+}
+
 /*
  * sets *hasSubordinates to LDAP_COMPARE_TRUE/LDAP_COMPARE_FALSE
  * if the entry has children or not.
@@ -116,6 +197,51 @@ mdb_operational(
 		}
 	}
 
+	/* Subordinate counts are only returned when asked for by name */
+	for ( ; *ap; ap = &(*ap)->a_next )
+		/* go to the end */ ;
+
+	{
+		int wantkids = mdb_ad_named( ad_numSubordinates, rs->sr_attrs ) &&
+			attr_find( rs->sr_entry->e_attrs, ad_numSubordinates ) == NULL;
+		int wantsubs = mdb_ad_named( ad_numAllSubordinates, rs->sr_attrs ) &&
+			attr_find( rs->sr_entry->e_attrs, ad_numAllSubordinates ) == NULL;
+
+		if ( wantkids || wantsubs ) {
+			struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+			mdb_op_info	opinfo = {{{0}}}, *moi = &opinfo;
+			ID		nkids, nsubs;
+			int		rc;
+
+			rc = mdb_opinfo_get( op, mdb, 1, &moi );
+			if ( rc == 0 ) {
+				rc = mdb_dn2id_counts( op, moi->moi_txn, rs->sr_entry,
+					wantkids ? &nkids : NULL, wantsubs ? &nsubs : NULL );
+				if ( rc == 0 ) {
+					if ( wantkids ) {
+						*ap = mdb_count_attr( ad_numSubordinates, nkids );
+						ap = &(*ap)->a_next;
+					}
+					if ( wantsubs ) {
+						*ap = mdb_count_attr( ad_numAllSubordinates, nsubs );
+						ap = &(*ap)->a_next;
+					}
+				} else {
+					Debug( LDAP_DEBUG_ARGS,
+						"<=- " LDAP_XSTRING(mdb_operational)
+						": subordinate counts failed: %s (%d)\n",
+						mdb_strerror(rc), rc, 0 );
+				}
+				if ( moi == &opinfo ) {
+					mdb_txn_reset( moi->moi_txn );
+					LDAP_SLIST_REMOVE( &op->o_extra, &moi->moi_oe, OpExtra, oe_next );
+				} else {
+					moi->moi_ref--;
+				}
+			}
+		}
+	}
+
 	return LDAP_SUCCESS;
 }
 
@@ -105,6 +105,13 @@ int mdb_dn2id_children(
 	MDB_txn *tid,
 	Entry *e );
 
+int mdb_dn2id_counts(
+	Operation *op,
+	MDB_txn *tid,
+	Entry *e,
+	ID *nkids,
+	ID *nsubs );
+
 int mdb_dn2sups (
 	Operation *op,
 	MDB_txn *tid,
@@ -134,6 +141,17 @@ int mdb_id2name(
 	struct berval *name,
 	struct berval *nname);
 
+int mdb_id2name_sibling(
+	Operation *op,
+	MDB_txn *txn,
+	MDB_cursor **cursp,
+	ID eid,
+	ID *pid,
+	struct berval *pdn,
+	struct berval *pndn,
+	struct berval *name,
+	struct berval *nname );
+
 int mdb_idscope(
 	Operation *op,
 	MDB_txn *txn,
@@ -332,6 +350,14 @@ mdb_key_read(
     MDB_cursor **saved_cursor,
         int get_flags );
 
+extern int
+mdb_key_count(
+	Backend	*be,
+	MDB_txn *txn,
+	MDB_dbi dbi,
+	struct berval *k,
+	ID *count );
+
 /*
  * nextid.c
  */
@@ -368,6 +394,23 @@ mdb_monitor_idx_add(
 	slap_mask_t		type );
 #endif /* MDB_MONITOR_IDX */
 
+/*
+ * searchcache.c
+ */
+
+int mdb_scache_get( Operation *op, MDB_txn *txn, ID *ids );
+void mdb_scache_put( Operation *op, MDB_txn *txn, ID *ids );
+void mdb_scache_flush( struct mdb_info *mdb );
+
+/*
+ * search.c
+ */
+
+int mdb_explain_parse(
+	Operation *op,
+	SlapReply *rs,
+	LDAPControl *ctrl );
+
 /*
  * former external.h
  */
@@ -391,12 +434,15 @@ extern BI_operational			mdb_operational;
 
 extern BI_has_subordinates 		mdb_hasSubordinates;
 
+int mdb_operational_initialize( void );
+
 /* tools.c */
 extern BI_tool_entry_open		mdb_tool_entry_open;
 extern BI_tool_entry_close		mdb_tool_entry_close;
 extern BI_tool_entry_first_x		mdb_tool_entry_first_x;
 extern BI_tool_entry_next		mdb_tool_entry_next;
 extern BI_tool_entry_get		mdb_tool_entry_get;
+extern BI_tool_entry_scan		mdb_tool_entry_scan;
 extern BI_tool_entry_put		mdb_tool_entry_put;
 extern BI_tool_entry_reindex		mdb_tool_entry_reindex;
 extern BI_tool_dn2id_get		mdb_tool_dn2id_get;
@@ -18,6 +18,10 @@
 
 #include <stdio.h>
 #include <ac/string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "back-mdb.h"
 #include "idl.h"
@@ -38,6 +42,11 @@ static int search_candidates(
 
 static int parse_paged_cookie( Operation *op, SlapReply *rs );
 
+static int explain_ctrl_add( Operation *op, SlapReply *rs,
+	mdb_explain *mx, ID ncand, LDAPControl **ctrls );
+
+int mdb_explain_cid;
+
 static void send_paged_response( 
 	Operation *op,
 	SlapReply *rs,
@@ -281,6 +290,51 @@ mdb_get_nextid(MDB_cursor *mci, ID *cursor)
 	return 0;
 }
 
+/* Ask the OS to start reading in the entries of the next few
+ * candidates, so that the disk reads overlap with processing of
+ * the current one instead of each faulting in turn. The lookup
+ * itself already faults in the leaf page, so this only gains
+ * anything for entries stored on overflow pages. *pfcursor
+ * tracks how far ahead of cursor we have already looked.
+ */
+static void
+mdb_prefetch( struct mdb_info *mdb, MDB_txn *txn, ID *ids, ID cursor,
+	ID *pfcursor )
+{
+#if defined(MADV_WILLNEED) || defined(POSIX_MADV_WILLNEED)
+	static uintptr_t pagemask;
+	MDB_val key, data;
+	uintptr_t ptr;
+	ID id;
+
+	if ( !pagemask )
+		pagemask = sysconf( _SC_PAGESIZE ) - 1;
+
+	if ( *pfcursor < cursor )
+		*pfcursor = cursor;
+	while ( *pfcursor - cursor < mdb->mi_prefetch ) {
+		id = mdb_idl_next( ids, pfcursor );
+		if ( id == NOID ) {
+			/* nothing left, stop looking */
+			*pfcursor = NOID - mdb->mi_prefetch;
+			break;
+		}
+		key.mv_data = &id;
+		key.mv_size = sizeof(ID);
+		if ( mdb_get( txn, mdb->mi_id2entry, &key, &data ))
+			continue;
+		ptr = (uintptr_t)data.mv_data & ~pagemask;
+#ifdef MADV_WILLNEED
+		madvise( (void *)ptr, (char *)data.mv_data + data.mv_size - (char *)ptr,
+			MADV_WILLNEED );
+#else
+		posix_madvise( (void *)ptr, (char *)data.mv_data + data.mv_size - (char *)ptr,
+			POSIX_MADV_WILLNEED );
+#endif
+	}
+#endif
+}
+
 static void scope_chunk_free( void *key, void *data )
 {
 	ID2 *p1, *p2;
@@ -326,6 +380,7 @@ typedef struct ww_ctx {
 	MDB_val data;
 	int flag;
 	int nentries;
+	time_t stamp;
 } ww_ctx;
 
 /* ITS#7904 if we get blocked while writing results to client,
@@ -369,6 +424,7 @@ mdb_waitfixup( Operation *op, ww_ctx *ww, MDB_cursor *mci, MDB_cursor *mcd, IdSc
 	MDB_val key;
 	int rc = 0;
 	ww->flag = 0;
+	ww->stamp = slap_get_time();
 	mdb_txn_renew( ww->txn );
 	mdb_cursor_renew( ww->txn, mci );
 	mdb_cursor_renew( ww->txn, mcd );
@@ -416,6 +472,8 @@ mdb_search( Operation *op, SlapReply *rs )
 	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
 	ID		id, cursor, nsubs, ncand, cscope;
 	ID		lastid = NOID;
+	ID		pfcursor = 0;
+	int		usecache;
 	ID		candidates[MDB_IDL_UM_SIZE];
 	ID		iscopes[MDB_IDL_DB_SIZE];
 	ID2		*scopes;
@@ -431,6 +489,9 @@ mdb_search( Operation *op, SlapReply *rs )
 	MDB_cursor	*mci, *mcd;
 	ww_ctx wwctx;
 	slap_callback cb = { 0 };
+	struct timeval	tv;
+	mdb_explain	mx, *explain = NULL;
+	LDAPControl	*xctrls[2];
 
 	mdb_op_info	opinfo = {{{0}}}, *moi = &opinfo;
 	MDB_txn			*ltid = NULL;
@@ -467,6 +528,13 @@ mdb_search( Operation *op, SlapReply *rs )
 	scopes = scope_chunk_get( op );
 	stack = search_stack( op );
 	isc.mt = ltid;
+
+	if ( op->o_ctrlflag[mdb_explain_cid] > SLAP_CONTROL_IGNORED ) {
+		memset( &mx, 0, sizeof( mx ));
+		mx.mx_cost = MDB_COST_UNKNOWN;
+		explain = &mx;
+		op->o_controls[mdb_explain_cid] = explain;
+	}
 	isc.mc = mcd;
 	isc.scopes = scopes;
 	isc.oscope = op->ors_scope;
@@ -663,8 +731,22 @@ dn2entry_retry:
 		scopes[0].mid = 1;
 		scopes[1].mid = base->e_id;
 		scopes[1].mval.mv_data = NULL;
-		rs->sr_err = search_candidates( op, rs, base,
-			&isc, mci, candidates, stack );
+		/* Alias dereferencing depends on the base and rewrites the
+		 * search scopes; EXPLAIN wants to see the real work. A txn
+		 * borrowed from a write op may see uncommitted changes.
+		 */
+		usecache = mdb->mi_sc_max && !explain && moi == &opinfo &&
+			!( op->ors_deref & LDAP_DEREF_SEARCHING );
+		SLAP_PHASE_BEGIN( tv );
+		if ( usecache && !mdb_scache_get( op, ltid, candidates )) {
+			rs->sr_err = LDAP_SUCCESS;
+		} else {
+			rs->sr_err = search_candidates( op, rs, base,
+				&isc, mci, candidates, stack );
+			if ( usecache && rs->sr_err == LDAP_SUCCESS )
+				mdb_scache_put( op, ltid, candidates );
+		}
+		SLAP_PHASE_END( op, SLAP_PHASE_CANDIDATES, tv );
 		ncand = MDB_IDL_N( candidates );
 		if ( !base->e_id || ncand == NOID ) {
 			/* grab entry count from id2entry stat
@@ -709,6 +791,7 @@ dn2entry_retry:
 
 	wwctx.flag = 0;
 	wwctx.nentries = 0;
+	wwctx.stamp = slap_get_time();
 	/* If we're running in our own read txn */
 	if (  moi == &opinfo ) {
 		cb.sc_writewait = mdb_writewait;
@@ -789,6 +872,9 @@ dn2entry_retry:
 
 loop_begin:
 
+		if ( mdb->mi_prefetch && nsubs >= ncand )
+			mdb_prefetch( mdb, ltid, candidates, cursor, &pfcursor );
+
 		/* check for abandon */
 		if ( op->o_abandon ) {
 			rs->sr_err = SLAPD_ABANDON;
@@ -1060,6 +1146,11 @@ notfound:
 
 		/* if it matches the filter and scope, send it */
 		rs->sr_err = test_filter( op, e, op->oq_search.rs_filter );
+		if ( explain ) {
+			explain->mx_tested++;
+			if ( rs->sr_err != LDAP_COMPARE_TRUE )
+				explain->mx_rejected++;
+		}
 
 		if ( rs->sr_err == LDAP_COMPARE_TRUE ) {
 			/* check size limit */
@@ -1120,11 +1211,20 @@ notfound:
 		}
 
 loop_continue:
-		if ( moi == &opinfo && !wwctx.flag && mdb->mi_rtxn_size ) {
+		if ( moi == &opinfo && !wwctx.flag &&
+			( mdb->mi_rtxn_size || mdb->mi_rtxn_maxage )) {
 			wwctx.nentries++;
-			if ( wwctx.nentries >= mdb->mi_rtxn_size ) {
+			/* Renew the snapshot after rtxnsize entries, or once it
+			 * is older than rtxnmaxage, so that a slow search does not
+			 * keep writers from reusing freed pages.
+			 */
+			if (( mdb->mi_rtxn_size &&
+					wwctx.nentries >= mdb->mi_rtxn_size ) ||
+				( mdb->mi_rtxn_maxage &&
+					slap_get_time() - wwctx.stamp >= mdb->mi_rtxn_maxage )) {
 				MDB_envinfo ei;
 				wwctx.nentries = 0;
+				wwctx.stamp = slap_get_time();
 				mdb_env_info(mdb->mi_dbenv, &ei);
 				if ( ei.me_last_txnid > mdb_txn_id( ltid ))
 					mdb_rtxn_snap( op, &wwctx );
@@ -1186,12 +1286,26 @@ nochange:
 	if ( get_pagedresults(op) > SLAP_CONTROL_IGNORED ) {
 		send_paged_response( op, rs, NULL, 0 );
 	} else {
+		if ( explain && explain_ctrl_add( op, rs, explain, ncand, xctrls ) == 0 )
+			rs->sr_ctrls = xctrls;
 		send_ldap_result( op, rs );
+		if ( rs->sr_ctrls == xctrls ) {
+			op->o_tmpfree( xctrls[0]->ldctl_value.bv_val, op->o_tmpmemctx );
+			op->o_tmpfree( xctrls[0], op->o_tmpmemctx );
+			rs->sr_ctrls = NULL;
+		}
 	}
 
 	rs->sr_err = LDAP_SUCCESS;
 
 done:
+	if ( explain ) {
+		int i;
+		op->o_controls[mdb_explain_cid] = NULL;
+		for ( i = 0; i < explain->mx_nplan; i++ )
+			op->o_tmpfree( explain->mx_plan[i].bv_val, op->o_tmpmemctx );
+		op->o_tmpfree( explain->mx_plan, op->o_tmpmemctx );
+	}
 	if ( cb.sc_private ) {
 		/* remove our writewait callback */
 		slap_callback **scp = &op->o_callback;
@@ -1499,3 +1613,76 @@ send_paged_response(
 done:
 	(void) ber_free_buf( ber );
 }
+
+int
+mdb_explain_parse(
+	Operation	*op,
+	SlapReply	*rs,
+	LDAPControl	*ctrl )
+{
+	if ( op->o_ctrlflag[mdb_explain_cid] != SLAP_CONTROL_NONE ) {
+		rs->sr_text = "explain control specified multiple times";
+		return LDAP_PROTOCOL_ERROR;
+	}
+
+	if ( !BER_BVISNULL( &ctrl->ldctl_value )) {
+		rs->sr_text = "explain control value not absent";
+		return LDAP_PROTOCOL_ERROR;
+	}
+
+	op->o_ctrlflag[mdb_explain_cid] = ctrl->ldctl_iscritical
+		? SLAP_CONTROL_CRITICAL
+		: SLAP_CONTROL_NONCRITICAL;
+
+	return LDAP_SUCCESS;
+}
+
+/* The response value is a SEQUENCE OF OCTET STRING: a summary line
+ * followed by one line per filter term, indented by nesting depth.
+ */
+static int
+explain_ctrl_add(
+	Operation	*op,
+	SlapReply	*rs,
+	mdb_explain	*mx,
+	ID		ncand,
+	LDAPControl	**ctrls )
+{
+	BerElementBuffer berbuf;
+	BerElement	*ber = (BerElement *)&berbuf;
+	char		buf[ SLAP_TEXT_BUFLEN ];
+	struct berval	bv;
+	int		i, rc = -1;
+
+	ber_init2( ber, NULL, LBER_USE_DER );
+	ber_set_option( ber, LBER_OPT_BER_MEMCTX, &op->o_tmpmemctx );
+
+	bv.bv_val = buf;
+	bv.bv_len = snprintf( buf, sizeof( buf ),
+		"candidates=%lu tested=%lu rejected=%lu returned=%d",
+		(unsigned long) ncand, mx->mx_tested, mx->mx_rejected,
+		rs->sr_nentries );
+
+	if ( ber_printf( ber, "{O" /*}*/, &bv ) == -1 )
+		goto done;
+	for ( i = 0; i < mx->mx_nplan; i++ ) {
+		if ( ber_printf( ber, "O", &mx->mx_plan[i] ) == -1 )
+			goto done;
+	}
+	if ( ber_printf( ber, /*{*/ "N}" ) == -1 )
+		goto done;
+
+	ctrls[0] = op->o_tmpalloc( sizeof(LDAPControl), op->o_tmpmemctx );
+	if ( ber_flatten2( ber, &ctrls[0]->ldctl_value, 1 ) == -1 ) {
+		op->o_tmpfree( ctrls[0], op->o_tmpmemctx );
+		goto done;
+	}
+	ctrls[0]->ldctl_oid = LDAP_CONTROL_X_EXPLAIN;
+	ctrls[0]->ldctl_iscritical = 0;
+	ctrls[1] = NULL;
+	rc = 0;
+
+done:
+	ber_free_buf( ber );
+	return rc;
+}
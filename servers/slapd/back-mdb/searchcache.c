@@ -0,0 +1,386 @@
+/* searchcache.c - back-mdb search candidate cache */
+/* $OpenLDAP$ */
+/* This work is part of OpenLDAP Software <http://www.openldap.org/>.
+ *
+ * Copyright 2000-2018 The OpenLDAP Foundation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* Applications often repeat the same searches, and for each of them
+ * search_candidates walks the same index keys and intersects the same
+ * IDLs. The resulting candidate list only depends on the filter, a few
+ * control flags, and the contents of the indices the filter uses (and
+ * of dn2id, for filters that fall back to the whole database), so it
+ * is kept here keyed by the filter string.
+ *
+ * Each cached list records the txnid it was computed at. Every index
+ * and dn2id remembers the id of the last write txn that changed it,
+ * set before that txn commits; a list is only reused by a reader at
+ * least as recent as the list, and only while none of the indices it
+ * depends on has changed since. test_filter() still runs on every
+ * candidate, so access control and the final match are unaffected.
+ */
+
+#include "portable.h"
+
+#include <stdio.h>
+#include <ac/string.h>
+
+#include "back-mdb.h"
+#include "idl.h"
+
+/* Larger candidate lists are not worth caching */
+#define MDB_SCACHE_MAXIDS	1024
+
+/* Filter terms a cached list depends on */
+#define MDB_SCACHE_MAXDEPS	32
+
+#define MDB_SC_MANAGEDSAIT	0x01
+#define MDB_SC_DOMAINSCOPE	0x02
+#define MDB_SC_SUBENTRIES	0x04
+
+typedef struct mdb_scentry {
+	struct mdb_scentry *se_next;	/* hash chain */
+	struct mdb_scentry *se_lru_prev;
+	struct mdb_scentry *se_lru_next;
+	unsigned se_hash;
+	int se_flags;
+	int se_dn2id;		/* also depends on dn2id */
+	int se_ndeps;
+	size_t se_txnid;
+	struct berval se_filter;
+	AttrInfo **se_deps;
+	ID *se_ids;
+} mdb_scentry;
+
+static unsigned
+mdb_scache_hash( struct berval *bv, int flags )
+{
+	unsigned h = 2166136261U ^ flags;
+	ber_len_t i;
+
+	for ( i = 0; i < bv->bv_len; i++ ) {
+		h ^= (unsigned char)bv->bv_val[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static int
+mdb_scache_flags( Operation *op )
+{
+	int flags = 0;
+
+	if ( get_manageDSAit( op ))
+		flags |= MDB_SC_MANAGEDSAIT;
+	if ( get_domainScope( op ))
+		flags |= MDB_SC_DOMAINSCOPE;
+	if ( get_subentries_visibility( op ))
+		flags |= MDB_SC_SUBENTRIES;
+	return flags;
+}
+
+static void
+mdb_scache_adddep( AttrInfo **deps, int *ndeps, int *dn2id, AttrInfo *ai )
+{
+	int i;
+
+	for ( i = 0; i < *ndeps; i++ )
+		if ( deps[i] == ai )
+			return;
+	if ( *ndeps < MDB_SCACHE_MAXDEPS )
+		deps[(*ndeps)++] = ai;
+	else
+		*dn2id = -1;	/* too many to track */
+}
+
+/* Collect the indices that the candidates for this filter are
+ * read from. Terms that are not resolved from an index yield all
+ * IDs, which depends on dn2id instead.
+ */
+static void
+mdb_scache_deps( Operation *op, Filter *f, AttrInfo **deps, int *ndeps,
+	int *dn2id )
+{
+	AttributeDescription *ad;
+	struct berval prefix;
+	slap_mask_t mask;
+	MDB_dbi dbi;
+	AttrInfo *ai;
+	int ftype;
+
+	for ( ; f && *dn2id >= 0; f = f->f_next ) {
+		switch ( f->f_choice ) {
+		case LDAP_FILTER_AND:
+		case LDAP_FILTER_OR:
+			mdb_scache_deps( op, f->f_list, deps, ndeps, dn2id );
+			continue;
+
+		case LDAP_FILTER_PRESENT:
+			ad = f->f_desc;
+			ftype = LDAP_FILTER_PRESENT;
+			break;
+
+		case LDAP_FILTER_EQUALITY:
+		case LDAP_FILTER_GE:
+		case LDAP_FILTER_LE:
+			ad = f->f_av_desc;
+			ftype = LDAP_FILTER_EQUALITY;
+			break;
+
+		case LDAP_FILTER_APPROX:
+			ad = f->f_av_desc;
+			ftype = LDAP_FILTER_APPROX;
+			break;
+
+		case LDAP_FILTER_SUBSTRINGS:
+			ad = f->f_sub_desc;
+			ftype = LDAP_FILTER_SUBSTRINGS;
+			break;
+
+		case LDAP_FILTER_EXT:
+			/* may be resolved through dn2id */
+			*dn2id = 1;
+			ad = f->f_mr_desc;
+			ftype = LDAP_FILTER_EQUALITY;
+			if ( !ad )
+				continue;
+			break;
+
+		default:
+			*dn2id = 1;
+			continue;
+		}
+
+		if ( ad == slap_schema.si_ad_entryDN ||
+			mdb_index_param( op->o_bd, ad, ftype, &dbi, &mask, &prefix ))
+			*dn2id = 1;
+		ai = mdb_index_mask( op->o_bd, ad, &prefix );
+		if ( ai )
+			mdb_scache_adddep( deps, ndeps, dn2id, ai );
+	}
+}
+
+static void
+mdb_scache_lru_unlink( struct mdb_info *mdb, mdb_scentry *se )
+{
+	if ( se->se_lru_prev )
+		se->se_lru_prev->se_lru_next = se->se_lru_next;
+	else
+		mdb->mi_sc_head = se->se_lru_next;
+	if ( se->se_lru_next )
+		se->se_lru_next->se_lru_prev = se->se_lru_prev;
+	else
+		mdb->mi_sc_tail = se->se_lru_prev;
+}
+
+static void
+mdb_scache_lru_head( struct mdb_info *mdb, mdb_scentry *se )
+{
+	se->se_lru_prev = NULL;
+	se->se_lru_next = mdb->mi_sc_head;
+	if ( mdb->mi_sc_head )
+		mdb->mi_sc_head->se_lru_prev = se;
+	else
+		mdb->mi_sc_tail = se;
+	mdb->mi_sc_head = se;
+}
+
+static void
+mdb_scache_free( struct mdb_info *mdb, mdb_scentry *se )
+{
+	mdb_scentry **prev;
+
+	for ( prev = &mdb->mi_sc_hash[se->se_hash & (mdb->mi_sc_hashsize-1)];
+		*prev != se; prev = &(*prev)->se_next ) ;
+	*prev = se->se_next;
+	mdb_scache_lru_unlink( mdb, se );
+	mdb->mi_sc_num--;
+	ch_free( se );
+}
+
+static mdb_scentry *
+mdb_scache_find( struct mdb_info *mdb, struct berval *filter, int flags,
+	unsigned hash )
+{
+	mdb_scentry *se;
+
+	for ( se = mdb->mi_sc_hash[hash & (mdb->mi_sc_hashsize-1)]; se;
+		se = se->se_next ) {
+		if ( se->se_hash == hash && se->se_flags == flags &&
+			bvmatch( &se->se_filter, filter ))
+			break;
+	}
+	return se;
+}
+
+/* Fill ids with the cached candidates for this search.
+ * Returns 0 on a hit.
+ */
+int
+mdb_scache_get( Operation *op, MDB_txn *txn, ID *ids )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	mdb_scentry *se;
+	struct berval filter;
+	size_t txnid = mdb_txn_id( txn );
+	int i, flags, rc = -1;
+	unsigned hash;
+
+	if ( !mdb->mi_sc_hash )
+		return rc;
+
+	filter2bv_x( op, op->ors_filter, &filter );
+	flags = mdb_scache_flags( op );
+	hash = mdb_scache_hash( &filter, flags );
+
+	ldap_pvt_thread_mutex_lock( &mdb->mi_sc_mutex );
+	se = mdb_scache_find( mdb, &filter, flags, hash );
+	if ( se && se->se_txnid <= txnid ) {
+		rc = 0;
+		if ( se->se_dn2id && mdb->mi_dn2id_lastmod > se->se_txnid )
+			rc = -1;
+		for ( i = 0; i < se->se_ndeps && !rc; i++ ) {
+			if ( se->se_deps[i]->ai_lastmod > se->se_txnid )
+				rc = -1;
+		}
+		if ( rc ) {
+			/* stale, drop it */
+			mdb_scache_free( mdb, se );
+		} else {
+			if ( MDB_IDL_IS_RANGE( se->se_ids ))
+				MDB_IDL_RANGE( ids, MDB_IDL_RANGE_FIRST( se->se_ids ),
+					MDB_IDL_RANGE_LAST( se->se_ids ));
+			else
+				AC_MEMCPY( ids, se->se_ids,
+					( se->se_ids[0] + 1 ) * sizeof( ID ));
+			if ( se != mdb->mi_sc_head ) {
+				mdb_scache_lru_unlink( mdb, se );
+				mdb_scache_lru_head( mdb, se );
+			}
+			mdb->mi_sc_hits++;
+		}
+	}
+	if ( rc )
+		mdb->mi_sc_misses++;
+	ldap_pvt_thread_mutex_unlock( &mdb->mi_sc_mutex );
+
+	op->o_tmpfree( filter.bv_val, op->o_tmpmemctx );
+	return rc;
+}
+
+/* Remember the candidates computed for this search */
+void
+mdb_scache_put( Operation *op, MDB_txn *txn, ID *ids )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	mdb_scentry *se, *old;
+	AttrInfo *deps[MDB_SCACHE_MAXDEPS], *ai;
+	struct berval filter, prefix;
+	size_t txnid = mdb_txn_id( txn ), size;
+	int i, flags, ndeps = 0, dn2id = 0, nids;
+	unsigned hash;
+
+	if ( MDB_IDL_IS_RANGE( ids )) {
+		nids = 3;
+		dn2id = 1;
+	} else {
+		if ( ids[0] > MDB_SCACHE_MAXIDS )
+			return;
+		nids = ids[0] + 1;
+	}
+
+	mdb_scache_deps( op, op->ors_filter, deps, &ndeps, &dn2id );
+	if ( dn2id < 0 )
+		return;
+	/* search_candidates may add objectClass terms of its own */
+	ai = mdb_index_mask( op->o_bd, slap_schema.si_ad_objectClass, &prefix );
+	if ( ai )
+		mdb_scache_adddep( deps, &ndeps, &dn2id, ai );
+	if ( dn2id < 0 )
+		return;
+
+	/* Don't bother if a writer has already moved on */
+	if ( dn2id && mdb->mi_dn2id_lastmod > txnid )
+		return;
+	for ( i = 0; i < ndeps; i++ )
+		if ( deps[i]->ai_lastmod > txnid )
+			return;
+
+	filter2bv_x( op, op->ors_filter, &filter );
+	flags = mdb_scache_flags( op );
+	hash = mdb_scache_hash( &filter, flags );
+
+	size = sizeof( mdb_scentry ) + ndeps * sizeof( AttrInfo * ) +
+		nids * sizeof( ID ) + filter.bv_len + 1;
+	se = ch_malloc( size );
+	se->se_hash = hash;
+	se->se_flags = flags;
+	se->se_dn2id = dn2id;
+	se->se_ndeps = ndeps;
+	se->se_txnid = txnid;
+	se->se_deps = (AttrInfo **)(se + 1);
+	for ( i = 0; i < ndeps; i++ )
+		se->se_deps[i] = deps[i];
+	se->se_ids = (ID *)(se->se_deps + ndeps);
+	AC_MEMCPY( se->se_ids, ids, nids * sizeof( ID ));
+	se->se_filter.bv_val = (char *)(se->se_ids + nids);
+	se->se_filter.bv_len = filter.bv_len;
+	AC_MEMCPY( se->se_filter.bv_val, filter.bv_val, filter.bv_len + 1 );
+	op->o_tmpfree( filter.bv_val, op->o_tmpmemctx );
+
+	ldap_pvt_thread_mutex_lock( &mdb->mi_sc_mutex );
+	if ( !mdb->mi_sc_hash ) {
+		for ( mdb->mi_sc_hashsize = 16;
+			mdb->mi_sc_hashsize < mdb->mi_sc_max;
+			mdb->mi_sc_hashsize <<= 1 ) ;
+		mdb->mi_sc_hash = ch_calloc( mdb->mi_sc_hashsize,
+			sizeof( mdb_scentry * ));
+	}
+	old = mdb_scache_find( mdb, &se->se_filter, flags, hash );
+	if ( old ) {
+		if ( old->se_txnid > txnid ) {
+			/* someone else stored a newer one */
+			ldap_pvt_thread_mutex_unlock( &mdb->mi_sc_mutex );
+			ch_free( se );
+			return;
+		}
+		mdb_scache_free( mdb, old );
+	}
+	while ( mdb->mi_sc_num >= mdb->mi_sc_max && mdb->mi_sc_tail )
+		mdb_scache_free( mdb, mdb->mi_sc_tail );
+
+	i = hash & (mdb->mi_sc_hashsize-1);
+	se->se_next = mdb->mi_sc_hash[i];
+	mdb->mi_sc_hash[i] = se;
+	mdb_scache_lru_head( mdb, se );
+	mdb->mi_sc_num++;
+	ldap_pvt_thread_mutex_unlock( &mdb->mi_sc_mutex );
+}
+
+/* Drop everything, e.g. when the index configuration changes.
+ * Caller must ensure no searches are running.
+ */
+void
+mdb_scache_flush( struct mdb_info *mdb )
+{
+	mdb_scentry *se, *next;
+
+	for ( se = mdb->mi_sc_head; se; se = next ) {
+		next = se->se_lru_next;
+		ch_free( se );
+	}
+	mdb->mi_sc_head = mdb->mi_sc_tail = NULL;
+	mdb->mi_sc_num = 0;
+	ch_free( mdb->mi_sc_hash );
+	mdb->mi_sc_hash = NULL;
+	mdb->mi_sc_hashsize = 0;
+}
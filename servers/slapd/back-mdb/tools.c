@@ -446,6 +446,249 @@ mdb_tool_entry_get( BackendDB *be, ID id )
 	return e;
 }
 
+/* Parallel export. Each thread has its own read txn; the txns are
+ * all begun before any thread starts and are retried until they
+ * share one txnid, so every part is read from the same snapshot.
+ * Parts are handed out in ID order.
+ */
+#ifndef MDB_TOOL_SCAN_CHUNK
+#define MDB_TOOL_SCAN_CHUNK	1024	/* IDs per part when nparts is 0 */
+#endif
+
+typedef struct mdb_tool_scan {
+	BackendDB *ms_be;
+	struct berval *ms_base;
+	int ms_scope;
+	Filter *ms_filter;
+	BI_tool_entry_scan_cb *ms_cb;
+	void *ms_arg;
+	ID ms_chunk;
+	int ms_nparts;
+	int ms_next;
+	volatile int ms_stop;
+	int ms_rc;
+	ldap_pvt_thread_mutex_t ms_mutex;
+} mdb_tool_scan;
+
+typedef struct mdb_tool_scanner {
+	mdb_tool_scan *mt_scan;
+	MDB_txn *mt_txn;
+} mdb_tool_scanner;
+
+static void *
+mdb_tool_scan_task( void *ptr )
+{
+	mdb_tool_scanner *mt = ptr;
+	mdb_tool_scan *ms = mt->mt_scan;
+	struct mdb_info *mdb = (struct mdb_info *) ms->ms_be->be_private;
+	Operation op = {0};
+	Opheader ohdr = {0};
+	MDB_cursor *mc = NULL, *dc = NULL;
+	MDB_val key, data;
+	struct berval pdn = BER_BVNULL, pndn = BER_BVNULL;
+	ID id, last, pid = NOID;
+	int part, rc, cbfail = 0;
+
+	op.o_hdr = &ohdr;
+	op.o_bd = ms->ms_be;
+	op.o_tmpmemctx = NULL;
+	op.o_tmpmfuncs = &ch_mfuncs;
+
+	rc = mdb_cursor_open( mt->mt_txn, mdb->mi_id2entry, &mc );
+
+	while ( rc == 0 ) {
+		ldap_pvt_thread_mutex_lock( &ms->ms_mutex );
+		part = ( ms->ms_stop || ms->ms_next >= ms->ms_nparts ) ?
+			-1 : ms->ms_next++;
+		ldap_pvt_thread_mutex_unlock( &ms->ms_mutex );
+		if ( part < 0 )
+			break;
+
+		id = (ID)part * ms->ms_chunk + 1;
+		last = id + ms->ms_chunk - 1;
+		key.mv_size = sizeof(ID);
+		key.mv_data = &id;
+		for ( rc = mdb_cursor_get( mc, &key, &data, MDB_SET_RANGE );
+			rc == 0 && !ms->ms_stop;
+			rc = mdb_cursor_get( mc, &key, &data, MDB_NEXT ))
+		{
+			struct berval dn, ndn;
+			Entry *e = NULL;
+
+			memcpy( &id, key.mv_data, sizeof(ID) );
+			if ( id > last )
+				break;
+			if ( !data.mv_size )
+				continue;
+
+			if ( mdb_id2name_sibling( &op, mt->mt_txn, &dc, id,
+				&pid, &pdn, &pndn, &dn, &ndn ) == 0 )
+			{
+				/* check the scope before decoding anything */
+				if ( ms->ms_base &&
+					!dnIsSuffixScope( &ndn, ms->ms_base, ms->ms_scope ))
+				{
+					op.o_tmpfree( dn.bv_val, op.o_tmpmemctx );
+					op.o_tmpfree( ndn.bv_val, op.o_tmpmemctx );
+					continue;
+				}
+				if ( mdb_entry_decode( &op, mt->mt_txn, &data, id, &e ) == 0 ) {
+					e->e_id = id;
+					e->e_name = dn;
+					e->e_nname = ndn;
+				} else {
+					op.o_tmpfree( dn.bv_val, op.o_tmpmemctx );
+					op.o_tmpfree( ndn.bv_val, op.o_tmpmemctx );
+					e = NULL;
+				}
+			}
+
+			if ( e && ms->ms_filter &&
+				test_filter( NULL, e, ms->ms_filter ) != LDAP_COMPARE_TRUE )
+			{
+				mdb_entry_return( &op, e );
+				continue;
+			}
+
+			rc = ms->ms_cb( ms->ms_arg, part, id, e );
+			if ( e )
+				mdb_entry_return( &op, e );
+			if ( rc ) {
+				ms->ms_stop = 1;
+				cbfail = 1;
+				break;
+			}
+		}
+		if ( rc == MDB_NOTFOUND )
+			rc = 0;
+		if ( rc || ms->ms_stop )
+			break;
+
+		rc = ms->ms_cb( ms->ms_arg, part, NOID, NULL );
+		if ( rc ) {
+			ms->ms_stop = 1;
+			cbfail = 1;
+		}
+	}
+
+	if ( rc ) {
+		ldap_pvt_thread_mutex_lock( &ms->ms_mutex );
+		ms->ms_stop = 1;
+		if ( !ms->ms_rc )
+			ms->ms_rc = rc;
+		ldap_pvt_thread_mutex_unlock( &ms->ms_mutex );
+		/* this part never gets its end call, let the caller
+		 * know not to wait for it */
+		if ( !cbfail )
+			ms->ms_cb( ms->ms_arg, -1, NOID, NULL );
+	}
+	op.o_tmpfree( pdn.bv_val, op.o_tmpmemctx );
+	op.o_tmpfree( pndn.bv_val, op.o_tmpmemctx );
+	if ( dc )
+		mdb_cursor_close( dc );
+	if ( mc )
+		mdb_cursor_close( mc );
+	return NULL;
+}
+
+int
+mdb_tool_entry_scan(
+	BackendDB *be,
+	int nthreads,
+	int nparts,
+	struct berval *base,
+	int scope,
+	Filter *f,
+	BI_tool_entry_scan_cb *cb,
+	void *arg )
+{
+	struct mdb_info *mdb = (struct mdb_info *) be->be_private;
+	mdb_tool_scan ms = {0};
+	mdb_tool_scanner *mt;
+	ldap_pvt_thread_t *thr;
+	MDB_cursor *mc;
+	MDB_val key, data;
+	ID lastid = 0;
+	int i, rc = 0;
+
+	assert( slapMode & SLAP_TOOL_READONLY );
+
+	if ( nthreads < 1 )
+		nthreads = 1;
+	mt = ch_calloc( nthreads, sizeof( mdb_tool_scanner ));
+	thr = ch_calloc( nthreads, sizeof( ldap_pvt_thread_t ));
+
+	/* the env has MDB_NOTLS in read-only tool mode, so all the
+	 * txns can be begun here and passed to the threads */
+	for ( i = 0; i < nthreads; i++ ) {
+		mt[i].mt_scan = &ms;
+		rc = mdb_txn_begin( mdb->mi_dbenv, NULL, MDB_RDONLY, &mt[i].mt_txn );
+		if ( rc )
+			goto done;
+		if ( i && mdb_txn_id( mt[i].mt_txn ) != mdb_txn_id( mt[0].mt_txn )) {
+			/* a writer committed in between, start over */
+			for ( ; i >= 0; i-- ) {
+				mdb_txn_abort( mt[i].mt_txn );
+				mt[i].mt_txn = NULL;
+			}
+		}
+	}
+
+	rc = mdb_cursor_open( mt[0].mt_txn, mdb->mi_id2entry, &mc );
+	if ( rc )
+		goto done;
+	rc = mdb_cursor_get( mc, &key, &data, MDB_LAST );
+	if ( rc == 0 )
+		memcpy( &lastid, key.mv_data, sizeof(ID) );
+	mdb_cursor_close( mc );
+	if ( rc == MDB_NOTFOUND ) {
+		rc = 0;
+		goto done;
+	} else if ( rc ) {
+		goto done;
+	}
+
+	if ( nparts > 0 ) {
+		ms.ms_nparts = nparts;
+		ms.ms_chunk = ( lastid + nparts - 1 ) / nparts;
+	} else {
+		ms.ms_chunk = MDB_TOOL_SCAN_CHUNK;
+		ms.ms_nparts = ( lastid + MDB_TOOL_SCAN_CHUNK - 1 ) / MDB_TOOL_SCAN_CHUNK;
+	}
+	ms.ms_be = be;
+	ms.ms_base = base;
+	ms.ms_scope = scope;
+	ms.ms_filter = f;
+	ms.ms_cb = cb;
+	ms.ms_arg = arg;
+	ldap_pvt_thread_mutex_init( &ms.ms_mutex );
+
+	for ( i = 1; i < nthreads; i++ )
+		ldap_pvt_thread_create( &thr[i], 0, mdb_tool_scan_task, &mt[i] );
+	mdb_tool_scan_task( &mt[0] );
+	for ( i = 1; i < nthreads; i++ )
+		ldap_pvt_thread_join( thr[i], NULL );
+
+	ldap_pvt_thread_mutex_destroy( &ms.ms_mutex );
+	rc = ms.ms_rc;
+	if ( rc == 0 && ms.ms_stop )
+		rc = -1;
+
+done:
+	if ( rc > 0 ) {
+		Debug( LDAP_DEBUG_ANY,
+			LDAP_XSTRING(mdb_tool_entry_scan) ": database %s: %s (%d)\n",
+			be->be_suffix[0].bv_val, mdb_strerror(rc), rc );
+	}
+	for ( i = 0; i < nthreads; i++ ) {
+		if ( mt[i].mt_txn )
+			mdb_txn_abort( mt[i].mt_txn );
+	}
+	ch_free( thr );
+	ch_free( mt );
+	return rc ? -1 : 0;
+}
+
 static int mdb_tool_next_id(
 	Operation *op,
 	MDB_txn *tid,
@@ -108,6 +108,7 @@ typedef struct monitor_info_t {
 	AttributeDescription	*mi_ad_monitorCounter;
 	AttributeDescription	*mi_ad_monitorOpCompleted;
 	AttributeDescription	*mi_ad_monitorOpInitiated;
+	AttributeDescription	*mi_ad_monitorOpPhaseLatency;
 	AttributeDescription	*mi_ad_monitorConnectionNumber;
 	AttributeDescription	*mi_ad_monitorConnectionAuthzDN;
 	AttributeDescription	*mi_ad_monitorConnectionLocalAddress;
@@ -159,6 +160,7 @@ enum {
 	SLAPD_MONITOR_TIME,
 	SLAPD_MONITOR_TLS,
 	SLAPD_MONITOR_RWW,
+	SLAPD_MONITOR_SNAPSHOT,
 
 	SLAPD_MONITOR_LAST
 };
@@ -243,6 +245,12 @@ enum {
 #define SLAPD_MONITOR_RWW_DN	\
 	SLAPD_MONITOR_RWW_RDN "," SLAPD_MONITOR_DN
 
+#define SLAPD_MONITOR_SNAPSHOT_NAME	"Snapshot"
+#define SLAPD_MONITOR_SNAPSHOT_RDN	\
+	SLAPD_MONITOR_AT "=" SLAPD_MONITOR_SNAPSHOT_NAME
+#define SLAPD_MONITOR_SNAPSHOT_DN	\
+	SLAPD_MONITOR_SNAPSHOT_RDN "," SLAPD_MONITOR_DN
+
 typedef struct monitor_subsys_t {
 	char		*mss_name;
 	struct berval	mss_rdn;
@@ -284,6 +292,11 @@ typedef int (monitor_cbafunc)( struct berval *ndn, Attribute *a,
 	monitor_callback_t *cb,
 	struct berval *base, int scope, struct berval *filter );
 
+/* appends "name{labels} value" lines describing a database to buf,
+ * which has room for len chars; returns the number of chars written */
+typedef int (monitor_snapshotfunc)( Operation *op, BackendDB *be,
+	void *priv, const char *labels, char *buf, int len );
+
 typedef struct monitor_extra_t {
 	int (*is_configured)(void);
 	monitor_subsys_t * (*get_subsys)( const char *name );
@@ -314,6 +327,9 @@ typedef struct monitor_extra_t {
 		struct berval *modify );
 	monitor_entry_t * (*entrypriv_create)( void );
 	int (*register_subsys_late)( monitor_subsys_t *ms );
+	int (*register_snapshot)( BackendDB *be, monitor_snapshotfunc *func,
+		void *priv );
+	int (*unregister_snapshot)( BackendDB *be );
 } monitor_extra_t;
 
 LDAP_END_DECL
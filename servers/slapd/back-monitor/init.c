@@ -68,7 +68,9 @@ static const monitor_extra_t monitor_extra = {
 
 	monitor_back_entry_stub,
 	monitor_back_entrypriv_create,
-	monitor_back_register_subsys_late
+	monitor_back_register_subsys_late,
+	monitor_back_register_snapshot,
+	monitor_back_unregister_snapshot
 };
 	
 
@@ -226,6 +228,17 @@ static struct monitor_subsys_t known_monitor_subsys[] = {
 		NULL,   /* update */
 		NULL, 	/* create */
 		NULL	/* modify */
+       	}, { 
+		SLAPD_MONITOR_SNAPSHOT_NAME,
+		BER_BVNULL, BER_BVNULL, BER_BVNULL,
+		{ BER_BVC( "This subsystem contains all counters in a single value." ),
+			BER_BVNULL },
+		MONITOR_F_NONE,
+		monitor_subsys_snapshot_init,
+		NULL,	/* destroy */
+		NULL,   /* update */
+		NULL, 	/* create */
+		NULL	/* modify */
        	}, { NULL }
 };
 
@@ -1979,6 +1992,13 @@ monitor_back_initialize(
 			"NO-USER-MODIFICATION "
 			"USAGE dSAOperation )", SLAP_AT_FINAL|SLAP_AT_HIDE,
 			offsetof(monitor_info_t, mi_ad_monitorSuperiorDN) },
+		{ "( 1.3.6.1.4.1.4203.666.1.55.31 "
+			"NAME 'monitorOpPhaseLatency' "
+			"DESC 'latency histogram of an operation phase' "
+			"SUP monitoredInfo "
+			"NO-USER-MODIFICATION "
+			"USAGE dSAOperation )", SLAP_AT_FINAL|SLAP_AT_HIDE,
+			offsetof(monitor_info_t, mi_ad_monitorOpPhaseLatency) },
 		{ NULL, 0, -1 }
 	};
 
@@ -164,6 +164,35 @@ monitor_subsys_ops_destroy(
 	return 0;
 }
 
+/* one value per phase: "<phase> <bucket>:<count> ..." */
+static void
+monitor_subsys_ops_latency(
+	monitor_info_t		*mi,
+	Entry			*e,
+	unsigned long		hist[][ SLAP_PHASE_BUCKETS ] )
+{
+	struct berval	vals[ SLAP_PHASE_LAST + 1 ];
+	char		buf[ SLAP_PHASE_LAST ][ SLAP_TEXT_BUFLEN ];
+	int		i, j;
+
+	for ( i = 0; i < SLAP_PHASE_LAST; i++ ) {
+		int len = snprintf( buf[ i ], sizeof( buf[ i ] ), "%s",
+			slap_phase_names[ i ] );
+
+		for ( j = 0; j < SLAP_PHASE_BUCKETS &&
+			len < sizeof( buf[ i ] ); j++ ) {
+			len += snprintf( buf[ i ] + len, sizeof( buf[ i ] ) - len,
+				" %s:%lu", slap_phase_buckets[ j ], hist[ i ][ j ] );
+		}
+		vals[ i ].bv_val = buf[ i ];
+		vals[ i ].bv_len = len < sizeof( buf[ i ] ) ? len : sizeof( buf[ i ] ) - 1;
+	}
+	BER_BVZERO( &vals[ i ] );
+
+	attr_delete( &e->e_attrs, mi->mi_ad_monitorOpPhaseLatency );
+	attr_merge_normalize( e, mi->mi_ad_monitorOpPhaseLatency, vals, NULL );
+}
+
 static int
 monitor_subsys_ops_update(
 	Operation		*op,
@@ -179,6 +208,8 @@ monitor_subsys_ops_update(
 	Attribute		*a;
 	slap_counters_t *sc;
 	static struct berval	bv_ops = BER_BVC( "cn=operations" );
+	unsigned long		hist[ SLAP_PHASE_LAST ][ SLAP_PHASE_BUCKETS ];
+	int			j, ops = 0;
 
 	assert( mi != NULL );
 	assert( e != NULL );
@@ -186,6 +217,7 @@ monitor_subsys_ops_update(
 	dnRdn( &e->e_nname, &rdn );
 
 	if ( dn_match( &rdn, &bv_ops ) ) {
+		ops = 1;
 		ldap_pvt_mp_init( nInitiated );
 		ldap_pvt_mp_init( nCompleted );
 
@@ -194,12 +226,17 @@ monitor_subsys_ops_update(
 			ldap_pvt_mp_add( nInitiated, slap_counters.sc_ops_initiated_[ i ] );
 			ldap_pvt_mp_add( nCompleted, slap_counters.sc_ops_completed_[ i ] );
 		}
+		memcpy( hist, slap_counters.sc_phase_hist, sizeof( hist ));
 		for ( sc = slap_counters.sc_next; sc; sc = sc->sc_next ) {
 			ldap_pvt_thread_mutex_lock( &sc->sc_mutex );
 			for ( i = 0; i < SLAP_OP_LAST; i++ ) {
 				ldap_pvt_mp_add( nInitiated, sc->sc_ops_initiated_[ i ] );
 				ldap_pvt_mp_add( nCompleted, sc->sc_ops_completed_[ i ] );
 			}
+			for ( i = 0; i < SLAP_PHASE_LAST; i++ ) {
+				for ( j = 0; j < SLAP_PHASE_BUCKETS; j++ )
+					hist[ i ][ j ] += sc->sc_phase_hist[ i ][ j ];
+			}
 			ldap_pvt_thread_mutex_unlock( &sc->sc_mutex );
 		}
 		ldap_pvt_thread_mutex_unlock( &slap_counters.sc_mutex );
@@ -242,6 +279,10 @@ monitor_subsys_ops_update(
 	UI2BV( &a->a_vals[ 0 ], nCompleted );
 	ldap_pvt_mp_clear( nCompleted );
 
+	if ( ops ) {
+		monitor_subsys_ops_latency( mi, e, hist );
+	}
+
 	/* FIXME: touch modifyTimestamp? */
 
 	return SLAP_CB_CONTINUE;
@@ -291,6 +291,22 @@ monitor_subsys_sent_init LDAP_P((
 	BackendDB		*be,
 	monitor_subsys_t	*ms ));
 
+/*
+ * snapshot
+ */
+extern int
+monitor_subsys_snapshot_init LDAP_P((
+	BackendDB		*be,
+	monitor_subsys_t	*ms ));
+extern int
+monitor_back_register_snapshot LDAP_P((
+	BackendDB		*be,
+	monitor_snapshotfunc	*func,
+	void			*priv ));
+extern int
+monitor_back_unregister_snapshot LDAP_P((
+	BackendDB		*be ));
+
 /*
  * threads
  */
@@ -0,0 +1,353 @@
+/* snapshot.c - all counters in a single entry */
+/* $OpenLDAP$ */
+/* This work is part of OpenLDAP Software <http://www.openldap.org/>.
+ *
+ * Copyright 2001-2018 The OpenLDAP Foundation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+#include "portable.h"
+
+#include <stdio.h>
+#include <ac/stdarg.h>
+#include <ac/string.h>
+
+#include "slap.h"
+#include "lutil.h"
+#include "back-monitor.h"
+
+/*
+ * The cn=Snapshot entry carries a single monitoredInfo value with one
+ * "name{labels} value" line per metric, so that a scraper can collect
+ * everything with a base search of one entry instead of walking the
+ * whole cn=Monitor tree (which, for cn=Connections, has one entry per
+ * client).  Every metric is read from a counter that is maintained
+ * anyway; nothing is computed by walking connections or entries.
+ *
+ * Databases contribute their own lines by registering a callback
+ * with monitor_back_register_snapshot().
+ */
+
+typedef struct monitor_snapshot_t {
+	BackendDB			*ms_be;
+	monitor_snapshotfunc		*ms_func;
+	void				*ms_priv;
+	char				*ms_labels;
+	struct monitor_snapshot_t	*ms_next;
+} monitor_snapshot_t;
+
+/* only changed while opening or closing databases, with the
+ * thread pool paused, so no lock is needed to walk it */
+static monitor_snapshot_t	*monitor_snapshots;
+
+static char *monitor_snapshot_ops[ SLAP_OP_LAST ] = {
+	"bind",
+	"unbind",
+	"search",
+	"compare",
+	"modify",
+	"modrdn",
+	"add",
+	"delete",
+	"abandon",
+	"extended"
+};
+
+static int
+monitor_subsys_snapshot_update(
+	Operation		*op,
+	SlapReply		*rs,
+	Entry                   *e );
+
+int
+monitor_subsys_snapshot_init(
+	BackendDB		*be,
+	monitor_subsys_t	*ms )
+{
+	monitor_info_t	*mi;
+	Entry		*e;
+	struct berval	bv = BER_BVC( "0" );
+
+	assert( be != NULL );
+
+	ms->mss_update = monitor_subsys_snapshot_update;
+
+	mi = ( monitor_info_t * )be->be_private;
+
+	if ( monitor_cache_get( mi, &ms->mss_ndn, &e ) ) {
+		Debug( LDAP_DEBUG_ANY,
+			"monitor_subsys_snapshot_init: "
+			"unable to get entry \"%s\"\n",
+			ms->mss_ndn.bv_val, 0, 0 );
+		return( -1 );
+	}
+
+	/* placeholder, replaced at each update */
+	attr_merge_normalize_one( e, mi->mi_ad_monitoredInfo, &bv, NULL );
+
+	monitor_cache_release( mi, e );
+
+	return( 0 );
+}
+
+static void
+monitor_snapshot_printf(
+	struct berval	*bv,
+	ber_len_t	*size,
+	const char	*fmt,
+	... )
+{
+	va_list		ap;
+	int		len;
+
+	for ( ;; ) {
+		va_start( ap, fmt );
+		len = vsnprintf( bv->bv_val + bv->bv_len,
+			*size - bv->bv_len, fmt, ap );
+		va_end( ap );
+
+		if ( len < 0 ) {
+			return;
+		}
+		if ( bv->bv_len + len < *size ) {
+			bv->bv_len += len;
+			return;
+		}
+
+		*size = 2 * ( *size + len );
+		bv->bv_val = ch_realloc( bv->bv_val, *size );
+	}
+}
+
+static void
+monitor_snapshot_counter(
+	struct berval	*bv,
+	ber_len_t	*size,
+	const char	*name,
+	const char	*op,
+	ldap_pvt_mp_t	n )
+{
+	struct berval	num = BER_BVNULL;
+
+	UI2BV( &num, n );
+	if ( op != NULL ) {
+		monitor_snapshot_printf( bv, size, "%s{op=\"%s\"} %s\n",
+			name, op, num.bv_val ? num.bv_val : "0" );
+	} else {
+		monitor_snapshot_printf( bv, size, "%s %s\n",
+			name, num.bv_val ? num.bv_val : "0" );
+	}
+	ch_free( num.bv_val );
+}
+
+static int
+monitor_subsys_snapshot_update(
+	Operation		*op,
+	SlapReply		*rs,
+	Entry                   *e )
+{
+	monitor_info_t		*mi = ( monitor_info_t * )op->o_bd->be_private;
+
+	ldap_pvt_mp_t		nInitiated[ SLAP_OP_LAST ],
+				nCompleted[ SLAP_OP_LAST ],
+				nBytes, nPdu, nEntries, nRefs;
+	slap_counters_t		*sc;
+	monitor_snapshot_t	*ms;
+	struct berval		bv;
+	ber_len_t		size = BACKMONITOR_BUFSIZE;
+	Attribute		*a;
+	int			i;
+
+	assert( mi != NULL );
+	assert( e != NULL );
+
+	a = attr_find( e->e_attrs, mi->mi_ad_monitoredInfo );
+	if ( a == NULL ) {
+		return rs->sr_err = LDAP_OTHER;
+	}
+
+	/* one pass over the per-thread counters for everything */
+	ldap_pvt_thread_mutex_lock( &slap_counters.sc_mutex );
+	for ( i = 0; i < SLAP_OP_LAST; i++ ) {
+		ldap_pvt_mp_init_set( nInitiated[ i ], slap_counters.sc_ops_initiated_[ i ] );
+		ldap_pvt_mp_init_set( nCompleted[ i ], slap_counters.sc_ops_completed_[ i ] );
+	}
+	ldap_pvt_mp_init_set( nBytes, slap_counters.sc_bytes );
+	ldap_pvt_mp_init_set( nPdu, slap_counters.sc_pdu );
+	ldap_pvt_mp_init_set( nEntries, slap_counters.sc_entries );
+	ldap_pvt_mp_init_set( nRefs, slap_counters.sc_refs );
+	for ( sc = slap_counters.sc_next; sc; sc = sc->sc_next ) {
+		ldap_pvt_thread_mutex_lock( &sc->sc_mutex );
+		for ( i = 0; i < SLAP_OP_LAST; i++ ) {
+			ldap_pvt_mp_add( nInitiated[ i ], sc->sc_ops_initiated_[ i ] );
+			ldap_pvt_mp_add( nCompleted[ i ], sc->sc_ops_completed_[ i ] );
+		}
+		ldap_pvt_mp_add( nBytes, sc->sc_bytes );
+		ldap_pvt_mp_add( nPdu, sc->sc_pdu );
+		ldap_pvt_mp_add( nEntries, sc->sc_entries );
+		ldap_pvt_mp_add( nRefs, sc->sc_refs );
+		ldap_pvt_thread_mutex_unlock( &sc->sc_mutex );
+	}
+	ldap_pvt_thread_mutex_unlock( &slap_counters.sc_mutex );
+
+	bv.bv_val = ch_malloc( size );
+	bv.bv_len = 0;
+
+	monitor_snapshot_printf( &bv, &size, "slapd_uptime_seconds %lu\n",
+		(unsigned long)difftime( slap_get_time(), starttime ) );
+	monitor_snapshot_printf( &bv, &size, "slapd_connections_current %lu\n",
+		connections_active() );
+	monitor_snapshot_printf( &bv, &size, "slapd_connections_total %lu\n",
+		connections_nextid() );
+
+	for ( i = 0; i < SLAP_OP_LAST; i++ ) {
+		monitor_snapshot_counter( &bv, &size, "slapd_ops_initiated",
+			monitor_snapshot_ops[ i ], nInitiated[ i ] );
+		ldap_pvt_mp_clear( nInitiated[ i ] );
+	}
+	for ( i = 0; i < SLAP_OP_LAST; i++ ) {
+		monitor_snapshot_counter( &bv, &size, "slapd_ops_completed",
+			monitor_snapshot_ops[ i ], nCompleted[ i ] );
+		ldap_pvt_mp_clear( nCompleted[ i ] );
+	}
+
+	monitor_snapshot_counter( &bv, &size, "slapd_sent_bytes", NULL, nBytes );
+	monitor_snapshot_counter( &bv, &size, "slapd_sent_pdu", NULL, nPdu );
+	monitor_snapshot_counter( &bv, &size, "slapd_sent_entries", NULL, nEntries );
+	monitor_snapshot_counter( &bv, &size, "slapd_sent_referrals", NULL, nRefs );
+	ldap_pvt_mp_clear( nBytes );
+	ldap_pvt_mp_clear( nPdu );
+	ldap_pvt_mp_clear( nEntries );
+	ldap_pvt_mp_clear( nRefs );
+
+#ifndef NO_THREADS
+	{
+		static struct {
+			char				*name;
+			ldap_pvt_thread_pool_param_t	param;
+		} mt[] = {
+			{ "slapd_threads_max",		LDAP_PVT_THREAD_POOL_PARAM_MAX },
+			{ "slapd_threads_open",		LDAP_PVT_THREAD_POOL_PARAM_OPEN },
+			{ "slapd_threads_starting",	LDAP_PVT_THREAD_POOL_PARAM_STARTING },
+			{ "slapd_threads_active",	LDAP_PVT_THREAD_POOL_PARAM_ACTIVE },
+			{ "slapd_threads_pending",	LDAP_PVT_THREAD_POOL_PARAM_PENDING },
+			{ "slapd_threads_backload",	LDAP_PVT_THREAD_POOL_PARAM_BACKLOAD },
+			{ NULL }
+		};
+		int	count;
+
+		for ( i = 0; mt[ i ].name != NULL; i++ ) {
+			if ( ldap_pvt_thread_pool_query( &connection_pool,
+				mt[ i ].param, (void *)&count ) == 0 )
+			{
+				monitor_snapshot_printf( &bv, &size, "%s %d\n",
+					mt[ i ].name, count );
+			}
+		}
+	}
+#endif /* ! NO_THREADS */
+
+	for ( ms = monitor_snapshots; ms != NULL; ms = ms->ms_next ) {
+		int	len;
+
+		/* leave room for at least one buffer's worth per database */
+		if ( size - bv.bv_len < BACKMONITOR_BUFSIZE ) {
+			size += BACKMONITOR_BUFSIZE;
+			bv.bv_val = ch_realloc( bv.bv_val, size );
+		}
+
+		len = ms->ms_func( op, ms->ms_be, ms->ms_priv, ms->ms_labels,
+			bv.bv_val + bv.bv_len, size - bv.bv_len );
+		if ( len > 0 ) {
+			bv.bv_len += len < size - bv.bv_len ?
+				len : size - bv.bv_len - 1;
+		}
+	}
+
+	ber_bvreplace( &a->a_vals[ 0 ], &bv );
+	if ( a->a_nvals != a->a_vals ) {
+		ber_bvreplace( &a->a_nvals[ 0 ], &bv );
+	}
+	ch_free( bv.bv_val );
+
+	/* FIXME: touch modifyTimestamp? */
+
+	return SLAP_CB_CONTINUE;
+}
+
+int
+monitor_back_register_snapshot(
+	BackendDB		*be,
+	monitor_snapshotfunc	*func,
+	void			*priv )
+{
+	monitor_snapshot_t	*ms, **msp;
+	struct berval		*suffix;
+	char			*p;
+	ber_len_t		i, len;
+
+	assert( be != NULL );
+	assert( func != NULL );
+
+	for ( msp = &monitor_snapshots; *msp != NULL; msp = &(*msp)->ms_next ) {
+		if ( (*msp)->ms_be == be ) {
+			return -1;
+		}
+	}
+
+	suffix = be->be_suffix ? &be->be_suffix[ 0 ] : NULL;
+	len = STRLENOF( "backend=\"\",suffix=\"\"" )
+		+ strlen( be->bd_info->bi_type );
+	if ( suffix != NULL ) {
+		/* worst case, every character needs escaping */
+		len += 2 * suffix->bv_len;
+	}
+
+	ms = ch_malloc( sizeof( monitor_snapshot_t ) + len + 1 );
+	ms->ms_be = be;
+	ms->ms_func = func;
+	ms->ms_priv = priv;
+	ms->ms_labels = (char *)&ms[ 1 ];
+	ms->ms_next = NULL;
+
+	p = lutil_strcopy( ms->ms_labels, "backend=\"" );
+	p = lutil_strcopy( p, be->bd_info->bi_type );
+	p = lutil_strcopy( p, "\",suffix=\"" );
+	for ( i = 0; suffix != NULL && i < suffix->bv_len; i++ ) {
+		if ( suffix->bv_val[ i ] == '"' || suffix->bv_val[ i ] == '\\' ) {
+			*p++ = '\\';
+		}
+		*p++ = suffix->bv_val[ i ];
+	}
+	p = lutil_strcopy( p, "\"" );
+
+	*msp = ms;
+
+	return 0;
+}
+
+int
+monitor_back_unregister_snapshot(
+	BackendDB		*be )
+{
+	monitor_snapshot_t	*ms, **msp;
+
+	for ( msp = &monitor_snapshots; *msp != NULL; msp = &(*msp)->ms_next ) {
+		if ( (*msp)->ms_be == be ) {
+			ms = *msp;
+			*msp = ms->ms_next;
+			ch_free( ms );
+			return 0;
+		}
+	}
+
+	return -1;
+}
@@ -203,6 +203,8 @@ enum {
 	CFG_TLS_CACERT,
 	CFG_TLS_CERT,
 	CFG_TLS_KEY,
+	CFG_PWCACHE,
+	CFG_PWTHREADS,
 
 	CFG_LAST
 };
@@ -495,16 +497,32 @@ static ConfigTable config_back_cf_table[] = {
 			"EQUALITY caseIgnoreMatch "
 			"SUBSTR caseIgnoreSubstringsMatch "
 			"SYNTAX OMsDirectoryString X-ORDERED 'VALUES' )", NULL, NULL },
+	{ "optrace", "on|off", 2, 2, 0, ARG_ON_OFF,
+		&slap_optrace, "( OLcfgGlAt:100 NAME 'olcOpTrace' "
+			"SYNTAX OMsBoolean SINGLE-VALUE )", NULL, NULL },
 	{ "overlay", "overlay", 2, 2, 0, ARG_MAGIC,
 		&config_overlay, "( OLcfgGlAt:34 NAME 'olcOverlay' "
 			"SUP olcDatabase SINGLE-VALUE X-ORDERED 'SIBLINGS' )", NULL, NULL },
 	{ "password-crypt-salt-format", "salt", 2, 2, 0, ARG_STRING|ARG_MAGIC|CFG_SALT,
 		&config_generic, "( OLcfgGlAt:35 NAME 'olcPasswordCryptSaltFormat' "
 			"SYNTAX OMsDirectoryString SINGLE-VALUE )", NULL, NULL },
+	{ "password-cache-size", "entries", 2, 2, 0, ARG_UINT|ARG_MAGIC|CFG_PWCACHE,
+		&config_generic, "( OLcfgGlAt:103 NAME 'olcPasswordCacheSize' "
+			"DESC 'Number of successful simple bind verifications to cache' "
+			"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "password-hash", "hash", 2, 0, 0, ARG_MAGIC,
 		&config_passwd_hash, "( OLcfgGlAt:36 NAME 'olcPasswordHash' "
 			"EQUALITY caseIgnoreMatch "
 			"SYNTAX OMsDirectoryString )", NULL, NULL },
+	{ "password-hash-threads", "count", 2, 2, 0,
+#ifdef NO_THREADS
+		ARG_IGNORED, NULL,
+#else
+		ARG_INT|ARG_MAGIC|CFG_PWTHREADS, &config_generic,
+#endif
+		"( OLcfgGlAt:104 NAME 'olcPasswordHashThreads' "
+			"DESC 'Number of threads verifying passwords' "
+			"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "pidfile", "file", 2, 2, 0, ARG_STRING,
 		&slapd_pid_file, "( OLcfgGlAt:37 NAME 'olcPidFile' "
 			"SYNTAX OMsDirectoryString SINGLE-VALUE )", NULL, NULL },
@@ -642,6 +660,9 @@ static ConfigTable config_back_cf_table[] = {
 		&config_generic, "( OLcfgGlAt:81 NAME 'olcServerID' "
 			"EQUALITY caseIgnoreMatch "
 			"SYNTAX OMsDirectoryString )", NULL, NULL },
+	{ "slowop-threshold", "msec", 2, 2, 0, ARG_UINT,
+		&slap_slowop_threshold, "( OLcfgGlAt:101 NAME 'olcSlowOpThreshold' "
+			"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "sizelimit", "limit",	2, 0, 0, ARG_MAY_DB|ARG_MAGIC,
 		&config_sizelimit, "( OLcfgGlAt:60 NAME 'olcSizeLimit' "
 			"SYNTAX OMsDirectoryString SINGLE-VALUE )", NULL, NULL },
@@ -651,6 +672,9 @@ static ConfigTable config_back_cf_table[] = {
 	{ "sockbuf_max_incoming_auth", "max", 2, 2, 0, ARG_BER_LEN_T,
 		&sockbuf_max_incoming_auth, "( OLcfgGlAt:62 NAME 'olcSockbufMaxIncomingAuth' "
 			"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
+	{ "sockbuf_max_outgoing", "max", 2, 2, 0, ARG_BER_LEN_T,
+		&sockbuf_max_outgoing, "( OLcfgGlAt:102 NAME 'olcSockbufMaxOutgoing' "
+			"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "sortvals", "attr", 2, 0, 0, ARG_MAGIC|CFG_SORTVALS,
 		&config_generic, "( OLcfgGlAt:83 NAME 'olcSortVals' "
 			"DESC 'Attributes whose values will always be sorted' "
@@ -885,14 +909,17 @@ static ConfigOCs cf_ocs[] = {
 		 "olcIndexSubstrAnyLen $ olcIndexSubstrAnyStep $ olcIndexHash64 $ "
 		 "olcIndexIntLen $ "
 		 "olcListenerThreads $ olcLocalSSF $ olcLogFile $ olcLogLevel $ "
-		 "olcPasswordCryptSaltFormat $ olcPasswordHash $ olcPidFile $ "
+		 "olcOpTrace $ "
+		 "olcPasswordCacheSize $ olcPasswordCryptSaltFormat $ "
+		 "olcPasswordHash $ olcPasswordHashThreads $ olcPidFile $ "
 		 "olcPluginLogFile $ olcReadOnly $ olcReferral $ "
 		 "olcReplogFile $ olcRequires $ olcRestrict $ olcReverseLookup $ "
 		 "olcRootDSE $ "
 		 "olcSaslAuxprops $ olcSaslAuxpropsDontUseCopy $ olcSaslAuxpropsDontUseCopyIgnore $ "
 		 "olcSaslHost $ olcSaslRealm $ olcSaslSecProps $ "
-		 "olcSecurity $ olcServerID $ olcSizeLimit $ "
+		 "olcSecurity $ olcServerID $ olcSizeLimit $ olcSlowOpThreshold $ "
 		 "olcSockbufMaxIncoming $ olcSockbufMaxIncomingAuth $ "
+		 "olcSockbufMaxOutgoing $ "
 		 "olcTCPBuffer $ "
 		 "olcThreads $ olcThreadQueues $ "
 		 "olcTimeLimit $ olcTLSCACertificateFile $ "
@@ -1004,6 +1031,12 @@ config_generic(ConfigArgs *c) {
 		case CFG_TTHREADS:
 			c->value_int = slap_tool_thread_max;
 			break;
+		case CFG_PWCACHE:
+			c->value_uint = slap_passwd_cache_max;
+			break;
+		case CFG_PWTHREADS:
+			c->value_int = slap_passwd_threads;
+			break;
 		case CFG_LTHREADS:
 			c->value_uint = slapd_daemon_threads;
 			break;
@@ -1383,6 +1416,14 @@ config_generic(ConfigArgs *c) {
 		case CFG_SYNC_SUBENTRY:
 			break;
 
+		case CFG_PWCACHE:
+			slap_passwd_cache_size( 0 );
+			break;
+
+		case CFG_PWTHREADS:
+			slap_passwd_hash_threads( 0 );
+			break;
+
 		/* no-ops, requires slapd restart */
 		case CFG_PLUGIN:
 		case CFG_MODLOAD:
@@ -1768,6 +1809,22 @@ config_generic(ConfigArgs *c) {
 			slap_tool_thread_max = c->value_int;	/* save for reference */
 			break;
 
+		case CFG_PWCACHE:
+			slap_passwd_cache_size( c->value_uint );
+			break;
+
+		case CFG_PWTHREADS:
+			if ( c->value_int < 0 ) {
+				snprintf( c->cr_msg, sizeof( c->cr_msg ),
+					"password-hash-threads=%d must not be negative",
+					c->value_int );
+				Debug(LDAP_DEBUG_ANY, "%s: %s.\n",
+					c->log, c->cr_msg, 0 );
+				return 1;
+			}
+			slap_passwd_hash_threads( c->value_int );
+			break;
+
 		case CFG_LTHREADS:
 			{ int mask = 0;
 			/* use a power of two */
@@ -5676,6 +5733,49 @@ config_rename_del( Operation *op, SlapReply *rs, CfEntryInfo *ce,
 		count+old, 0, use_ldif );
 }
 
+/* Config objects replaced without pausing the thread pool. Operations
+ * in flight may still be using them, so they're only freed the next
+ * time the pool is paused, or when the config database is closed.
+ */
+typedef struct CfRetired {
+	struct CfRetired *cr_next;
+	AccessControl *cr_acl;
+	Attribute *cr_attrs;
+} CfRetired;
+
+static CfRetired *cf_retired;
+
+/* protects cf_retired, serializes Modifies done without pausing */
+static ldap_pvt_thread_mutex_t cf_modify_mutex;
+
+static void
+config_retire( AccessControl *acl, Attribute *attrs )
+{
+	CfRetired *cr = ch_malloc( sizeof( CfRetired ));
+
+	cr->cr_acl = acl;
+	cr->cr_attrs = attrs;
+	cr->cr_next = cf_retired;
+	cf_retired = cr;
+}
+
+/* Must be called with the pool paused, or at shutdown */
+static void
+config_retired_free( void )
+{
+	CfRetired *cr;
+
+	ldap_pvt_thread_mutex_lock( &cf_modify_mutex );
+	while (( cr = cf_retired ) != NULL ) {
+		cf_retired = cr->cr_next;
+		if ( cr->cr_acl && cr->cr_acl != defacl_parsed )
+			acl_destroy( cr->cr_acl );
+		attrs_free( cr->cr_attrs );
+		ch_free( cr );
+	}
+	ldap_pvt_thread_mutex_unlock( &cf_modify_mutex );
+}
+
 /* Parse an LDAP entry into config directives, then store in underlying
  * database.
  */
@@ -5726,6 +5826,8 @@ config_back_add( Operation *op, SlapReply *rs )
 	}
 	if ( ldap_pvt_thread_pool_pause( &connection_pool ) < 0 )
 		dopause = 0;
+	else
+		config_retired_free();
 
 	/* Strategy:
 	 * 1) check for existence of entry
@@ -6159,6 +6261,159 @@ out_noop:
 	return rc;
 }
 
+/* Check whether the only config item touched by a Modify is olcAccess
+ * of a regular database; other attributes must be operational.
+ */
+static ConfigTable *
+config_modify_is_acl( CfEntryInfo *ce, Operation *op )
+{
+	ConfigTable *ct, *acl_ct = NULL;
+	ConfigOCs **colst;
+	ConfigArgs ca;
+	Modifications *ml;
+	Attribute *oc_at;
+	int nocs;
+
+	if ( ce->ce_type != Cft_Database || ce->ce_be == frontendDB )
+		return NULL;
+
+	oc_at = attr_find( ce->ce_entry->e_attrs, slap_schema.si_ad_objectClass );
+	if ( !oc_at )
+		return NULL;
+	colst = count_ocs( oc_at, &nocs );
+
+	for ( ml = op->orm_modlist; ml; ml = ml->sml_next ) {
+		ct = config_find_table( colst, nocs, ml->sml_desc, &ca );
+		if ( ct && ct->arg_item == config_generic &&
+			( ct->arg_type & ARGS_USERLAND ) == CFG_ACL ) {
+			acl_ct = ct;
+		} else if ( ct || !is_at_operational( ml->sml_desc->ad_type )) {
+			acl_ct = NULL;
+			break;
+		}
+	}
+	ch_free( colst );
+
+	return acl_ct;
+}
+
+/* Apply an olcAccess Modify without pausing the thread pool: the new
+ * ACL list is parsed aside from the resulting values and published with
+ * a single pointer store, as is the modified entry. The old ones are
+ * retired, since operations in flight may still reference them.
+ * Must be called with cf_modify_mutex locked.
+ */
+static int
+config_modify_acl( CfEntryInfo *ce, ConfigTable *ct, Operation *op,
+	SlapReply *rs, ConfigArgs *ca )
+{
+	Entry *e = ce->ce_entry, etmp;
+	BackendDB betmp;
+	Modifications *ml;
+	Attribute *a;
+	AccessControl *old;
+	int i, rc = LDAP_SUCCESS;
+
+	etmp = *e;
+	etmp.e_attrs = attrs_dup( e->e_attrs );
+
+	for ( ml = op->orm_modlist; ml && rc == LDAP_SUCCESS; ml = ml->sml_next ) {
+		switch ( ml->sml_op ) {
+		case LDAP_MOD_REPLACE:
+			rc = modify_replace_values( &etmp, &ml->sml_mod,
+				get_permissiveModify(op),
+				&rs->sr_text, ca->cr_msg, sizeof(ca->cr_msg) );
+			break;
+		case LDAP_MOD_DELETE:
+		case SLAP_MOD_SOFTDEL:
+			rc = modify_delete_values( &etmp, &ml->sml_mod,
+				get_permissiveModify(op),
+				&rs->sr_text, ca->cr_msg, sizeof(ca->cr_msg) );
+			if ( rc == LDAP_NO_SUCH_ATTRIBUTE && ml->sml_op == SLAP_MOD_SOFTDEL )
+				rc = LDAP_SUCCESS;
+			break;
+		case SLAP_MOD_ADD_IF_NOT_PRESENT:
+			if ( attr_find( etmp.e_attrs, ml->sml_desc ))
+				break;
+			/* FALLTHRU */
+		case LDAP_MOD_ADD:
+		case SLAP_MOD_SOFTADD:
+			rc = modify_add_values( &etmp, &ml->sml_mod,
+				get_permissiveModify(op),
+				&rs->sr_text, ca->cr_msg, sizeof(ca->cr_msg) );
+			if ( rc == LDAP_TYPE_OR_VALUE_EXISTS && ml->sml_op == SLAP_MOD_SOFTADD )
+				rc = LDAP_SUCCESS;
+			break;
+		default:
+			rc = LDAP_UNWILLING_TO_PERFORM;
+			break;
+		}
+	}
+
+	if ( rc == LDAP_SUCCESS ) {
+		rc = entry_schema_check( op, &etmp, NULL, 0, 0, NULL,
+			&rs->sr_text, ca->cr_msg, sizeof(ca->cr_msg) );
+	}
+	if ( rc != LDAP_SUCCESS ) {
+		attrs_free( etmp.e_attrs );
+		return rc;
+	}
+
+	/* Build the new ACL list on a scratch copy of the database */
+	betmp = *ce->ce_be;
+	betmp.be_acl = NULL;
+
+	init_config_argv( ca );
+	ca->be = &betmp;
+	ca->bi = ce->ce_bi;
+	ca->ca_private = ce->ce_private;
+	ca->ca_entry = &etmp;
+	ca->fname = "slapd";
+	ca->ca_op = op;
+	ca->table = Cft_Database;
+	strcpy( ca->log, "back-config" );
+
+	a = attr_find( etmp.e_attrs, ct->ad );
+	for ( i = 0; a && !BER_BVISNULL( &a->a_vals[i] ); i++ ) {
+		ca->line = a->a_vals[i].bv_val;
+		ca->linelen = a->a_vals[i].bv_len;
+		if ( ca->line[0] == '{' ) {
+			char *ptr = strchr( ca->line, '}' );
+			if ( ptr ) {
+				ca->linelen -= (ptr+1) - ca->line;
+				ca->line = ptr+1;
+			}
+		}
+		ca->valx = -1;
+		if ( config_parse_add( ct, ca, i )) {
+			rc = LDAP_OTHER;
+			break;
+		}
+	}
+	if ( rc == LDAP_SUCCESS && SLAP_CONFIG( &betmp ) && !betmp.be_acl )
+		betmp.be_acl = defacl_parsed;
+	ch_free( ca->argv );
+	ca->argv = NULL;
+
+	if ( rc != LDAP_SUCCESS ) {
+		if ( betmp.be_acl != defacl_parsed )
+			acl_destroy( betmp.be_acl );
+		attrs_free( etmp.e_attrs );
+		rs->sr_text = ca->cr_msg;
+		return rc;
+	}
+
+	/* Publish */
+	old = ce->ce_be->be_acl;
+	ce->ce_be->be_acl = betmp.be_acl;
+	a = e->e_attrs;
+	e->e_attrs = etmp.e_attrs;
+	config_retire( old, a );
+
+	rs->sr_text = NULL;
+	return LDAP_SUCCESS;
+}
+
 static int
 config_back_modify( Operation *op, SlapReply *rs )
 {
@@ -6166,6 +6421,7 @@ config_back_modify( Operation *op, SlapReply *rs )
 	CfEntryInfo *ce, *last;
 	Modifications *ml;
 	ConfigArgs ca = {0};
+	ConfigTable *acl_ct = NULL;
 	struct berval rdn;
 	char *ptr;
 	AttributeDescription *rad = NULL;
@@ -6212,6 +6468,13 @@ config_back_modify( Operation *op, SlapReply *rs )
 
 	slap_mods_opattrs( op, &op->orm_modlist, 1 );
 
+	/* ACL changes are published without pausing the pool */
+	if ( do_pause ) {
+		acl_ct = config_modify_is_acl( ce, op );
+		if ( acl_ct )
+			do_pause = 0;
+	}
+
 	if ( do_pause ) {
 		if ( op->o_abandon ) {
 			rs->sr_err = SLAPD_ABANDON;
@@ -6219,6 +6482,8 @@ config_back_modify( Operation *op, SlapReply *rs )
 		}
 		if ( ldap_pvt_thread_pool_pause( &connection_pool ) < 0 )
 			do_pause = 0;
+		else
+			config_retired_free();
 	}
 
 	/* Strategy:
@@ -6227,7 +6492,12 @@ config_back_modify( Operation *op, SlapReply *rs )
 	 * 3) perform the individual config operations.
 	 * 4) store Modified entry in underlying LDIF backend.
 	 */
-	rs->sr_err = config_modify_internal( ce, op, rs, &ca );
+	if ( acl_ct ) {
+		ldap_pvt_thread_mutex_lock( &cf_modify_mutex );
+		rs->sr_err = config_modify_acl( ce, acl_ct, op, rs, &ca );
+	} else {
+		rs->sr_err = config_modify_internal( ce, op, rs, &ca );
+	}
 	if ( rs->sr_err ) {
 		rs->sr_text = ca.cr_msg;
 	} else if ( cfb->cb_use_ldif ) {
@@ -6251,6 +6521,8 @@ config_back_modify( Operation *op, SlapReply *rs )
 		op->o_ndn = ndn;
 	}
 
+	if ( acl_ct )
+		ldap_pvt_thread_mutex_unlock( &cf_modify_mutex );
 	if ( do_pause )
 		ldap_pvt_thread_pool_resume( &connection_pool );
 out:
@@ -6389,6 +6661,8 @@ config_back_modrdn( Operation *op, SlapReply *rs )
 	}
 	if ( ldap_pvt_thread_pool_pause( &connection_pool ) < 0 )
 		dopause = 0;
+	else
+		config_retired_free();
 
 	if ( ce->ce_type == Cft_Schema ) {
 		req_modrdn_s modr = op->oq_modrdn;
@@ -6489,6 +6763,8 @@ config_back_delete( Operation *op, SlapReply *rs )
 
 		if ( ldap_pvt_thread_pool_pause( &connection_pool ) < 0 )
 			dopause = 0;
+		else
+			config_retired_free();
 
 		if ( ce->ce_type == Cft_Overlay ){
 			overlay_remove( ce->ce_be, (slap_overinst *)ce->ce_bi, op );
@@ -7367,6 +7643,8 @@ config_back_db_close( BackendDB *be, ConfigReply *cr )
 		backend_shutdown( &cfb->cb_db );
 	}
 
+	config_retired_free();
+
 	if ( defacl_parsed && be->be_acl != defacl_parsed ) {
 		acl_free( defacl_parsed );
 		defacl_parsed = NULL;
@@ -7386,6 +7664,8 @@ config_back_db_destroy( BackendDB *be, ConfigReply *cr )
 
 	avl_free( CfOcTree, NULL );
 
+	ldap_pvt_thread_mutex_destroy( &cf_modify_mutex );
+
 	if ( cfb->cb_db.bd_info ) {
 		cfb->cb_db.be_suffix = NULL;
 		cfb->cb_db.be_nsuffix = NULL;
@@ -7424,6 +7704,8 @@ config_back_db_init( BackendDB *be, ConfigReply* cr )
 	/* Check ACLs on content of Adds by default */
 	SLAP_DBFLAGS(be) |= SLAP_DBFLAG_ACL_ADD;
 
+	ldap_pvt_thread_mutex_init( &cf_modify_mutex );
+
 	return 0;
 }
 
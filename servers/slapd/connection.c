@@ -38,21 +38,69 @@
 
 #include "lutil.h"
 #include "slap.h"
+#include "ldap_rq.h"
 
-#ifdef LDAP_CONNECTIONLESS
-#include "../../libraries/liblber/lber-int.h"	/* ber_int_sb_read() */
-#endif
+/* ber_int_sb_read(), BerElement internals for parked output */
+#include "../../libraries/liblber/lber-int.h"
 
 #ifdef LDAP_SLAPI
 #include "slapi/slapi.h"
 #endif
 
-/* protected by connections_mutex */
+/* Slots are indexed by descriptor, so registering or retiring a
+ * connection only needs its own c_mutex. connections_mutex is held
+ * while a slot is set up for the first time and by the
+ * connection_first/next iterators.
+ */
 static ldap_pvt_thread_mutex_t connections_mutex;
 static Connection *connections = NULL;
 
 static ldap_pvt_thread_mutex_t conn_nextid_mutex;
 static unsigned long conn_nextid = SLAPD_SYNC_SYNCCONN_OFFSET;
+static unsigned long conn_nactive;
+
+#ifdef __GNUC__
+#define CONN_NEXTID()	__sync_fetch_and_add( &conn_nextid, 1 )
+#define CONN_NACTIVE_ADD(n)	(void)__sync_fetch_and_add( &conn_nactive, (n) )
+#else
+static unsigned long
+conn_nextid_get( void )
+{
+	unsigned long id;
+
+	ldap_pvt_thread_mutex_lock( &conn_nextid_mutex );
+	id = conn_nextid++;
+	ldap_pvt_thread_mutex_unlock( &conn_nextid_mutex );
+
+	return id;
+}
+#define CONN_NEXTID()	conn_nextid_get()
+#define CONN_NACTIVE_ADD(n)	do { \
+		ldap_pvt_thread_mutex_lock( &conn_nextid_mutex ); \
+		conn_nactive += (n); \
+		ldap_pvt_thread_mutex_unlock( &conn_nextid_mutex ); \
+	} while (0)
+#endif
+
+/* Idle timeout wheel. Each connection hangs off the slot of the tick
+ * its idle deadline falls in. Activity does not move it; when a slot
+ * comes due its entries are checked against their real deadline and
+ * either closed or moved to the slot they now belong in, so a check
+ * only touches connections that were due, not the whole table.
+ */
+#define CONN_WHEEL_SIZE	256	/* must be a power of 2 */
+static ldap_pvt_thread_mutex_t conn_wheel_mutex;
+static Connection *conn_wheel[CONN_WHEEL_SIZE];
+static int conn_wheel_timeout;	/* idletimeout the wheel is laid out for */
+static time_t conn_wheel_tick;	/* seconds per slot */
+static time_t conn_wheel_last;	/* last tick processed */
+
+/* Connections with parked output. Nothing waits on the socket for
+ * them, so a task walks this list to enforce writetimeout.
+ */
+static ldap_pvt_thread_mutex_t conn_parked_mutex;
+static Connection *conn_parked;
+static struct re_s *conn_parked_task;
 
 static const char conn_lost_str[] = "connection lost";
 
@@ -89,6 +137,7 @@ static void connection_op_queue( Operation *op );
 static int connection_resched( Connection *conn );
 static void connection_abandon( Connection *conn );
 static void connection_destroy( Connection *c );
+static void connection_parked( Connection *c, int progress );
 
 static ldap_pvt_thread_start_t connection_operation;
 
@@ -110,6 +159,8 @@ int connections_init(void)
 	/* should check return of every call */
 	ldap_pvt_thread_mutex_init( &connections_mutex );
 	ldap_pvt_thread_mutex_init( &conn_nextid_mutex );
+	ldap_pvt_thread_mutex_init( &conn_wheel_mutex );
+	ldap_pvt_thread_mutex_init( &conn_parked_mutex );
 
 	connections = (Connection *) ch_calloc( dtblsize, sizeof(Connection) );
 
@@ -169,6 +220,8 @@ int connections_destroy(void)
 
 	ldap_pvt_thread_mutex_destroy( &connections_mutex );
 	ldap_pvt_thread_mutex_destroy( &conn_nextid_mutex );
+	ldap_pvt_thread_mutex_destroy( &conn_wheel_mutex );
+	ldap_pvt_thread_mutex_destroy( &conn_parked_mutex );
 	return 0;
 }
 
@@ -202,36 +255,163 @@ int connections_shutdown(void)
 }
 
 /*
- * Timeout idle connections.
+ * Put a connection on the idle timeout wheel, at the slot of
+ * its deadline. c_mutex must be held.
  */
-int connections_timeout_idle(time_t now)
+static void
+connection_wheel_insert( Connection *c, time_t deadline )
+{
+	time_t tick;
+	int slot;
+
+	ldap_pvt_thread_mutex_lock( &conn_wheel_mutex );
+	if ( conn_wheel_timeout && c->c_idle_prevp == NULL ) {
+		if ( !deadline )
+			deadline = c->c_activitytime + conn_wheel_timeout;
+		tick = deadline / conn_wheel_tick;
+		if ( tick <= conn_wheel_last )
+			tick = conn_wheel_last + 1;
+		slot = tick & ( CONN_WHEEL_SIZE - 1 );
+		c->c_idle_next = conn_wheel[slot];
+		if ( c->c_idle_next )
+			c->c_idle_next->c_idle_prevp = &c->c_idle_next;
+		c->c_idle_prevp = &conn_wheel[slot];
+		conn_wheel[slot] = c;
+	}
+	ldap_pvt_thread_mutex_unlock( &conn_wheel_mutex );
+}
+
+/* conn_wheel_mutex must be held */
+static void
+connection_wheel_unlink( Connection *c )
+{
+	if ( c->c_idle_prevp ) {
+		*c->c_idle_prevp = c->c_idle_next;
+		if ( c->c_idle_next )
+			c->c_idle_next->c_idle_prevp = c->c_idle_prevp;
+		c->c_idle_next = NULL;
+		c->c_idle_prevp = NULL;
+	}
+}
+
+static void
+connection_wheel_remove( Connection *c )
+{
+	ldap_pvt_thread_mutex_lock( &conn_wheel_mutex );
+	connection_wheel_unlink( c );
+	ldap_pvt_thread_mutex_unlock( &conn_wheel_mutex );
+}
+
+/*
+ * Lay the wheel out again for a changed idletimeout. This is the
+ * only place that walks every connection.
+ */
+static void
+connection_wheel_reset( time_t now )
 {
-	int i = 0, writers = 0;
 	ber_socket_t connindex;
-	Connection* c;
+	Connection *c;
+	int i;
+
+	ldap_pvt_thread_mutex_lock( &conn_wheel_mutex );
+	for ( i = 0; i < CONN_WHEEL_SIZE; i++ ) {
+		while ( conn_wheel[i] )
+			connection_wheel_unlink( conn_wheel[i] );
+	}
+	conn_wheel_timeout = global_idletimeout;
+	if ( conn_wheel_timeout ) {
+		/* keep the wheel at least twice as long as the timeout,
+		 * so a deadline never wraps onto a slot due earlier
+		 */
+		conn_wheel_tick = conn_wheel_timeout / ( CONN_WHEEL_SIZE / 2 ) + 1;
+		conn_wheel_last = now / conn_wheel_tick;
+	}
+	ldap_pvt_thread_mutex_unlock( &conn_wheel_mutex );
+
+	if ( !conn_wheel_timeout )
+		return;
 
 	for( c = connection_first( &connindex );
 		c != NULL;
 		c = connection_next( c, &connindex ) )
 	{
-		/* Don't timeout a slow-running request or a persistent
-		 * outbound connection.
-		 */
-		if(( c->c_n_ops_executing && !c->c_writewaiter)
-			|| c->c_conn_state == SLAP_C_CLIENT ) {
+		if ( c->c_conn_state != SLAP_C_CLIENT )
+			connection_wheel_insert( c, 0 );
+	}
+	connection_done( c );
+}
+
+/*
+ * Timeout idle connections.
+ */
+int connections_timeout_idle(time_t now)
+{
+	int i = 0, n = 0, max = 0, j;
+	struct idlecand {
+		Connection *c;
+		unsigned long connid;
+	} *cand = NULL;
+	time_t tick, last;
+	Connection* c;
+
+	if ( conn_wheel_timeout != global_idletimeout )
+		connection_wheel_reset( now );
+	if ( !conn_wheel_timeout )
+		return 0;
+
+	/* Take everything due off the wheel */
+	ldap_pvt_thread_mutex_lock( &conn_wheel_mutex );
+	last = now / conn_wheel_tick;
+	tick = conn_wheel_last + 1;
+	if ( last - tick >= CONN_WHEEL_SIZE )
+		tick = last - CONN_WHEEL_SIZE + 1;
+	for ( ; tick <= last; tick++ ) {
+		Connection **slot = &conn_wheel[tick & ( CONN_WHEEL_SIZE - 1 )];
+		while (( c = *slot )) {
+			connection_wheel_unlink( c );
+			if ( n == max ) {
+				max = max ? max * 2 : 64;
+				cand = ch_realloc( cand, max * sizeof(struct idlecand) );
+			}
+			cand[n].c = c;
+			cand[n].connid = c->c_connid;
+			n++;
+		}
+	}
+	conn_wheel_last = last;
+	ldap_pvt_thread_mutex_unlock( &conn_wheel_mutex );
+
+	for ( j = 0; j < n; j++ ) {
+		c = cand[j].c;
+		ldap_pvt_thread_mutex_lock( &c->c_mutex );
+
+		/* Closed, or closed and reused, since we took it off the wheel */
+		if ( c->c_struct_state != SLAP_C_USED ||
+			c->c_connid != cand[j].connid ||
+			c->c_idle_prevp != NULL ) {
+			ldap_pvt_thread_mutex_unlock( &c->c_mutex );
 			continue;
 		}
 
-		if( global_idletimeout && 
-			difftime( c->c_activitytime+global_idletimeout, now) < 0 ) {
+		/* Don't timeout a slow-running request; look at it again
+		 * on the next check.
+		 */
+		if( c->c_n_ops_executing && !c->c_writewaiter ) {
+			connection_wheel_insert( c, now + 1 );
+
+		} else if( difftime( c->c_activitytime+global_idletimeout, now) < 0 ) {
 			/* close it */
 			connection_closing( c, "idletimeout" );
 			connection_close( c );
 			i++;
-			continue;
+
+		} else {
+			/* it has been active since, reschedule */
+			connection_wheel_insert( c, 0 );
 		}
+		ldap_pvt_thread_mutex_unlock( &c->c_mutex );
 	}
-	connection_done( c );
+	ch_free( cand );
 
 	return i;
 }
@@ -359,6 +539,8 @@ Connection * connection_init(
 	}
 
 	if( doinit ) {
+		/* publish the new slot's mutexes to connection_next() */
+		ldap_pvt_thread_mutex_lock( &connections_mutex );
 		c->c_send_ldap_result = slap_send_ldap_result;
 		c->c_send_search_entry = slap_send_search_entry;
 		c->c_send_search_reference = slap_send_search_reference;
@@ -398,6 +580,7 @@ Connection * connection_init(
 		}
 
 		c->c_currentber = NULL;
+		c->c_outber = NULL;
 
 		/* should check status of thread calls */
 		ldap_pvt_thread_mutex_init( &c->c_mutex );
@@ -409,6 +592,7 @@ Connection * connection_init(
 			slapi_int_create_object_extensions( SLAPI_X_EXT_CONNECTION, c );
 		}
 #endif
+		ldap_pvt_thread_mutex_unlock( &connections_mutex );
 	}
 
 	ldap_pvt_thread_mutex_lock( &c->c_mutex );
@@ -434,6 +618,8 @@ Connection * connection_init(
 	assert( c->c_sasl_bindop == NULL );
 	assert( c->c_sasl_cbind == NULL );
 	assert( c->c_currentber == NULL );
+	assert( c->c_outber == NULL );
+	assert( c->c_out_prevp == NULL );
 	assert( c->c_writewaiter == 0);
 	assert( c->c_writers == 0);
 
@@ -442,10 +628,8 @@ Connection * connection_init(
 
 	if ( flags & CONN_IS_CLIENT ) {
 		c->c_connid = 0;
-		ldap_pvt_thread_mutex_lock( &connections_mutex );
 		c->c_conn_state = SLAP_C_CLIENT;
 		c->c_struct_state = SLAP_C_USED;
-		ldap_pvt_thread_mutex_unlock( &connections_mutex );
 		c->c_close_reason = "?";			/* should never be needed */
 		ber_sockbuf_ctrl( c->c_sb, LBER_SB_OPT_SET_FD, &sfd );
 		ldap_pvt_thread_mutex_unlock( &c->c_mutex );
@@ -525,14 +709,10 @@ Connection * connection_init(
 			s, c->c_peer_name.bv_val, 0 );
 	}
 
-	ldap_pvt_thread_mutex_lock( &conn_nextid_mutex );
-	id = c->c_connid = conn_nextid++;
-	ldap_pvt_thread_mutex_unlock( &conn_nextid_mutex );
+	id = c->c_connid = CONN_NEXTID();
 
-	ldap_pvt_thread_mutex_lock( &connections_mutex );
 	c->c_conn_state = SLAP_C_INACTIVE;
 	c->c_struct_state = SLAP_C_USED;
-	ldap_pvt_thread_mutex_unlock( &connections_mutex );
 	c->c_close_reason = "?";			/* should never be needed */
 
 	c->c_ssf = c->c_transport_ssf = ssf;
@@ -554,6 +734,8 @@ Connection * connection_init(
 	slapd_add_internal( s, 1 );
 
 	backend_connection_init(c);
+	connection_wheel_insert( c, 0 );
+	CONN_NACTIVE_ADD( 1 );
 	ldap_pvt_thread_mutex_unlock( &c->c_mutex );
 
 	if ( !(flags & CONN_IS_UDP ))
@@ -623,10 +805,10 @@ connection_destroy( Connection *c )
 	connid = c->c_connid;
 	close_reason = c->c_close_reason;
 
-	ldap_pvt_thread_mutex_lock( &connections_mutex );
 	c->c_struct_state = SLAP_C_PENDING;
-	ldap_pvt_thread_mutex_unlock( &connections_mutex );
 
+	connection_wheel_remove( c );
+	CONN_NACTIVE_ADD( -1 );
 	backend_connection_destroy(c);
 
 	c->c_protocol = 0;
@@ -659,6 +841,17 @@ connection_destroy( Connection *c )
 		c->c_currentber = NULL;
 	}
 
+	if ( c->c_outber != NULL ) {
+		/* one last try, whatever the socket won't take is lost */
+		ldap_pvt_thread_mutex_lock( &c->c_write1_mutex );
+		if ( connection_flush_output( c ) < 0 ) {
+			ber_free( c->c_outber, 1 );
+			c->c_outber = NULL;
+			connection_parked( c, 0 );
+		}
+		ldap_pvt_thread_mutex_unlock( &c->c_write1_mutex );
+	}
+
 
 #ifdef LDAP_SLAPI
 	/* call destructors, then constructors; avoids unnecessary allocation */
@@ -851,6 +1044,12 @@ unsigned long connections_nextid(void)
 	return id;
 }
 
+/* number of connections currently set up, without walking them */
+unsigned long connections_active(void)
+{
+	return conn_nactive;
+}
+
 /*
  * Loop through the connections:
  *
@@ -891,13 +1090,7 @@ Connection* connection_next( Connection *c, ber_socket_t *index )
 
 	ldap_pvt_thread_mutex_lock( &connections_mutex );
 	for(; *index < dtblsize; (*index)++) {
-		int c_struct;
-		if( connections[*index].c_struct_state == SLAP_C_UNINITIALIZED ) {
-			/* FIXME: accessing c_conn_state without locking c_mutex */
-			assert( connections[*index].c_conn_state == SLAP_C_INVALID );
-			continue;
-		}
-
+		/* c_struct_state is only a hint until c_mutex is held */
 		if( connections[*index].c_struct_state == SLAP_C_USED ) {
 			c = &connections[(*index)++];
 			if ( ldap_pvt_thread_mutex_trylock( &c->c_mutex )) {
@@ -905,22 +1098,16 @@ Connection* connection_next( Connection *c, ber_socket_t *index )
 				ldap_pvt_thread_mutex_unlock( &connections_mutex );
 				ldap_pvt_thread_mutex_lock( &c->c_mutex );
 				ldap_pvt_thread_mutex_lock( &connections_mutex );
-				if ( c->c_struct_state != SLAP_C_USED ) {
-					ldap_pvt_thread_mutex_unlock( &c->c_mutex );
-					c = NULL;
-					continue;
-				}
+			}
+			if ( c->c_struct_state != SLAP_C_USED ) {
+				ldap_pvt_thread_mutex_unlock( &c->c_mutex );
+				c = NULL;
+				(*index)--;
+				continue;
 			}
 			assert( c->c_conn_state != SLAP_C_INVALID );
 			break;
 		}
-
-		c_struct = connections[*index].c_struct_state;
-		if ( c_struct == SLAP_C_PENDING )
-			continue;
-		assert( c_struct == SLAP_C_UNUSED );
-		/* FIXME: accessing c_conn_state without locking c_mutex */
-		assert( connections[*index].c_conn_state == SLAP_C_INVALID );
 	}
 
 	ldap_pvt_thread_mutex_unlock( &connections_mutex );
@@ -1009,6 +1196,11 @@ conn_counter_destroy( void *key, void *data )
 				ldap_pvt_mp_add( slap_counters.sc_ops_initiated_[ i ], sc->sc_ops_initiated_[ i ] );
 				ldap_pvt_mp_add( slap_counters.sc_ops_initiated_[ i ], sc->sc_ops_completed_[ i ] );
 			}
+			for ( i = 0; i < SLAP_PHASE_LAST; i++ ) {
+				int j;
+				for ( j = 0; j < SLAP_PHASE_BUCKETS; j++ )
+					slap_counters.sc_phase_hist[ i ][ j ] += sc->sc_phase_hist[ i ][ j ];
+			}
 #endif /* SLAPD_MONITOR */
 			slap_counters_destroy( sc );
 			ber_memfree_x( data, NULL );
@@ -1049,6 +1241,7 @@ connection_op_finish( Operation *op )
 	assert( opidx != SLAP_OP_LAST );
 
 	INCR_OP_COMPLETED( opidx );
+	slap_op_phase_finish( op );
 
 	ldap_pvt_thread_mutex_lock( &conn->c_mutex );
 
@@ -1188,6 +1381,7 @@ operations_error:
 		 * only if operation was initiated
 		 * and rc != SLAPD_DISCONNECT */
 		INCR_OP_COMPLETED( opidx );
+		slap_op_phase_finish( op );
 	}
 
 	ldap_pvt_thread_mutex_lock( &conn->c_mutex );
@@ -1543,6 +1737,7 @@ connection_input( Connection *conn , conn_readinfo *cri )
 #endif
 	char *defer = NULL;
 	void *ctx;
+	struct timeval tv_decode;
 
 	if ( conn->c_currentber == NULL &&
 		( conn->c_currentber = ber_alloc()) == NULL )
@@ -1608,6 +1803,7 @@ connection_input( Connection *conn , conn_readinfo *cri )
 	}
 #endif
 
+	SLAP_PHASE_BEGIN( tv_decode );
 	tag = ber_get_next( conn->c_sb, &len, conn->c_currentber );
 	if ( tag != LDAP_TAG_MESSAGE ) {
 		int err = sock_errno();
@@ -1664,6 +1860,13 @@ connection_input( Connection *conn , conn_readinfo *cri )
 
 	ctx = cri->ctx;
 	op = slap_op_alloc( ber, msgid, tag, conn->c_n_ops_received++, ctx );
+	if ( tv_decode.tv_sec ) {
+		/* the op timestamp closes the decode phase */
+		long usec = ( op->o_time - tv_decode.tv_sec ) * 1000000L
+			+ op->o_tusec - tv_decode.tv_usec;
+		if ( usec > 0 )
+			op->o_phase[ SLAP_PHASE_DECODE ] = usec;
+	}
 
 	Debug( LDAP_DEBUG_TRACE, "op tag 0x%lx, time %ld\n", tag,
 		(long) op->o_time, 0);
@@ -1973,6 +2176,249 @@ static int connection_op_activate( Operation *op )
 	return rc;
 }
 
+/*
+ * Output is parked on the connection when an operation finds the
+ * socket full, so the worker can go back to the pool instead of
+ * waiting for the client. The listener flushes it once the socket
+ * becomes writable; a worker that writes to the connection flushes it
+ * before its own PDU. Both require c_write1_mutex.
+ *
+ * Returns 0 once everything parked has been written, -1 with the
+ * socket error set otherwise.
+ */
+int
+connection_flush_output( Connection *c )
+{
+	char *done;
+
+	if ( c->c_outber == NULL )
+		return 0;
+
+	done = c->c_outber->ber_rwptr;
+	if ( ber_flush2( c->c_sb, c->c_outber, LBER_FLUSH_FREE_NEVER ) != 0 ) {
+		if ( c->c_outber->ber_rwptr != done )
+			connection_parked( c, 1 );
+		return -1;
+	}
+
+	ber_free( c->c_outber, 1 );
+	c->c_outber = NULL;
+	connection_parked( c, 0 );
+	return 0;
+}
+
+/*
+ * Close connections whose parked output has made no progress for
+ * writetimeout seconds. Runs while any output is parked.
+ */
+static void *
+connections_timeout_write( void *ctx, void *arg )
+{
+	struct re_s *rtask = arg;
+	struct outcand {
+		Connection *c;
+		unsigned long connid;
+	} *cand = NULL;
+	int i, n = 0, max = 0, more;
+	time_t now = slap_get_time();
+	Connection *c;
+
+	ldap_pvt_thread_mutex_lock( &conn_parked_mutex );
+	if ( global_writetimeout ) {
+		for ( c = conn_parked; c; c = c->c_out_next ) {
+			if ( difftime( c->c_outtime + global_writetimeout, now ) > 0 )
+				continue;
+			if ( n == max ) {
+				max = max ? max * 2 : 16;
+				cand = ch_realloc( cand, max * sizeof(struct outcand) );
+			}
+			cand[n].c = c;
+			cand[n].connid = c->c_connid;
+			n++;
+		}
+	}
+	ldap_pvt_thread_mutex_unlock( &conn_parked_mutex );
+
+	for ( i = 0; i < n; i++ ) {
+		c = cand[i].c;
+		ldap_pvt_thread_mutex_lock( &c->c_mutex );
+		if ( c->c_struct_state == SLAP_C_USED &&
+			c->c_connid == cand[i].connid &&
+			c->c_conn_state != SLAP_C_CLOSING )
+		{
+			int expired;
+
+			/* it may have drained since we looked */
+			ldap_pvt_thread_mutex_lock( &conn_parked_mutex );
+			expired = c->c_out_prevp != NULL &&
+				difftime( c->c_outtime + global_writetimeout, now ) <= 0;
+			ldap_pvt_thread_mutex_unlock( &conn_parked_mutex );
+			if ( expired ) {
+				Debug( LDAP_DEBUG_CONNS,
+					"connections_timeout_write: closing conn=%lu sd=%d\n",
+					c->c_connid, c->c_sd, 0 );
+				connection_closing( c, "writetimeout" );
+				connection_close( c );
+			}
+		}
+		ldap_pvt_thread_mutex_unlock( &c->c_mutex );
+	}
+	ch_free( cand );
+
+	ldap_pvt_thread_mutex_lock( &conn_parked_mutex );
+	more = conn_parked != NULL && global_writetimeout;
+	ldap_pvt_thread_mutex_unlock( &conn_parked_mutex );
+
+	ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
+	ldap_pvt_runqueue_stoptask( &slapd_rq, rtask );
+	if ( more ) {
+		rtask->interval.tv_sec = global_writetimeout;
+		ldap_pvt_runqueue_resched( &slapd_rq, rtask, 0 );
+	} else {
+		/* wait until output is parked again */
+		ldap_pvt_runqueue_resched( &slapd_rq, rtask, 1 );
+	}
+	ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
+
+	return NULL;
+}
+
+/*
+ * Put c on the parked list, noting that its output made progress,
+ * or take it off once nothing is parked. c_write1_mutex must be held.
+ */
+static void
+connection_parked( Connection *c, int progress )
+{
+	int start = 0;
+
+	ldap_pvt_thread_mutex_lock( &conn_parked_mutex );
+	if ( progress ) {
+		c->c_outtime = slap_get_time();
+		if ( c->c_out_prevp == NULL ) {
+			c->c_out_next = conn_parked;
+			if ( c->c_out_next )
+				c->c_out_next->c_out_prevp = &c->c_out_next;
+			c->c_out_prevp = &conn_parked;
+			conn_parked = c;
+			start = global_writetimeout;
+		}
+	} else if ( c->c_out_prevp ) {
+		*c->c_out_prevp = c->c_out_next;
+		if ( c->c_out_next )
+			c->c_out_next->c_out_prevp = c->c_out_prevp;
+		c->c_out_next = NULL;
+		c->c_out_prevp = NULL;
+	}
+	ldap_pvt_thread_mutex_unlock( &conn_parked_mutex );
+
+	if ( !start )
+		return;
+
+	ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
+	if ( !conn_parked_task ) {
+		conn_parked_task = ldap_pvt_runqueue_insert( &slapd_rq,
+			global_writetimeout, connections_timeout_write, NULL,
+			"connections_timeout_write", "writetimeout" );
+	} else if ( !ldap_pvt_runqueue_isrunning( &slapd_rq, conn_parked_task ) &&
+		!conn_parked_task->next_sched.tv_sec )
+	{
+		conn_parked_task->interval.tv_sec = global_writetimeout;
+		ldap_pvt_runqueue_resched( &slapd_rq, conn_parked_task, 0 );
+	} else {
+		start = 0;
+	}
+	ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
+	if ( start )
+		slap_wake_listener();
+}
+
+/*
+ * Whether bytes written to c's sockbuf go out as they are. A TLS or
+ * SASL layer expects a short write to be retried from the same
+ * buffer, and one about to be installed would send the parked bytes
+ * through itself, so neither may park output.
+ */
+static int
+connection_plain_output( Connection *c )
+{
+	Sockbuf_IO_Desc *p;
+
+#ifdef HAVE_TLS
+	if ( c->c_needs_tls_accept )
+		return 0;
+#endif
+	if ( c->c_sasl_layers )
+		return 0;
+
+	for ( p = c->c_sb->sb_iod; p != NULL; p = p->sbiod_next ) {
+		if ( p->sbiod_level > LBER_SBIOD_LEVEL_PROVIDER &&
+			p->sbiod_io != &ber_sockbuf_io_debug )
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Park the unwritten part of ber on the connection and have the
+ * listener watch for writability. Returns -1 if that would take more
+ * than sockbuf_max_outgoing bytes, or if a TLS or SASL layer expects
+ * the write to be retried from the same buffer; the caller must then
+ * wait for the socket itself.
+ */
+int
+connection_park_output( Connection *c, BerElement *ber )
+{
+	BerElement *out = c->c_outber;
+	char *rest = ber->ber_rwptr ? ber->ber_rwptr : ber->ber_buf;
+	ber_len_t len = ber->ber_ptr - rest, pending = 0;
+
+	if ( !connection_plain_output( c ))
+		return -1;
+
+	if ( out != NULL ) {
+		char *done = out->ber_rwptr ? out->ber_rwptr : out->ber_buf;
+
+		pending = out->ber_ptr - done;
+		if ( pending + len > sockbuf_max_outgoing )
+			return -1;
+
+		/* drop the written head once it outweighs what is left */
+		if ( (ber_len_t)( done - out->ber_buf ) > pending ) {
+			BerElement *nout = ber_alloc_t( LBER_USE_DER );
+
+			if ( nout == NULL || ber_write( nout, done, pending, 0 ) < 0 ) {
+				if ( nout != NULL ) ber_free( nout, 1 );
+				return -1;
+			}
+			ber_free( out, 1 );
+			c->c_outber = out = nout;
+		}
+
+	} else {
+		if ( len > sockbuf_max_outgoing )
+			return -1;
+		out = ber_alloc_t( LBER_USE_DER );
+		if ( out == NULL )
+			return -1;
+		c->c_outber = out;
+	}
+
+	if ( ber_write( out, rest, len, 0 ) < 0 ) {
+		/* nothing of ours was appended, the parked output is intact */
+		if ( pending == 0 ) {
+			ber_free( out, 1 );
+			c->c_outber = NULL;
+		}
+		return -1;
+	}
+
+	if ( pending == 0 )
+		connection_parked( c, 1 );
+	slapd_set_write( c->c_sd, 1 );
+	return 0;
+}
+
 int connection_write(ber_socket_t s)
 {
 	Connection *c;
@@ -2005,6 +2451,31 @@ int connection_write(ber_socket_t s)
 		"connection_write(%d): waking output for id=%lu\n",
 		s, c->c_connid, 0 );
 
+	if ( c->c_outber != NULL ) {
+		int err = 0;
+
+		ldap_pvt_thread_mutex_lock( &c->c_write1_mutex );
+		/* an active writer flushes the parked output itself */
+		if ( !c->c_writing && connection_flush_output( c ) < 0 ) {
+			err = sock_errno();
+			if ( err == EWOULDBLOCK || err == EAGAIN ) {
+				slapd_set_write( s, 0 );
+				err = 0;
+			}
+		}
+		ldap_pvt_thread_mutex_unlock( &c->c_write1_mutex );
+
+		if ( err ) {
+			Debug( LDAP_DEBUG_CONNS,
+				"connection_write(%d): flush failed errno=%d id=%lu\n",
+				s, err, c->c_connid );
+			connection_closing( c, "connection lost on write" );
+			connection_close( c );
+			connection_return( c );
+			return -1;
+		}
+	}
+
 	wantwrite = ber_sockbuf_ctrl( c->c_sb, LBER_SB_OPT_NEEDS_WRITE, NULL );
 	if ( ber_sockbuf_ctrl( c->c_sb, LBER_SB_OPT_NEEDS_READ, NULL )) {
 		/* don't wakeup twice */
@@ -2154,7 +2625,5 @@ connection_fake_init2(
 void
 connection_assign_nextid( Connection *conn )
 {
-	ldap_pvt_thread_mutex_lock( &conn_nextid_mutex );
-	conn->c_connid = conn_nextid++;
-	ldap_pvt_thread_mutex_unlock( &conn_nextid_mutex );
+	conn->c_connid = CONN_NEXTID();
 }
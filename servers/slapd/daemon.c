@@ -69,6 +69,11 @@ int deny_severity = LOG_NOTICE;
 # define LDAPI_MOD_URLEXT		"x-mod"
 #endif /* LDAP_PF_LOCAL */
 
+#ifdef SO_REUSEPORT
+# include <fcntl.h>
+# define LDAP_REUSEPORT_URLEXT	"x-reuseport"
+#endif /* SO_REUSEPORT */
+
 #ifdef LDAP_PF_INET6
 int slap_inet4or6 = AF_UNSPEC;
 #else /* ! INETv6 */
@@ -94,6 +99,12 @@ int slapd_tcp_wmem;
 
 Listener **slap_listeners = NULL;
 static volatile sig_atomic_t listening = 1; /* 0 when slap_listeners closed */
+#ifdef SO_REUSEPORT
+/* SO_REUSEPORT copies of listeners, one per possible listener thread;
+ * handed out once listener-threads is known */
+static Listener **slap_reuseport_listeners = NULL;
+static int slap_reuseport_nlisteners;
+#endif /* SO_REUSEPORT */
 static ldap_pvt_thread_t *listener_tid;
 
 #ifndef SLAPD_LISTEN_BACKLOG
@@ -1267,7 +1278,7 @@ get_url_perms(
 	mode_t	*perms,
 	int	*crit )
 {
-	int	i;
+	int	i, skipped = 0;
 
 	assert( exts != NULL );
 	assert( perms != NULL );
@@ -1283,6 +1294,13 @@ get_url_perms(
 			type++;
 		}
 
+#ifdef SO_REUSEPORT
+		if ( strcasecmp( type, LDAP_REUSEPORT_URLEXT ) == 0 ) {
+			skipped++;
+			continue;
+		}
+#endif /* SO_REUSEPORT */
+
 		if ( strncasecmp( type, LDAPI_MOD_URLEXT "=",
 			sizeof(LDAPI_MOD_URLEXT "=") - 1 ) == 0 )
 		{
@@ -1337,10 +1355,162 @@ get_url_perms(
 		}
 	}
 
+	/* only extensions handled elsewhere */
+	if ( skipped == i )
+		return LDAP_SUCCESS;
+
 	return LDAP_OTHER;
 }
 #endif /* LDAP_PF_LOCAL || SLAP_X_LISTENER_MOD */
 
+#ifdef SO_REUSEPORT
+static int
+get_url_reuseport(
+	char	**exts )
+{
+	int	i;
+
+	for ( i = 0; exts[ i ]; i++ ) {
+		char	*type = exts[ i ];
+
+		if ( type[ 0 ] == '!' )
+			type++;
+
+		if ( strcasecmp( type, LDAP_REUSEPORT_URLEXT ) == 0 )
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Open SO_REUSEPORT copies of a bound listener, one for each
+ * listener thread there could be. Thread 0 uses the original.
+ */
+static void
+slap_reuseport_open( Listener *l, socklen_t addrlen )
+{
+	int i, tmp, rc;
+
+	for ( i = 1; i < SLAPD_MAX_DAEMON_THREADS; i++ ) {
+		Listener *li;
+		ber_socket_t s;
+
+		s = socket( l->sl_sa.sa_addr.sa_family, SOCK_STREAM, 0 );
+		if ( s == AC_SOCKET_INVALID )
+			break;
+
+		tmp = 1;
+		rc = setsockopt( s, SOL_SOCKET, SO_REUSEADDR,
+			(char *) &tmp, sizeof(tmp) );
+		if ( rc == 0 )
+			rc = setsockopt( s, SOL_SOCKET, SO_REUSEPORT,
+				(char *) &tmp, sizeof(tmp) );
+#if defined(LDAP_PF_INET6) && defined(IPV6_V6ONLY)
+		if ( rc == 0 && l->sl_sa.sa_addr.sa_family == AF_INET6 )
+			rc = setsockopt( s, IPPROTO_IPV6, IPV6_V6ONLY,
+				(char *) &tmp, sizeof(tmp) );
+#endif /* LDAP_PF_INET6 && IPV6_V6ONLY */
+		if ( rc == 0 )
+			rc = bind( s, &l->sl_sa.sa_addr, addrlen );
+		if ( rc || SLAP_SOCKNEW( s ) >= dtblsize ) {
+			int err = sock_errno();
+			Debug( LDAP_DEBUG_ANY,
+				"daemon: %s: SO_REUSEPORT copy %d failed errno=%d\n",
+				l->sl_url.bv_val, i, err );
+			tcp_close( s );
+			break;
+		}
+
+		li = ch_malloc( sizeof( Listener ) );
+		*li = *l;
+		li->sl_sd = SLAP_SOCKNEW( s );
+		li->sl_reuseport = i + 1;
+		ber_dupbv( &li->sl_url, &l->sl_url );
+		ber_dupbv( &li->sl_name, &l->sl_name );
+
+		slap_reuseport_listeners = ch_realloc( slap_reuseport_listeners,
+			( slap_reuseport_nlisteners + 2 ) * sizeof(Listener *) );
+		slap_reuseport_listeners[slap_reuseport_nlisteners++] = li;
+		slap_reuseport_listeners[slap_reuseport_nlisteners] = NULL;
+	}
+}
+
+/*
+ * Move a listener descriptor to one that belongs to the given
+ * listener thread.
+ */
+static int
+slap_reuseport_move( Listener *l, int tid )
+{
+	int fd, d;
+
+	fd = tid;
+	while ( DAEMON_ID( l->sl_sd ) != tid && fd < dtblsize ) {
+		d = fcntl( SLAP_FD2SOCK( l->sl_sd ), F_DUPFD, fd );
+		if ( d < 0 || d >= dtblsize ) {
+			if ( d >= 0 ) close( d );
+			return -1;
+		}
+		if ( DAEMON_ID( d ) == tid ) {
+			/* not tcp_close(), that would shut down the copy too */
+			close( SLAP_FD2SOCK( l->sl_sd ) );
+			l->sl_sd = SLAP_SOCKNEW( d );
+			break;
+		}
+		close( d );
+		fd = d - DAEMON_ID( d ) + tid;
+		if ( fd <= d ) fd += slapd_daemon_mask + 1;
+	}
+
+	return DAEMON_ID( l->sl_sd ) == tid ? 0 : -1;
+}
+
+/*
+ * Now that listener-threads is known, give each listener thread its
+ * own copy of every SO_REUSEPORT listener and drop the spares.
+ */
+static void
+slap_reuseport_start( void )
+{
+	Listener *li;
+	int i, n;
+
+	if ( slap_reuseport_listeners == NULL )
+		return;
+
+	for ( n = 0; slap_listeners[n] != NULL; n++ ) {
+		li = slap_listeners[n];
+		if ( li->sl_reuseport && slap_reuseport_move( li, 0 ) ) {
+			Debug( LDAP_DEBUG_ANY, "daemon: %s: "
+				"unable to move listener to thread 0\n",
+				li->sl_url.bv_val, 0, 0 );
+		}
+	}
+	slap_listeners = ch_realloc( slap_listeners,
+		( n + slap_reuseport_nlisteners + 1 ) * sizeof(Listener *) );
+
+	for ( i = 0; slap_reuseport_listeners[i] != NULL; i++ ) {
+		li = slap_reuseport_listeners[i];
+		if ( li->sl_reuseport <= slapd_daemon_threads &&
+			slap_reuseport_move( li, li->sl_reuseport - 1 ) == 0 )
+		{
+			slap_listeners[n++] = li;
+			continue;
+		}
+		slapd_close( li->sl_sd );
+		ber_memfree( li->sl_url.bv_val );
+		ber_memfree( li->sl_name.bv_val );
+		free( li );
+	}
+	slap_listeners[n] = NULL;
+
+	free( slap_reuseport_listeners );
+	slap_reuseport_listeners = NULL;
+	slap_reuseport_nlisteners = 0;
+}
+#endif /* SO_REUSEPORT */
+
 /* port = 0 indicates AF_LOCAL */
 static int
 slap_get_listener_addresses(
@@ -1504,6 +1674,7 @@ slap_open_listener(
 	struct sockaddr **sal = NULL, **psal;
 	int socktype = SOCK_STREAM;	/* default to COTS */
 	ber_socket_t s;
+	int reuseport = 0;
 
 #if defined(LDAP_PF_LOCAL) || defined(SLAP_X_LISTENER_MOD)
 	/*
@@ -1524,6 +1695,7 @@ slap_open_listener(
 	l.sl_url.bv_val = NULL;
 	l.sl_mute = 0;
 	l.sl_busy = 0;
+	l.sl_reuseport = 0;
 
 #ifndef HAVE_TLS
 	if( ldap_pvt_url_scheme2tls( lud->lud_scheme ) ) {
@@ -1580,13 +1752,19 @@ slap_open_listener(
 #endif /* LDAP_CONNECTIONLESS */
 
 #if defined(LDAP_PF_LOCAL) || defined(SLAP_X_LISTENER_MOD)
+	l.sl_perms = S_IRWXU | S_IRWXO;
 	if ( lud->lud_exts ) {
 		err = get_url_perms( lud->lud_exts, &l.sl_perms, &crit );
-	} else {
-		l.sl_perms = S_IRWXU | S_IRWXO;
 	}
 #endif /* LDAP_PF_LOCAL || SLAP_X_LISTENER_MOD */
 
+#ifdef SO_REUSEPORT
+	/* only meaningful for stream sockets on IP */
+	if ( lud->lud_exts && tmp == LDAP_PROTO_TCP ) {
+		reuseport = get_url_reuseport( lud->lud_exts );
+	}
+#endif /* SO_REUSEPORT */
+
 	ldap_free_urldesc( lud );
 	if ( err ) {
 		slap_free_listener_addresses(sal);
@@ -1667,6 +1845,19 @@ slap_open_listener(
 					(long) l.sl_sd, err, sock_errstr(err) );
 			}
 #endif /* SO_REUSEADDR */
+#ifdef SO_REUSEPORT
+			if ( reuseport ) {
+				tmp = 1;
+				rc = setsockopt( s, SOL_SOCKET, SO_REUSEPORT,
+					(char *) &tmp, sizeof(tmp) );
+				if ( rc == AC_SOCKET_ERROR ) {
+					int err = sock_errno();
+					Debug( LDAP_DEBUG_ANY, "slapd(%ld): "
+						"setsockopt(SO_REUSEPORT) failed errno=%d (%s)\n",
+						(long) l.sl_sd, err, sock_errstr(err) );
+				}
+			}
+#endif /* SO_REUSEPORT */
 		}
 
 		switch( (*sal)->sa_family ) {
@@ -1794,6 +1985,12 @@ slap_open_listener(
 		*li = l;
 		slap_listeners[*cur] = li;
 		(*cur)++;
+#ifdef SO_REUSEPORT
+		if ( reuseport ) {
+			li->sl_reuseport = 1;
+			slap_reuseport_open( li, addrlen );
+		}
+#endif /* SO_REUSEPORT */
 		sal++;
 	}
 
@@ -2002,6 +2199,20 @@ destroy_listeners( void )
 
 	free( slap_listeners );
 	slap_listeners = NULL;
+
+#ifdef SO_REUSEPORT
+	/* never handed out */
+	if ( slap_reuseport_listeners ) {
+		for ( ll = slap_reuseport_listeners; (lr = *ll) != NULL; ll++ ) {
+			slapd_close( lr->sl_sd );
+			ber_memfree( lr->sl_url.bv_val );
+			ber_memfree( lr->sl_name.bv_val );
+			free( lr );
+		}
+		free( slap_reuseport_listeners );
+		slap_reuseport_listeners = NULL;
+	}
+#endif /* SO_REUSEPORT */
 }
 
 static int
@@ -3122,6 +3333,10 @@ slapd_daemon( void )
 	if ( slapd_daemon_threads > SLAPD_MAX_DAEMON_THREADS )
 		slapd_daemon_threads = SLAPD_MAX_DAEMON_THREADS;
 
+#ifdef SO_REUSEPORT
+	slap_reuseport_start();
+#endif /* SO_REUSEPORT */
+
 	listener_tid = ch_malloc(slapd_daemon_threads * sizeof(ldap_pvt_thread_t));
 
 	/* daemon_init only inits element 0 */
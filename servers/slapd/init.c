@@ -252,6 +252,8 @@ int slap_destroy(void)
 
 	slap_sasl_destroy();
 
+	slap_passwd_destroy();
+
 	/* rootdse destroy goes before entry_destroy()
 	 * because it may use entry_free() */
 	root_dse_destroy();
@@ -298,6 +300,7 @@ void slap_counters_init( slap_counters_t *sc )
 		ldap_pvt_mp_init( sc->sc_ops_initiated_[ i ] );
 		ldap_pvt_mp_init( sc->sc_ops_completed_[ i ] );
 	}
+	memset( sc->sc_phase_hist, 0, sizeof( sc->sc_phase_hist ));
 #endif /* SLAPD_MONITOR */
 }
 
@@ -253,6 +253,7 @@ mr_add(
 	smr->smr_match = def->mrd_match;
 	smr->smr_indexer = def->mrd_indexer;
 	smr->smr_filter = def->mrd_filter;
+	smr->smr_ngram = def->mrd_ngram;
 	smr->smr_associated = amr;
 
 	if ( smr->smr_syntax_oid ) {
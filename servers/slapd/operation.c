@@ -246,3 +246,111 @@ slap_req2op( ber_tag_t tag )
 
 	return SLAP_OP_LAST;
 }
+
+const char *slap_phase_names[] = {
+	"decode",
+	"queue",
+	"candidates",
+	"entry",
+	"acl",
+	"encode",
+	"write",
+	NULL
+};
+
+const char *slap_phase_buckets[] = {
+	"<10us",
+	"<100us",
+	"<1ms",
+	"<10ms",
+	"<100ms",
+	"<1s",
+	">=1s",
+	NULL
+};
+
+static time_t slowop_last;
+static unsigned long slowop_suppressed;
+
+void
+slap_op_phase_end( Operation *op, slap_phase_t phase, struct timeval *start )
+{
+	struct timeval now;
+	long usec;
+
+	gettimeofday( &now, NULL );
+	usec = ( now.tv_sec - start->tv_sec ) * 1000000L
+		+ now.tv_usec - start->tv_usec;
+	/* ignore the clock stepping backwards */
+	if ( usec > 0 )
+		op->o_phase[ phase ] += usec;
+}
+
+/* Called once an operation completes: fold its phase timings into
+ * the per-thread histograms and dump it if it was slow. Dumps are
+ * limited to one per second, the others are only counted.
+ */
+void
+slap_op_phase_finish( Operation *op )
+{
+	struct timeval now;
+	unsigned long etime, suppressed = 0;
+	int i, dump = 0;
+
+	if ( !slap_optrace || op->o_counters == NULL )
+		return;
+
+	gettimeofday( &now, NULL );
+	etime = ( now.tv_sec - op->o_time ) * 1000000L
+		+ now.tv_usec - op->o_tusec;
+	op->o_phase[ SLAP_PHASE_QUEUE ] = op->o_qtime.tv_sec * 1000000L
+		+ op->o_qtime.tv_usec;
+
+#ifdef SLAPD_MONITOR
+	ldap_pvt_thread_mutex_lock( &op->o_counters->sc_mutex );
+	for ( i = 0; i < SLAP_PHASE_LAST; i++ ) {
+		unsigned long limit;
+		int j;
+
+		/* only count the phases this operation went through */
+		if ( !op->o_phase[ i ] )
+			continue;
+		for ( j = 0, limit = 10; j < SLAP_PHASE_BUCKETS - 1 &&
+			op->o_phase[ i ] >= limit; j++, limit *= 10 )
+			;
+		op->o_counters->sc_phase_hist[ i ][ j ]++;
+	}
+	ldap_pvt_thread_mutex_unlock( &op->o_counters->sc_mutex );
+#endif /* SLAPD_MONITOR */
+
+	if ( !slap_slowop_threshold ||
+		etime < slap_slowop_threshold * 1000UL )
+		return;
+
+	ldap_pvt_thread_mutex_lock( &slap_op_mutex );
+	if ( now.tv_sec != slowop_last ) {
+		slowop_last = now.tv_sec;
+		suppressed = slowop_suppressed;
+		slowop_suppressed = 0;
+		dump = 1;
+	} else {
+		slowop_suppressed++;
+	}
+	ldap_pvt_thread_mutex_unlock( &slap_op_mutex );
+
+	if ( dump ) {
+		char buf[ SLAP_TEXT_BUFLEN ], *ptr = buf;
+		int len;
+
+		len = snprintf( ptr, sizeof( buf ), "etime=%lu.%06lu",
+			etime / 1000000, etime % 1000000 );
+		for ( i = 0; i < SLAP_PHASE_LAST && len > 0 &&
+			len < buf + sizeof( buf ) - ptr; i++ ) {
+			ptr += len;
+			len = snprintf( ptr, buf + sizeof( buf ) - ptr, " %s=%lu",
+				slap_phase_names[ i ], op->o_phase[ i ] );
+		}
+		Debug( LDAP_DEBUG_ANY, "%s SLOW %s (%lu suppressed)\n",
+			op->o_log_prefix, buf, suppressed );
+	}
+}
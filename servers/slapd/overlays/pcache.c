@@ -66,10 +66,18 @@ struct query_template_s;
 
 typedef struct Qbase_s {
 	TAvlnode *scopes[4];		/* threaded AVL trees of cached queries */
+	Avlnode *prefixes[4];		/* substring queries by initial component */
 	struct berval base;
 	int queries;
 } Qbase;
 
+/* cached queries whose first filter component is a substring
+ * assertion, grouped by its initial component (empty if absent) */
+typedef struct Qprefix_s {
+	struct berval initial;
+	struct cached_query_s *queries;
+} Qprefix;
+
 /* struct representing a cached query */
 typedef struct cached_query_s {
 	Filter					*filter;
@@ -90,6 +98,9 @@ typedef struct cached_query_s {
 	struct cached_query_s  		*prev;  	/* previous query in the template */
 	struct cached_query_s		*lru_up;	/* previous query in the LRU list */
 	struct cached_query_s		*lru_down;	/* next query in the LRU list */
+	Qprefix					*qprefix;	/* substring prefix index bucket */
+	struct cached_query_s		*pnext;		/* next query in the bucket */
+	struct cached_query_s		*pprev;		/* previous query in the bucket */
 	ldap_pvt_thread_rdwr_t		rwlock;
 } CachedQuery;
 
@@ -172,6 +183,18 @@ static const char *pc_caching_reason_str[] = {
 	NULL
 };
 
+/* upper bounds of the lookup latency histogram buckets */
+static const char *pc_latency_str[] = {
+	"<10us",
+	"<100us",
+	"<1ms",
+	"<10ms",
+	"<100ms",
+	">=100ms",
+
+	NULL
+};
+
 struct query_manager_s;
 
 /* prototypes for functions for 1) query containment
@@ -193,6 +216,11 @@ typedef struct query_manager_s {
 
 	ldap_pvt_thread_mutex_t		lru_mutex;	/* mutex for accessing LRU list */
 
+	/* histogram of query containment lookup latency */
+#define PC_LATENCY_BUCKETS	6
+	unsigned long		lookup_latency[PC_LATENCY_BUCKETS];
+	ldap_pvt_thread_mutex_t		stats_mutex;
+
 	/* Query cache methods */
 	QCfunc			*qcfunc;			/* Query containment*/
 	CRfunc 			*crfunc;			/* cache replacement */
@@ -250,7 +278,8 @@ static int privDB_cid;
 static AttributeDescription	*ad_queryId, *ad_cachedQueryURL;
 
 #ifdef PCACHE_MONITOR
-static AttributeDescription	*ad_numQueries, *ad_numEntries;
+static AttributeDescription	*ad_numQueries, *ad_numEntries,
+				*ad_lookupLatency;
 static ObjectClass		*oc_olmPCache;
 #endif /* PCACHE_MONITOR */
 
@@ -302,6 +331,14 @@ static struct {
 		"NO-USER-MODIFICATION "
 		"USAGE directoryOperation )",
 		&ad_numEntries },
+	{ "( PCacheAttributes:5 "
+		"NAME 'pcacheLookupLatency' "
+		"DESC 'Histogram of query containment lookup latency' "
+		"EQUALITY caseIgnoreMatch "
+		"SYNTAX 1.3.6.1.4.1.1466.115.121.1.15 "
+		"NO-USER-MODIFICATION "
+		"USAGE directoryOperation )",
+		&ad_lookupLatency },
 #endif /* PCACHE_MONITOR */
 
 	{ NULL }
@@ -320,6 +357,7 @@ static struct {
 			"pcacheQueryURL "
 			"$ pcacheNumQueries "
 			"$ pcacheNumEntries "
+			"$ pcacheLookupLatency "
 			" ) )",
 		&oc_olmPCache },
 #endif /* PCACHE_MONITOR */
@@ -909,6 +947,17 @@ static int pcache_dn_cmp( const void *v1, const void *v2 )
 	return rc;
 }
 
+/* Length-ordered sort on substring initial components */
+static int pcache_prefix_cmp( const void *v1, const void *v2 )
+{
+	const Qprefix *p1 = v1, *p2 = v2;
+
+	int rc = p1->initial.bv_len - p2->initial.bv_len;
+	if ( rc == 0 && p1->initial.bv_len )
+		rc = memcmp( p1->initial.bv_val, p2->initial.bv_val, p1->initial.bv_len );
+	return rc;
+}
+
 static int lex_bvcmp( struct berval *bv1, struct berval *bv2 )
 {
 	int len, dif;
@@ -1271,163 +1320,215 @@ typedef struct fstack {
 	Filter *fs_fi;
 } fstack;
 
-static CachedQuery *
-find_filter( Operation *op, TAvlnode *root, Filter *inputf, Filter *first )
+/* check whether the cached filter fs contains the incoming filter fi.
+ * Returns 1 if it does, 0 if it doesn't, -1 on error; *eqmiss is set
+ * if the first component is an equality assertion that doesn't match,
+ * since no further equality query in sort order can match either.
+ */
+static int
+filter_containment( Operation *op, Filter *fs, Filter *fi, Filter *first,
+	int *eqmiss )
 {
-	Filter* fs;
-	Filter* fi;
 	MatchingRule* mrule = NULL;
-	int res=0, eqpass= 0;
-	int ret, rc, dir;
+	int res=0;
+	int ret, rc;
+	fstack *stack = NULL, *fsp;
+
+	do {
+		res=0;
+		switch (fs->f_choice) {
+		case LDAP_FILTER_EQUALITY:
+			if (fi->f_choice == LDAP_FILTER_EQUALITY)
+				mrule = fs->f_ava->aa_desc->ad_type->sat_equality;
+			else
+				ret = 1;
+			break;
+		case LDAP_FILTER_GE:
+		case LDAP_FILTER_LE:
+			mrule = fs->f_ava->aa_desc->ad_type->sat_ordering;
+			break;
+		default:
+			mrule = NULL; 
+		}
+		if (mrule) {
+			const char *text;
+			rc = value_match(&ret, fs->f_ava->aa_desc, mrule,
+				SLAP_MR_VALUE_OF_ASSERTION_SYNTAX,
+				&(fi->f_ava->aa_value),
+				&(fs->f_ava->aa_value), &text);
+			if (rc != LDAP_SUCCESS) {
+				res = -1;
+				break;
+			}
+			if ( fi==first && fi->f_choice==LDAP_FILTER_EQUALITY && ret ) {
+				*eqmiss = 1;
+				res = 0;
+				break;
+			}
+		}
+		switch (fs->f_choice) {
+		case LDAP_FILTER_OR:
+		case LDAP_FILTER_AND:
+			if ( fs->f_next ) {
+				/* save our stack position */
+				fsp = op->o_tmpalloc(sizeof(fstack), op->o_tmpmemctx);
+				fsp->fs_next = stack;
+				fsp->fs_fs = fs->f_next;
+				fsp->fs_fi = fi->f_next;
+				stack = fsp;
+			}
+			fs = fs->f_and;
+			fi = fi->f_and;
+			res=1;
+			break;
+		case LDAP_FILTER_SUBSTRINGS:
+			/* check if the equality query can be
+			* answered with cached substring query */
+			if ((fi->f_choice == LDAP_FILTER_EQUALITY)
+				&& substr_containment_equality( op,
+				fs, fi))
+				res=1;
+			/* check if the substring query can be
+			* answered with cached substring query */
+			if ((fi->f_choice ==LDAP_FILTER_SUBSTRINGS
+				) && substr_containment_substr( op,
+				fs, fi))
+				res= 1;
+			fs=fs->f_next;
+			fi=fi->f_next;
+			break;
+		case LDAP_FILTER_PRESENT:
+			res=1;
+			fs=fs->f_next;
+			fi=fi->f_next;
+			break;
+		case LDAP_FILTER_EQUALITY:
+			if (ret == 0)
+				res = 1;
+			fs=fs->f_next;
+			fi=fi->f_next;
+			break;
+		case LDAP_FILTER_GE:
+			if (mrule && ret >= 0)
+				res = 1;
+			fs=fs->f_next;
+			fi=fi->f_next;
+			break;
+		case LDAP_FILTER_LE:
+			if (mrule && ret <= 0)
+				res = 1;
+			fs=fs->f_next;
+			fi=fi->f_next;
+			break;
+		case LDAP_FILTER_NOT:
+			res=0;
+			break;
+		default:
+			break;
+		}
+		if (!fs && !fi && stack) {
+			/* pop the stack */
+			fsp = stack;
+			stack = fsp->fs_next;
+			fs = fsp->fs_fs;
+			fi = fsp->fs_fi;
+			op->o_tmpfree(fsp, op->o_tmpmemctx);
+		}
+	} while((res > 0) && (fi != NULL) && (fs != NULL));
+
+	while ( stack ) {
+		fsp = stack;
+		stack = fsp->fs_next;
+		op->o_tmpfree(fsp, op->o_tmpmemctx);
+	}
+
+	return res;
+}
+
+/* a cached substring query can only contain the incoming query
+ * if its initial component is a prefix of the incoming initial
+ * component (or equality value), so only the buckets of the
+ * prefix index keyed by the prefixes of val need to be checked,
+ * longest first.
+ */
+static CachedQuery *
+find_substr_filter( Operation *op, Avlnode *root, Filter *inputf,
+	Filter *first, struct berval *val )
+{
+	Qprefix *qp, qpkey;
+	CachedQuery *qc;
+	int rc, eqmiss = 0;
+
+	if ( root == NULL )
+		return NULL;
+
+	qpkey.initial.bv_val = val->bv_val;
+	qpkey.initial.bv_len = BER_BVISNULL( val ) ? 0 : val->bv_len;
+	for (;;) {
+		qp = avl_find( root, &qpkey, pcache_prefix_cmp );
+		if ( qp ) {
+			for ( qc = qp->queries; qc; qc = qc->pnext ) {
+				rc = filter_containment( op, qc->filter, inputf,
+					first, &eqmiss );
+				if ( rc < 0 )
+					return NULL;
+				if ( rc )
+					return qc;
+			}
+		}
+		if ( qpkey.initial.bv_len == 0 )
+			break;
+		qpkey.initial.bv_len--;
+	}
+	return NULL;
+}
+
+static CachedQuery *
+find_filter( Operation *op, Qbase *qbase, int scope, Filter *inputf,
+	Filter *first )
+{
+	int ret, rc, dir, eqmiss;
 	TAvlnode *ptr;
 	CachedQuery cq, *qc;
-	fstack *stack = NULL, *fsp;
+
+	/* an incoming substr query can only be satisfied by a cached
+	 * substr query.
+	 */
+	if ( first->f_choice == LDAP_FILTER_SUBSTRINGS )
+		return find_substr_filter( op, qbase->prefixes[scope], inputf,
+			first, &first->f_sub_initial );
 
 	cq.filter = inputf;
 	cq.first = first;
 
-	/* substring matches sort to the end, and we just have to
-	 * walk the entire list.
-	 */
-	if ( first->f_choice == LDAP_FILTER_SUBSTRINGS ) {
-		ptr = tavl_end( root, 1 );
-		dir = TAVL_DIR_LEFT;
-	} else {
-		ptr = tavl_find3( root, &cq, pcache_query_cmp, &ret );
-		dir = (first->f_choice == LDAP_FILTER_GE) ? TAVL_DIR_LEFT :
-			TAVL_DIR_RIGHT;
-	}
+	ptr = tavl_find3( qbase->scopes[scope], &cq, pcache_query_cmp, &ret );
+	dir = (first->f_choice == LDAP_FILTER_GE) ? TAVL_DIR_LEFT :
+		TAVL_DIR_RIGHT;
 
-	while (ptr) {
+	for ( ; ptr; ptr = tavl_next( ptr, dir ) ) {
 		qc = ptr->avl_data;
-		fi = inputf;
-		fs = qc->filter;
-
-		/* an incoming substr query can only be satisfied by a cached
-		 * substr query.
-		 */
-		if ( first->f_choice == LDAP_FILTER_SUBSTRINGS &&
-			qc->first->f_choice != LDAP_FILTER_SUBSTRINGS )
-			break;
 
 		/* an incoming eq query can be satisfied by a cached eq or substr
-		 * query
+		 * query; the latter are found through the prefix index below
 		 */
-		if ( first->f_choice == LDAP_FILTER_EQUALITY ) {
-			if ( eqpass == 0 ) {
-				if ( qc->first->f_choice != LDAP_FILTER_EQUALITY ) {
-nextpass:			eqpass = 1;
-					ptr = tavl_end( root, 1 );
-					dir = TAVL_DIR_LEFT;
-					continue;
-				}
-			} else {
-				if ( qc->first->f_choice != LDAP_FILTER_SUBSTRINGS )
-					break;
-			}
-		}
-		do {
-			res=0;
-			switch (fs->f_choice) {
-			case LDAP_FILTER_EQUALITY:
-				if (fi->f_choice == LDAP_FILTER_EQUALITY)
-					mrule = fs->f_ava->aa_desc->ad_type->sat_equality;
-				else
-					ret = 1;
-				break;
-			case LDAP_FILTER_GE:
-			case LDAP_FILTER_LE:
-				mrule = fs->f_ava->aa_desc->ad_type->sat_ordering;
-				break;
-			default:
-				mrule = NULL; 
-			}
-			if (mrule) {
-				const char *text;
-				rc = value_match(&ret, fs->f_ava->aa_desc, mrule,
-					SLAP_MR_VALUE_OF_ASSERTION_SYNTAX,
-					&(fi->f_ava->aa_value),
-					&(fs->f_ava->aa_value), &text);
-				if (rc != LDAP_SUCCESS) {
-					return NULL;
-				}
-				if ( fi==first && fi->f_choice==LDAP_FILTER_EQUALITY && ret )
-					goto nextpass;
-			}
-			switch (fs->f_choice) {
-			case LDAP_FILTER_OR:
-			case LDAP_FILTER_AND:
-				if ( fs->f_next ) {
-					/* save our stack position */
-					fsp = op->o_tmpalloc(sizeof(fstack), op->o_tmpmemctx);
-					fsp->fs_next = stack;
-					fsp->fs_fs = fs->f_next;
-					fsp->fs_fi = fi->f_next;
-					stack = fsp;
-				}
-				fs = fs->f_and;
-				fi = fi->f_and;
-				res=1;
-				break;
-			case LDAP_FILTER_SUBSTRINGS:
-				/* check if the equality query can be
-				* answered with cached substring query */
-				if ((fi->f_choice == LDAP_FILTER_EQUALITY)
-					&& substr_containment_equality( op,
-					fs, fi))
-					res=1;
-				/* check if the substring query can be
-				* answered with cached substring query */
-				if ((fi->f_choice ==LDAP_FILTER_SUBSTRINGS
-					) && substr_containment_substr( op,
-					fs, fi))
-					res= 1;
-				fs=fs->f_next;
-				fi=fi->f_next;
-				break;
-			case LDAP_FILTER_PRESENT:
-				res=1;
-				fs=fs->f_next;
-				fi=fi->f_next;
-				break;
-			case LDAP_FILTER_EQUALITY:
-				if (ret == 0)
-					res = 1;
-				fs=fs->f_next;
-				fi=fi->f_next;
-				break;
-			case LDAP_FILTER_GE:
-				if (mrule && ret >= 0)
-					res = 1;
-				fs=fs->f_next;
-				fi=fi->f_next;
-				break;
-			case LDAP_FILTER_LE:
-				if (mrule && ret <= 0)
-					res = 1;
-				fs=fs->f_next;
-				fi=fi->f_next;
-				break;
-			case LDAP_FILTER_NOT:
-				res=0;
-				break;
-			default:
-				break;
-			}
-			if (!fs && !fi && stack) {
-				/* pop the stack */
-				fsp = stack;
-				stack = fsp->fs_next;
-				fs = fsp->fs_fs;
-				fi = fsp->fs_fi;
-				op->o_tmpfree(fsp, op->o_tmpmemctx);
-			}
-		} while((res) && (fi != NULL) && (fs != NULL));
+		if ( first->f_choice == LDAP_FILTER_EQUALITY &&
+			qc->first->f_choice != LDAP_FILTER_EQUALITY )
+			break;
 
-		if ( res )
+		eqmiss = 0;
+		rc = filter_containment( op, qc->filter, inputf, first, &eqmiss );
+		if ( rc < 0 )
+			return NULL;
+		if ( rc )
 			return qc;
-		ptr = tavl_next( ptr, dir );
+		if ( eqmiss )
+			break;
 	}
+
+	if ( first->f_choice == LDAP_FILTER_EQUALITY )
+		return find_substr_filter( op, qbase->prefixes[scope], inputf,
+			first, &first->f_av_value );
+
 	return NULL;
 }
 
@@ -1501,7 +1602,7 @@ query_containment(Operation *op, query_manager *qm,
 					if ( !qbptr->scopes[tscope] ) continue;
 
 					/* Find filter */
-					qc = find_filter( op, qbptr->scopes[tscope],
+					qc = find_filter( op, qbptr, tscope,
 							query->filter, first );
 					if ( qc ) {
 						if ( qc->q_sizelimit ) {
@@ -1534,6 +1635,96 @@ query_containment(Operation *op, query_manager *qm,
 	return NULL;
 }
 
+#ifdef PCACHE_MONITOR
+/* wrapper around query_containment that records how long
+ * the lookup took in the lookup latency histogram; only
+ * installed while the histogram is shown in cn=monitor
+ */
+static CachedQuery *
+query_containment_timed(Operation *op, query_manager *qm,
+		  Query *query,
+		  QueryTemplate *templa)
+{
+	CachedQuery *qc;
+	struct timeval start, end;
+	long usec, limit;
+	int i;
+
+	gettimeofday( &start, NULL );
+	qc = query_containment( op, qm, query, templa );
+	gettimeofday( &end, NULL );
+
+	usec = ( end.tv_sec - start.tv_sec ) * 1000000L
+		+ ( end.tv_usec - start.tv_usec );
+	for ( i = 0, limit = 10; i < PC_LATENCY_BUCKETS - 1 && usec >= limit;
+		i++, limit *= 10 )
+		;
+
+	ldap_pvt_thread_mutex_lock( &qm->stats_mutex );
+	qm->lookup_latency[i]++;
+	ldap_pvt_thread_mutex_unlock( &qm->stats_mutex );
+
+	return qc;
+}
+#endif /* PCACHE_MONITOR */
+
+/* add a cached query to the substring prefix index of its base */
+static void
+pcache_prefix_insert( Qbase *qbase, CachedQuery *qc )
+{
+	Qprefix *qp, qpkey;
+
+	qc->qprefix = NULL;
+	qc->pnext = NULL;
+	qc->pprev = NULL;
+	if ( qc->first->f_choice != LDAP_FILTER_SUBSTRINGS )
+		return;
+
+	qpkey.initial = qc->first->f_sub_initial;
+	if ( BER_BVISNULL( &qpkey.initial ))
+		qpkey.initial.bv_len = 0;
+	qp = avl_find( qbase->prefixes[qc->scope], &qpkey, pcache_prefix_cmp );
+	if ( !qp ) {
+		qp = ch_calloc( 1, sizeof(Qprefix) + qpkey.initial.bv_len + 1 );
+		qp->initial.bv_len = qpkey.initial.bv_len;
+		qp->initial.bv_val = (char *)(qp+1);
+		if ( qpkey.initial.bv_len )
+			memcpy( qp->initial.bv_val, qpkey.initial.bv_val,
+				qpkey.initial.bv_len );
+		qp->initial.bv_val[qp->initial.bv_len] = '\0';
+		avl_insert( &qbase->prefixes[qc->scope], qp, pcache_prefix_cmp,
+			avl_dup_error );
+	}
+	qc->qprefix = qp;
+	qc->pnext = qp->queries;
+	if ( qp->queries )
+		qp->queries->pprev = qc;
+	qp->queries = qc;
+}
+
+static void
+pcache_prefix_delete( Qbase *qbase, CachedQuery *qc )
+{
+	Qprefix *qp = qc->qprefix;
+
+	if ( !qp )
+		return;
+
+	if ( qc->pnext )
+		qc->pnext->pprev = qc->pprev;
+	if ( qc->pprev )
+		qc->pprev->pnext = qc->pnext;
+	else
+		qp->queries = qc->pnext;
+	if ( qp->queries == NULL ) {
+		avl_delete( &qbase->prefixes[qc->scope], qp, pcache_prefix_cmp );
+		ch_free( qp );
+	}
+	qc->qprefix = NULL;
+	qc->pnext = NULL;
+	qc->pprev = NULL;
+}
+
 static void
 free_query (CachedQuery* qc)
 {
@@ -1631,6 +1822,7 @@ add_query(
 	rc = tavl_insert( &qbase->scopes[query->scope], new_cached_query,
 		pcache_query_cmp, avl_dup_error );
 	if ( rc == 0 ) {
+		pcache_prefix_insert( qbase, new_cached_query );
 		qbase->queries++;
 		if (templ->query == NULL)
 			templ->query_last = new_cached_query;
@@ -1644,7 +1836,7 @@ add_query(
 			ldap_pvt_thread_rdwr_wunlock(&new_cached_query->rwlock);
 		ldap_pvt_thread_rdwr_destroy( &new_cached_query->rwlock );
 		ch_free( new_cached_query );
-		new_cached_query = find_filter( op, qbase->scopes[query->scope],
+		new_cached_query = find_filter( op, qbase, query->scope,
 							query->filter, first );
 		filter_free( query->filter );
 		query->filter = NULL;
@@ -1681,6 +1873,7 @@ remove_from_template (CachedQuery* qc, QueryTemplate* template)
 		qc->prev->next = qc->next;
 	}
 	tavl_delete( &qc->qbase->scopes[qc->scope], qc, pcache_query_cmp );
+	pcache_prefix_delete( qc->qbase, qc );
 	qc->qbase->queries--;
 	if ( qc->qbase->queries == 0 ) {
 		avl_delete( &template->qbase, qc->qbase, pcache_dn_cmp );
@@ -4526,11 +4719,13 @@ pcache_db_init(
 	qm->templates = NULL;
 	qm->lru_top = NULL;
 	qm->lru_bottom = NULL;
+	memset( qm->lookup_latency, 0, sizeof( qm->lookup_latency ));
 
 	qm->qcfunc = query_containment;
 	qm->crfunc = cache_replacement;
 	qm->addfunc = add_query;
 	ldap_pvt_thread_mutex_init(&qm->lru_mutex);
+	ldap_pvt_thread_mutex_init(&qm->stats_mutex);
 
 	ldap_pvt_thread_mutex_init(&cm->cache_mutex);
 
@@ -4772,6 +4967,8 @@ pcache_free_qbase( void *v )
 
 	for (i=0; i<3; i++)
 		tavl_free( qb->scopes[i], NULL );
+	for (i=0; i<4; i++)
+		avl_free( qb->prefixes[i], ch_free );
 	ch_free( qb );
 }
 
@@ -4934,6 +5131,7 @@ pcache_db_destroy(
 	qm->attr_sets = NULL;
 
 	ldap_pvt_thread_mutex_destroy( &qm->lru_mutex );
+	ldap_pvt_thread_mutex_destroy( &qm->stats_mutex );
 	ldap_pvt_thread_mutex_destroy( &cm->cache_mutex );
 	free( qm );
 	free( cm );
@@ -5407,6 +5605,24 @@ pcache_monitor_update(
 		}
 	}
 
+	attr_delete( &e->e_attrs, ad_lookupLatency );
+	{
+		struct berval	vals[ PC_LATENCY_BUCKETS + 1 ];
+		char		buf[ PC_LATENCY_BUCKETS ][ SLAP_TEXT_BUFLEN ];
+		int		i;
+
+		ldap_pvt_thread_mutex_lock( &qm->stats_mutex );
+		for ( i = 0; i < PC_LATENCY_BUCKETS; i++ ) {
+			vals[ i ].bv_val = buf[ i ];
+			vals[ i ].bv_len = snprintf( buf[ i ], sizeof( buf[ i ] ),
+				"%s %lu", pc_latency_str[ i ], qm->lookup_latency[ i ] );
+		}
+		ldap_pvt_thread_mutex_unlock( &qm->stats_mutex );
+		BER_BVZERO( &vals[ i ] );
+
+		attr_merge_normalize( e, ad_lookupLatency, vals, NULL );
+	}
+
 	{
 		Attribute	*a;
 		char		buf[ SLAP_TEXT_BUFLEN ];
@@ -5492,6 +5708,14 @@ pcache_monitor_free(
 		textbuf, sizeof( textbuf ) );
 	/* don't care too much about return code... */
 
+	/* remove attrs */
+	mod.sm_values = NULL;
+	mod.sm_desc = ad_lookupLatency;
+	mod.sm_numvals = 0;
+	rc = modify_delete_values( e, &mod, 1, &text,
+		textbuf, sizeof( textbuf ) );
+	/* don't care too much about return code... */
+
 	return SLAP_CB_CONTINUE;
 }
 
@@ -5612,6 +5836,11 @@ cleanup:;
 	/* store for cleanup */
 	cm->monitor_cb = (void *)cb;
 
+	/* only time lookups when someone can see the result */
+	if ( cb != NULL ) {
+		cm->qm->qcfunc = query_containment_timed;
+	}
+
 	/* we don't need to keep track of the attributes, because
 	 * bdb_monitor_free() takes care of everything */
 	if ( a != NULL ) {
@@ -5637,6 +5866,7 @@ pcache_monitor_db_close( BackendDB *be )
 				(monitor_callback_t *)cm->monitor_cb,
 				NULL, 0, NULL );
 		}
+		cm->qm->qcfunc = query_containment;
 	}
 
 	return 0;
@@ -118,25 +118,73 @@ typedef struct syncmatches {
 
 /* Session log data */
 typedef struct slog_entry {
-	struct slog_entry *se_next;
 	struct berval se_uuid;
 	struct berval se_csn;
 	int	se_sid;
 	ber_tag_t	se_tag;
 } slog_entry;
 
+typedef struct slog_sid {
+	int	ss_sid;
+	int	ss_num;		/* entries from this SID in the log */
+} slog_sid;
+
 typedef struct sessionlog {
+	/* these three must match the start of struct sync_cookie */
 	BerVarray	sl_mincsn;
 	int		*sl_sids;
 	int		sl_numcsns;
 	int		sl_num;
 	int		sl_size;
-	int		sl_playing;
-	slog_entry *sl_head;
-	slog_entry *sl_tail;
-	ldap_pvt_thread_mutex_t sl_mutex;
+	/* ring of sl_mask+1 slots, sl_num entries in CSN order
+	 * starting at sl_first */
+	slog_entry **sl_ring;
+	int		sl_mask;
+	int		sl_first;
+	/* SIDs that have entries in the log, sorted */
+	slog_sid *sl_logsids;
+	int		sl_numlogsids;
+	ldap_pvt_thread_rdwr_t sl_rwlock;
 } sessionlog;
 
+#define SLOG_ENTRY(sl, i)	((sl)->sl_ring[((sl)->sl_first + (i)) & (sl)->sl_mask])
+
+/* A Present phase UUID scan shared by concurrent consumers. The scan
+ * is run once by the first consumer to ask for it; anyone else asking
+ * for the same search against the same contextCSN while it is still
+ * referenced reads the collected UUIDs instead of scanning again. Each
+ * consumer sends its own syncIdSets from its own thread, so a slow one
+ * never holds up the scan or the other consumers. Besides the identity
+ * and security strengths, where the connection comes from must match
+ * if any ACL of the database looks at it.
+ */
+typedef struct syncpres {
+	struct syncpres *sp_next;
+	struct berval	sp_ndn;		/* identity the scan ran as */
+	struct berval	sp_conn_ndn;
+	struct berval	sp_peername;
+	struct berval	sp_domain;
+	struct berval	sp_sockname;
+	struct berval	sp_sockurl;
+	slap_ssf_t	sp_ssf;
+	slap_ssf_t	sp_transport_ssf;
+	slap_ssf_t	sp_tls_ssf;
+	slap_ssf_t	sp_sasl_ssf;
+	struct berval	sp_base;
+	struct berval	sp_filterstr;
+	int		sp_scope;
+	int		sp_deref;
+	BerVarray	sp_ctxcsn;	/* contextCSN the scan is valid for */
+	int		sp_numcsns;
+	char	*sp_uuids;	/* UUID_LEN bytes each */
+	int		sp_num;
+	int		sp_max;
+	int		sp_refcnt;
+	int		sp_done;	/* scan has finished */
+	int		sp_rc;
+	ldap_pvt_thread_cond_t	sp_cond;
+} syncpres;
+
 /* The main state for this overlay */
 typedef struct syncprov_info_t {
 	syncops		*si_ops;
@@ -149,16 +197,19 @@ typedef struct syncprov_info_t {
 	int		si_numops;	/* number of ops since last checkpoint */
 	int		si_nopres;	/* Skip present phase */
 	int		si_usehint;	/* use reload hint */
+	int		si_sharepres;	/* share Present phase scans */
 	int		si_active;	/* True if there are active mods */
 	int		si_dirty;	/* True if the context is dirty, i.e changes
 						 * have been made without updating the csn. */
 	time_t	si_chklast;	/* time of last checkpoint */
 	Avlnode	*si_mods;	/* entries being modified */
 	sessionlog	*si_logs;
+	syncpres	*si_pres;	/* Present scans in progress */
 	ldap_pvt_thread_rdwr_t	si_csn_rwlock;
 	ldap_pvt_thread_mutex_t	si_ops_mutex;
 	ldap_pvt_thread_mutex_t	si_mods_mutex;
 	ldap_pvt_thread_mutex_t	si_resp_mutex;
+	ldap_pvt_thread_mutex_t	si_pres_mutex;
 } syncprov_info_t;
 
 typedef struct opcookie {
@@ -569,8 +620,29 @@ typedef struct fpres_cookie {
 	int num;
 	BerVarray uuids;
 	char *last;
+	syncprov_info_t *si;
+	syncpres *sp;	/* shared scan to collect into, if any */
 } fpres_cookie;
 
+/* Append a batch of collected UUIDs to a shared scan */
+static void
+syncprov_pres_add( fpres_cookie *pc )
+{
+	syncpres *sp = pc->sp;
+
+	ldap_pvt_thread_mutex_lock( &pc->si->si_pres_mutex );
+	if ( sp->sp_num + pc->num > sp->sp_max ) {
+		sp->sp_max = sp->sp_max ? sp->sp_max * 2 : SLAP_SYNCUUID_SET_SIZE;
+		sp->sp_uuids = ch_realloc( sp->sp_uuids, sp->sp_max * UUID_LEN );
+	}
+	/* the cookie's UUIDs are contiguous, starting at uuids[0] */
+	AC_MEMCPY( sp->sp_uuids + sp->sp_num * UUID_LEN, pc->uuids[0].bv_val,
+		pc->num * UUID_LEN );
+	sp->sp_num += pc->num;
+	ldap_pvt_thread_cond_broadcast( &sp->sp_cond );
+	ldap_pvt_thread_mutex_unlock( &pc->si->si_pres_mutex );
+}
+
 static int
 findpres_cb( Operation *op, SlapReply *rs )
 {
@@ -597,8 +669,13 @@ findpres_cb( Operation *op, SlapReply *rs )
 	case REP_RESULT:
 		ret = rs->sr_err;
 		if ( pc->num ) {
-			ret = syncprov_sendinfo( op, rs, LDAP_TAG_SYNC_ID_SET, NULL,
-				0, pc->uuids, 0 );
+			if ( pc->sp ) {
+				syncprov_pres_add( pc );
+				ret = LDAP_SUCCESS;
+			} else {
+				ret = syncprov_sendinfo( op, rs, LDAP_TAG_SYNC_ID_SET, NULL,
+					0, pc->uuids, 0 );
+			}
 			pc->uuids[pc->num].bv_val = pc->last;
 			pc->num = 0;
 			pc->last = pc->uuids[0].bv_val;
@@ -611,7 +688,8 @@ findpres_cb( Operation *op, SlapReply *rs )
 }
 
 static int
-syncprov_findcsn( Operation *op, find_csn_t mode, struct berval *csn )
+syncprov_findcsn( Operation *op, find_csn_t mode, struct berval *csn,
+	syncpres *sp )
 {
 	slap_overinst		*on = (slap_overinst *)op->o_bd->bd_info;
 	syncprov_info_t		*si = on->on_bi.bi_private;
@@ -722,6 +800,8 @@ again:
 		cb.sc_private = &pcookie;
 		cb.sc_response = findpres_cb;
 		pcookie.num = 0;
+		pcookie.si = si;
+		pcookie.sp = sp;
 
 		/* preallocate storage for a full set */
 		pcookie.uuids = op->o_tmpalloc( (SLAP_SYNCUUID_SET_SIZE+1) *
@@ -766,12 +846,229 @@ again:
 		break;
 	case FIND_PRESENT:
 		op->o_tmpfree( pcookie.uuids, op->o_tmpmemctx );
+		if ( sp )
+			rc = frs.sr_err;
 		break;
 	}
 
 	return rc;
 }
 
+static void
+syncprov_pres_free( syncpres *sp )
+{
+	ch_free( sp->sp_ndn.bv_val );
+	ch_free( sp->sp_conn_ndn.bv_val );
+	ch_free( sp->sp_peername.bv_val );
+	ch_free( sp->sp_domain.bv_val );
+	ch_free( sp->sp_sockname.bv_val );
+	ch_free( sp->sp_sockurl.bv_val );
+	ch_free( sp->sp_base.bv_val );
+	ch_free( sp->sp_filterstr.bv_val );
+	ber_bvarray_free( sp->sp_ctxcsn );
+	ch_free( sp->sp_uuids );
+	ldap_pvt_thread_cond_destroy( &sp->sp_cond );
+	ch_free( sp );
+}
+
+/* Whether any ACL that applies to the database looks at the peer
+ * or the listener, or could do so through a set or dynamic ACL */
+static int
+syncprov_pres_peeracl( BackendDB *be )
+{
+	AccessControl *a;
+	Access *b;
+	int i;
+
+	for ( i = 0; i < 2; i++ ) {
+		for ( a = i ? frontendDB->be_acl : be->be_acl; a; a = a->acl_next ) {
+			for ( b = a->acl_access; b; b = b->a_next ) {
+				if ( !BER_BVISEMPTY( &b->a_peername_pat ) ||
+					!BER_BVISEMPTY( &b->a_sockname_pat ) ||
+					!BER_BVISEMPTY( &b->a_domain_pat ) ||
+					!BER_BVISEMPTY( &b->a_sockurl_pat ) ||
+					!BER_BVISEMPTY( &b->a_set_pat ))
+					return 1;
+#ifdef SLAP_DYNACL
+				if ( b->a_dynacl != NULL )
+					return 1;
+#endif /* SLAP_DYNACL */
+			}
+		}
+	}
+	return 0;
+}
+
+/* Whether ACLs evaluate the same for op as for the scan */
+static int
+syncprov_pres_sameacl( syncpres *sp, Operation *op, int peeracl )
+{
+	Connection *c = op->o_conn;
+
+	if ( sp->sp_ssf != op->o_ssf ||
+		sp->sp_transport_ssf != op->o_transport_ssf ||
+		sp->sp_tls_ssf != op->o_tls_ssf ||
+		sp->sp_sasl_ssf != op->o_sasl_ssf ||
+		!bvmatch( &sp->sp_ndn, &op->o_ndn ) ||
+		!bvmatch( &sp->sp_conn_ndn, &c->c_ndn ))
+		return 0;
+
+	return !peeracl || (
+		bvmatch( &sp->sp_peername, &c->c_peer_name ) &&
+		bvmatch( &sp->sp_domain, &c->c_peer_domain ) &&
+		bvmatch( &sp->sp_sockname, &c->c_sock_name ) &&
+		bvmatch( &sp->sp_sockurl, &c->c_listener_url ));
+}
+
+/* Send the Present phase UUIDs for a refresh. If sharing is enabled,
+ * join a scan of the same content that is already under way, or start
+ * one that later arrivals can join. Everyone, including the consumer
+ * that ran the scan, streams the collected UUIDs at their own pace.
+ */
+static int
+syncprov_findpres( Operation *op, BerVarray ctxcsn, int numcsns )
+{
+	slap_overinst		*on = (slap_overinst *)op->o_bd->bd_info;
+	syncprov_info_t		*si = on->on_bi.bi_private;
+	syncpres *sp, **spp;
+	Operation fop;
+	SlapReply frs = { REP_RESULT };
+	BerVarray uuids;
+	char *buf;
+	int i, num, pos, done, owner = 0, rc = LDAP_SUCCESS, sendrc = LDAP_SUCCESS;
+	int peeracl;
+
+	if ( !si->si_sharepres )
+		return syncprov_findcsn( op, FIND_PRESENT, 0, NULL );
+
+	peeracl = syncprov_pres_peeracl( op->o_bd );
+
+	ldap_pvt_thread_mutex_lock( &si->si_pres_mutex );
+	for ( sp = si->si_pres; sp; sp = sp->sp_next ) {
+		if ( sp->sp_done && sp->sp_rc != LDAP_SUCCESS )
+			continue;
+		if ( sp->sp_scope != op->ors_scope ||
+			sp->sp_deref != op->ors_deref ||
+			sp->sp_numcsns != numcsns ||
+			!syncprov_pres_sameacl( sp, op, peeracl ) ||
+			!bvmatch( &sp->sp_base, &op->o_req_ndn ) ||
+			!bvmatch( &sp->sp_filterstr, &op->ors_filterstr ))
+			continue;
+		for ( i=0; i<numcsns; i++ ) {
+			if ( !bvmatch( &sp->sp_ctxcsn[i], &ctxcsn[i] ))
+				break;
+		}
+		if ( i == numcsns )
+			break;
+	}
+	if ( sp ) {
+		sp->sp_refcnt++;
+		ldap_pvt_thread_mutex_unlock( &si->si_pres_mutex );
+		Debug( LDAP_DEBUG_SYNC, "%s syncprov_findpres: "
+			"sharing present scan for base=\"%s\" filter=\"%s\"\n",
+			op->o_log_prefix, op->o_req_ndn.bv_val, op->ors_filterstr.bv_val );
+	} else {
+		sp = ch_calloc( 1, sizeof( syncpres ));
+		ber_dupbv( &sp->sp_ndn, &op->o_ndn );
+		ber_dupbv( &sp->sp_conn_ndn, &op->o_conn->c_ndn );
+		ber_dupbv( &sp->sp_peername, &op->o_conn->c_peer_name );
+		ber_dupbv( &sp->sp_domain, &op->o_conn->c_peer_domain );
+		ber_dupbv( &sp->sp_sockname, &op->o_conn->c_sock_name );
+		ber_dupbv( &sp->sp_sockurl, &op->o_conn->c_listener_url );
+		sp->sp_ssf = op->o_ssf;
+		sp->sp_transport_ssf = op->o_transport_ssf;
+		sp->sp_tls_ssf = op->o_tls_ssf;
+		sp->sp_sasl_ssf = op->o_sasl_ssf;
+		ber_dupbv( &sp->sp_base, &op->o_req_ndn );
+		ber_dupbv( &sp->sp_filterstr, &op->ors_filterstr );
+		sp->sp_scope = op->ors_scope;
+		sp->sp_deref = op->ors_deref;
+		ber_bvarray_dup_x( &sp->sp_ctxcsn, ctxcsn, NULL );
+		sp->sp_numcsns = numcsns;
+		sp->sp_refcnt = 1;
+		ldap_pvt_thread_cond_init( &sp->sp_cond );
+		sp->sp_next = si->si_pres;
+		si->si_pres = sp;
+		ldap_pvt_thread_mutex_unlock( &si->si_pres_mutex );
+
+		owner = 1;
+		rc = syncprov_findcsn( op, FIND_PRESENT, 0, sp );
+
+		ldap_pvt_thread_mutex_lock( &si->si_pres_mutex );
+		sp->sp_done = 1;
+		sp->sp_rc = rc;
+		ldap_pvt_thread_cond_broadcast( &sp->sp_cond );
+		ldap_pvt_thread_mutex_unlock( &si->si_pres_mutex );
+	}
+
+	fop = *op;
+	fop.o_callback = NULL;
+
+	uuids = op->o_tmpalloc( (SLAP_SYNCUUID_SET_SIZE+1) *
+		sizeof(struct berval) + SLAP_SYNCUUID_SET_SIZE * UUID_LEN,
+		op->o_tmpmemctx );
+	buf = (char *)(uuids + SLAP_SYNCUUID_SET_SIZE+1);
+
+	for ( pos = 0;; ) {
+		ldap_pvt_thread_mutex_lock( &si->si_pres_mutex );
+		while ( pos == sp->sp_num && !sp->sp_done )
+			ldap_pvt_thread_cond_wait( &sp->sp_cond, &si->si_pres_mutex );
+		num = sp->sp_num - pos;
+		if ( num > SLAP_SYNCUUID_SET_SIZE )
+			num = SLAP_SYNCUUID_SET_SIZE;
+		AC_MEMCPY( buf, sp->sp_uuids + pos * UUID_LEN, num * UUID_LEN );
+		pos += num;
+		done = sp->sp_done && pos == sp->sp_num;
+		rc = sp->sp_rc;
+		ldap_pvt_thread_mutex_unlock( &si->si_pres_mutex );
+
+		if ( done && rc != LDAP_SUCCESS )
+			break;
+		if ( num ) {
+			for ( i=0; i<num; i++ ) {
+				uuids[i].bv_val = buf + i * UUID_LEN;
+				uuids[i].bv_len = UUID_LEN;
+			}
+			BER_BVZERO( &uuids[num] );
+			sendrc = syncprov_sendinfo( &fop, &frs, LDAP_TAG_SYNC_ID_SET,
+				NULL, 0, uuids, 0 );
+			if ( sendrc != LDAP_SUCCESS )
+				break;
+		}
+		if ( done || op->o_abandon )
+			break;
+	}
+	op->o_tmpfree( uuids, op->o_tmpmemctx );
+
+	ldap_pvt_thread_mutex_lock( &si->si_pres_mutex );
+	if ( --sp->sp_refcnt ) {
+		sp = NULL;
+	} else {
+		for ( spp = &si->si_pres; *spp != sp; spp = &(*spp)->sp_next )
+			;
+		*spp = sp->sp_next;
+	}
+	ldap_pvt_thread_mutex_unlock( &si->si_pres_mutex );
+	if ( sp )
+		syncprov_pres_free( sp );
+
+	if ( sendrc != LDAP_SUCCESS )
+		return sendrc;
+
+	/* The scan we joined failed, perhaps only because its consumer
+	 * went away; that's no reason to fail this one. Scan on our own.
+	 * Resending the UUIDs already sent is harmless.
+	 */
+	if ( !owner && rc != LDAP_SUCCESS && !op->o_abandon ) {
+		Debug( LDAP_DEBUG_SYNC, "%s syncprov_findpres: "
+			"shared present scan failed (%d), scanning again\n",
+			op->o_log_prefix, rc, 0 );
+		rc = syncprov_findcsn( op, FIND_PRESENT, 0, NULL );
+	}
+
+	return rc;
+}
+
 static void free_resinfo( syncres *sr )
 {
 	syncres **st;
@@ -1535,6 +1832,65 @@ syncprov_checkpoint( Operation *op, slap_overinst *on )
 #endif
 }
 
+/* Index of the first log entry with a CSN newer than csn */
+static int
+slog_search( sessionlog *sl, struct berval *csn )
+{
+	int lo = 0, hi = sl->sl_num;
+
+	while ( lo < hi ) {
+		int mid = ( lo + hi ) >> 1;
+
+		if ( ber_bvcmp( &SLOG_ENTRY( sl, mid )->se_csn, csn ) <= 0 ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/* Account for an entry of the given SID entering or leaving the log */
+static void
+slog_sid_count( sessionlog *sl, int sid, int delta )
+{
+	int i;
+
+	for ( i = 0; i < sl->sl_numlogsids; i++ ) {
+		if ( sl->sl_logsids[i].ss_sid >= sid )
+			break;
+	}
+	if ( i < sl->sl_numlogsids && sl->sl_logsids[i].ss_sid == sid ) {
+		sl->sl_logsids[i].ss_num += delta;
+		if ( !sl->sl_logsids[i].ss_num ) {
+			sl->sl_numlogsids--;
+			AC_MEMCPY( &sl->sl_logsids[i], &sl->sl_logsids[i+1],
+				( sl->sl_numlogsids - i ) * sizeof( slog_sid ));
+		}
+	} else if ( delta > 0 ) {
+		sl->sl_logsids = ch_realloc( sl->sl_logsids,
+			( sl->sl_numlogsids + 1 ) * sizeof( slog_sid ));
+		AC_MEMCPY( &sl->sl_logsids[i+1], &sl->sl_logsids[i],
+			( sl->sl_numlogsids - i ) * sizeof( slog_sid ));
+		sl->sl_logsids[i].ss_sid = sid;
+		sl->sl_logsids[i].ss_num = delta;
+		sl->sl_numlogsids++;
+	}
+}
+
+/* Drop all entries; caller must hold the write lock */
+static void
+slog_clear( sessionlog *sl )
+{
+	int i;
+
+	for ( i = 0; i < sl->sl_num; i++ )
+		ch_free( SLOG_ENTRY( sl, i ));
+	sl->sl_num = 0;
+	sl->sl_first = 0;
+	sl->sl_numlogsids = 0;
+}
+
 static void
 syncprov_add_slog( Operation *op )
 {
@@ -1552,24 +1908,15 @@ syncprov_add_slog( Operation *op )
 			 * state with respect to such operations, so we ignore them and
 			 * wipe out anything in the log if we see them.
 			 */
-			ldap_pvt_thread_mutex_lock( &sl->sl_mutex );
-			/* can only do this if no one else is reading the log at the moment */
-			if (!sl->sl_playing) {
-			while ( se = sl->sl_head ) {
-				sl->sl_head = se->se_next;
-				ch_free( se );
-			}
-			sl->sl_tail = NULL;
-			sl->sl_num = 0;
-			}
-			ldap_pvt_thread_mutex_unlock( &sl->sl_mutex );
+			ldap_pvt_thread_rdwr_wlock( &sl->sl_rwlock );
+			slog_clear( sl );
+			ldap_pvt_thread_rdwr_wunlock( &sl->sl_rwlock );
 			return;
 		}
 
 		/* Allocate a record. UUIDs are not NUL-terminated. */
 		se = ch_malloc( sizeof( slog_entry ) + opc->suuid.bv_len +
 			op->o_csn.bv_len + 1 );
-		se->se_next = NULL;
 		se->se_tag = op->o_tag;
 
 		se->se_uuid.bv_val = (char *)(&se[1]);
@@ -1582,26 +1929,34 @@ syncprov_add_slog( Operation *op )
 		se->se_csn.bv_len = op->o_csn.bv_len;
 		se->se_sid = slap_parse_csn_sid( &se->se_csn );
 
-		ldap_pvt_thread_mutex_lock( &sl->sl_mutex );
-		if ( sl->sl_head ) {
-			/* Keep the list in csn order. */
-			if ( ber_bvcmp( &sl->sl_tail->se_csn, &se->se_csn ) <= 0 ) {
-				sl->sl_tail->se_next = se;
-				sl->sl_tail = se;
+		ldap_pvt_thread_rdwr_wlock( &sl->sl_rwlock );
+		if ( sl->sl_num > sl->sl_mask ) {
+			/* ring is full, double it */
+			int i, size = sl->sl_ring ? ( sl->sl_mask + 1 ) << 1 : 64;
+			slog_entry **ring = ch_malloc( size * sizeof( slog_entry * ));
+
+			for ( i = 0; i < sl->sl_num; i++ )
+				ring[i] = SLOG_ENTRY( sl, i );
+			ch_free( sl->sl_ring );
+			sl->sl_ring = ring;
+			sl->sl_mask = size - 1;
+			sl->sl_first = 0;
+		}
+		if ( sl->sl_num ) {
+			/* Keep the log in csn order. */
+			if ( ber_bvcmp( &SLOG_ENTRY( sl, sl->sl_num - 1 )->se_csn,
+				&se->se_csn ) <= 0 )
+			{
+				SLOG_ENTRY( sl, sl->sl_num ) = se;
 			} else {
-				slog_entry **sep;
+				int i, pos = slog_search( sl, &se->se_csn );
 
-				for ( sep = &sl->sl_head; *sep; sep = &(*sep)->se_next ) {
-					if ( ber_bvcmp( &se->se_csn, &(*sep)->se_csn ) < 0 ) {
-						se->se_next = *sep;
-						*sep = se;
-						break;
-					}
-				}
+				for ( i = sl->sl_num; i > pos; i-- )
+					SLOG_ENTRY( sl, i ) = SLOG_ENTRY( sl, i - 1 );
+				SLOG_ENTRY( sl, pos ) = se;
 			}
 		} else {
-			sl->sl_head = se;
-			sl->sl_tail = se;
+			SLOG_ENTRY( sl, 0 ) = se;
 			if ( !sl->sl_mincsn ) {
 				sl->sl_numcsns = 1;
 				sl->sl_mincsn = ch_malloc( 2*sizeof( struct berval ));
@@ -1612,11 +1967,11 @@ syncprov_add_slog( Operation *op )
 			}
 		}
 		sl->sl_num++;
-		if (!sl->sl_playing) {
+		slog_sid_count( sl, se->se_sid, 1 );
 		while ( sl->sl_num > sl->sl_size ) {
 			int i;
-			se = sl->sl_head;
-			sl->sl_head = se->se_next;
+			se = SLOG_ENTRY( sl, 0 );
+			sl->sl_first = ( sl->sl_first + 1 ) & sl->sl_mask;
 			for ( i=0; i<sl->sl_numcsns; i++ )
 				if ( sl->sl_sids[i] >= se->se_sid )
 					break;
@@ -1626,11 +1981,11 @@ syncprov_add_slog( Operation *op )
 			} else {
 				ber_bvreplace( &sl->sl_mincsn[i], &se->se_csn );
 			}
+			slog_sid_count( sl, se->se_sid, -1 );
 			ch_free( se );
 			sl->sl_num--;
 		}
-		}
-		ldap_pvt_thread_mutex_unlock( &sl->sl_mutex );
+		ldap_pvt_thread_rdwr_wunlock( &sl->sl_rwlock );
 	}
 }
 
@@ -1644,28 +1999,45 @@ playlog_cb( Operation *op, SlapReply *rs )
 	return rs->sr_err;
 }
 
-/* enter with sl->sl_mutex locked, release before returning */
+/* enter with sl->sl_rwlock read locked, release before returning */
 static void
 syncprov_playlog( Operation *op, SlapReply *rs, sessionlog *sl,
 	sync_control *srs, BerVarray ctxcsn, int numcsns, int *sids )
 {
 	slap_overinst		*on = (slap_overinst *)op->o_bd->bd_info;
 	slog_entry *se;
-	int i, j, ndel, num, nmods, mmods;
+	int i, j, n, ndel, num, nmods, mmods, start;
 	char cbuf[LDAP_PVT_CSNSTR_BUFSIZE];
 	BerVarray uuids;
-	struct berval delcsn[2];
+	struct berval delcsn[2], *oldest = NULL;
 
 	if ( !sl->sl_num ) {
-		ldap_pvt_thread_mutex_unlock( &sl->sl_mutex );
+		ldap_pvt_thread_rdwr_runlock( &sl->sl_rwlock );
 		return;
 	}
 
 	num = sl->sl_num;
 	i = 0;
 	nmods = 0;
-	sl->sl_playing++;
-	ldap_pvt_thread_mutex_unlock( &sl->sl_mutex );
+
+	/* Everything up to the oldest CSN of the consumer state is too old,
+	 * as long as the consumer knows every SID that has entries in the
+	 * log; entries from a SID it doesn't know are always sent.
+	 */
+	for ( n=0; n<sl->sl_numlogsids; n++ ) {
+		int k;
+		for ( k=0; k<srs->sr_state.numcsns; k++ ) {
+			if ( sl->sl_logsids[n].ss_sid == srs->sr_state.sids[k] )
+				break;
+		}
+		if ( k == srs->sr_state.numcsns ) {
+			oldest = NULL;
+			break;
+		}
+		if ( !oldest || ber_bvcmp( &srs->sr_state.ctxcsn[k], oldest ) < 0 )
+			oldest = &srs->sr_state.ctxcsn[k];
+	}
+	start = oldest ? slog_search( sl, oldest ) : 0;
 
 	uuids = op->o_tmpalloc( (num+1) * sizeof( struct berval ) +
 		num * UUID_LEN, op->o_tmpmemctx );
@@ -1681,8 +2053,9 @@ syncprov_playlog( Operation *op, SlapReply *rs, sessionlog *sl,
 	 */
 	Debug( LDAP_DEBUG_SYNC, "srs csn %s\n",
 		srs->sr_state.ctxcsn[0].bv_val, 0, 0 );
-	for ( se=sl->sl_head; se; se=se->se_next ) {
+	for ( n=start; n<num; n++ ) {
 		int k;
+		se = SLOG_ENTRY( sl, n );
 		Debug( LDAP_DEBUG_SYNC, "log csn %s\n", se->se_csn.bv_val, 0, 0 );
 		ndel = 1;
 		for ( k=0; k<srs->sr_state.numcsns; k++ ) {
@@ -1722,9 +2095,7 @@ syncprov_playlog( Operation *op, SlapReply *rs, sessionlog *sl,
 		AC_MEMCPY(uuids[j].bv_val, se->se_uuid.bv_val, UUID_LEN);
 		uuids[j].bv_len = UUID_LEN;
 	}
-	ldap_pvt_thread_mutex_lock( &sl->sl_mutex );
-	sl->sl_playing--;
-	ldap_pvt_thread_mutex_unlock( &sl->sl_mutex );
+	ldap_pvt_thread_rdwr_runlock( &sl->sl_rwlock );
 
 	ndel = i;
 
@@ -2743,7 +3114,7 @@ no_change:	if ( !(op->o_sync_mode & SLAP_SYNC_PERSIST) ) {
 		sl=si->si_logs;
 		if ( sl ) {
 			int do_play = 0;
-			ldap_pvt_thread_mutex_lock( &sl->sl_mutex );
+			ldap_pvt_thread_rdwr_rlock( &sl->sl_rwlock );
 			/* Are there any log entries, and is the consumer state
 			 * present in the session log?
 			 */
@@ -2769,14 +3140,14 @@ no_change:	if ( !(op->o_sync_mode & SLAP_SYNC_PERSIST) ) {
 			}
 			if ( do_play ) {
 				do_present = 0;
-				/* mutex is unlocked in playlog */
+				/* lock is released in playlog */
 				syncprov_playlog( op, rs, sl, srs, ctxcsn, numcsns, sids );
 			} else {
-				ldap_pvt_thread_mutex_unlock( &sl->sl_mutex );
+				ldap_pvt_thread_rdwr_runlock( &sl->sl_rwlock );
 			}
 		}
 		/* Is the CSN still present in the database? */
-		if ( syncprov_findcsn( op, FIND_CSN, &mincsn ) != LDAP_SUCCESS ) {
+		if ( syncprov_findcsn( op, FIND_CSN, &mincsn, NULL ) != LDAP_SUCCESS ) {
 			/* No, so a reload is required */
 			/* the 2.2 consumer doesn't send this hint */
 			if ( si->si_usehint && srs->sr_rhint == 0 ) {
@@ -2800,8 +3171,8 @@ no_change:	if ( !(op->o_sync_mode & SLAP_SYNC_PERSIST) ) {
 		} else {
 			gotstate = 1;
 			/* If changed and doing Present lookup, send Present UUIDs */
-			if ( do_present && syncprov_findcsn( op, FIND_PRESENT, 0 ) !=
-				LDAP_SUCCESS ) {
+			if ( do_present && ( rs->sr_err = syncprov_findpres( op,
+				ctxcsn, numcsns )) != LDAP_SUCCESS ) {
 				if ( ctxcsn )
 					ber_bvarray_free_x( ctxcsn, op->o_tmpmemctx );
 				if ( sids )
@@ -2943,7 +3314,8 @@ enum {
 	SP_CHKPT = 1,
 	SP_SESSL,
 	SP_NOPRES,
-	SP_USEHINT
+	SP_USEHINT,
+	SP_SHAREPRES
 };
 
 static ConfigDriver sp_cf_gen;
@@ -2965,6 +3337,10 @@ static ConfigTable spcfg[] = {
 		sp_cf_gen, "( OLcfgOvAt:1.4 NAME 'olcSpReloadHint' "
 			"DESC 'Observe Reload Hint in Request control' "
 			"SYNTAX OMsBoolean SINGLE-VALUE )", NULL, NULL },
+	{ "syncprov-sharepresent", NULL, 2, 2, 0, ARG_ON_OFF|ARG_MAGIC|SP_SHAREPRES,
+		sp_cf_gen, "( OLcfgOvAt:1.5 NAME 'olcSpSharePresent' "
+			"DESC 'Share Present phase scans among concurrent consumers' "
+			"SYNTAX OMsBoolean SINGLE-VALUE )", NULL, NULL },
 	{ NULL, NULL, 0, 0, 0, ARG_IGNORED }
 };
 
@@ -2977,6 +3353,7 @@ static ConfigOCs spocs[] = {
 			"$ olcSpSessionlog "
 			"$ olcSpNoPresent "
 			"$ olcSpReloadHint "
+			"$ olcSpSharePresent "
 		") )",
 			Cft_Overlay, spcfg },
 	{ NULL, 0, NULL }
@@ -3030,6 +3407,13 @@ sp_cf_gen(ConfigArgs *c)
 				rc = 1;
 			}
 			break;
+		case SP_SHAREPRES:
+			if ( si->si_sharepres ) {
+				c->value_int = 1;
+			} else {
+				rc = 1;
+			}
+			break;
 		}
 		return rc;
 	} else if ( c->op == LDAP_MOD_DELETE ) {
@@ -3047,6 +3431,9 @@ sp_cf_gen(ConfigArgs *c)
 		case SP_USEHINT:
 			si->si_usehint = 0;
 			break;
+		case SP_SHAREPRES:
+			si->si_sharepres = 0;
+			break;
 		}
 		return rc;
 	}
@@ -3100,8 +3487,12 @@ sp_cf_gen(ConfigArgs *c)
 			sl->sl_sids = NULL;
 			sl->sl_num = 0;
 			sl->sl_numcsns = 0;
-			sl->sl_head = sl->sl_tail = NULL;
-			ldap_pvt_thread_mutex_init( &sl->sl_mutex );
+			sl->sl_ring = NULL;
+			sl->sl_mask = -1;
+			sl->sl_first = 0;
+			sl->sl_logsids = NULL;
+			sl->sl_numlogsids = 0;
+			ldap_pvt_thread_rdwr_init( &sl->sl_rwlock );
 			si->si_logs = sl;
 		}
 		sl->sl_size = size;
@@ -3113,6 +3504,9 @@ sp_cf_gen(ConfigArgs *c)
 	case SP_USEHINT:
 		si->si_usehint = c->value_int;
 		break;
+	case SP_SHAREPRES:
+		si->si_sharepres = c->value_int;
+		break;
 	}
 	return rc;
 }
@@ -3125,7 +3519,7 @@ syncprov_db_otask(
 	void *ptr
 )
 {
-	syncprov_findcsn( ptr, FIND_MAXCSN, 0 );
+	syncprov_findcsn( ptr, FIND_MAXCSN, 0, NULL );
 	return NULL;
 }
 
@@ -3319,6 +3713,7 @@ syncprov_db_init(
 	ldap_pvt_thread_mutex_init( &si->si_ops_mutex );
 	ldap_pvt_thread_mutex_init( &si->si_mods_mutex );
 	ldap_pvt_thread_mutex_init( &si->si_resp_mutex );
+	ldap_pvt_thread_mutex_init( &si->si_pres_mutex );
 
 	csn_anlist[0].an_desc = slap_schema.si_ad_entryCSN;
 	csn_anlist[0].an_name = slap_schema.si_ad_entryCSN->ad_cname;
@@ -3343,19 +3738,16 @@ syncprov_db_destroy(
 	if ( si ) {
 		if ( si->si_logs ) {
 			sessionlog *sl = si->si_logs;
-			slog_entry *se = sl->sl_head;
 
-			while ( se ) {
-				slog_entry *se_next = se->se_next;
-				ch_free( se );
-				se = se_next;
-			}
+			slog_clear( sl );
+			ch_free( sl->sl_ring );
+			ch_free( sl->sl_logsids );
 			if ( sl->sl_mincsn )
 				ber_bvarray_free( sl->sl_mincsn );
 			if ( sl->sl_sids )
 				ch_free( sl->sl_sids );
 
-			ldap_pvt_thread_mutex_destroy(&si->si_logs->sl_mutex);
+			ldap_pvt_thread_rdwr_destroy(&si->si_logs->sl_rwlock);
 			ch_free( si->si_logs );
 		}
 		if ( si->si_ctxcsn )
@@ -3363,6 +3755,7 @@ syncprov_db_destroy(
 		if ( si->si_sids )
 			ch_free( si->si_sids );
 		ldap_pvt_thread_mutex_destroy( &si->si_resp_mutex );
+		ldap_pvt_thread_mutex_destroy( &si->si_pres_mutex );
 		ldap_pvt_thread_mutex_destroy( &si->si_mods_mutex );
 		ldap_pvt_thread_mutex_destroy( &si->si_ops_mutex );
 		ldap_pvt_thread_rdwr_destroy( &si->si_csn_rwlock );
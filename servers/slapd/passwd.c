@@ -496,6 +496,373 @@ struct berval * slap_passwd_return(
 	return bv;
 }
 
+/*
+ * Cache of successful password verifications, used for simple binds
+ * when password-cache-size is set. An entry is keyed by a salted
+ * digest of the entry DN, the stored password value and the presented
+ * credentials, so nothing that could be replayed is kept in memory and
+ * a changed userPassword value simply never matches its old entries,
+ * which age out of the LRU list.
+ */
+unsigned slap_passwd_cache_max;
+int slap_passwd_threads;
+
+#ifdef LUTIL_SHA1_BYTES
+typedef struct pw_cache_entry {
+	unsigned char pc_key[LUTIL_SHA1_BYTES];
+	struct pw_cache_entry *pc_hnext;
+	struct pw_cache_entry *pc_lprev;	/* towards most recently used */
+	struct pw_cache_entry *pc_lnext;	/* towards least recently used */
+} pw_cache_entry;
+
+static struct {
+	ldap_pvt_thread_mutex_t pw_mutex;
+	pw_cache_entry **pw_hash;
+	unsigned pw_hmask;
+	unsigned pw_count;
+	pw_cache_entry *pw_mru;
+	pw_cache_entry *pw_lru;
+	unsigned char pw_salt[16];
+} pw_cache;
+
+/*
+ * Only schemes whose outcome depends on nothing but the stored value
+ * and the credentials are cached. Others, like {SASL}, {RADIUS} or
+ * one-time password schemes such as {TOTP1}, must be asked every time.
+ * Names without the closing brace match any scheme with that prefix.
+ */
+static const struct berval pw_cache_schemes[] = {
+	BER_BVC("{SSHA}"),
+	BER_BVC("{SSHA256}"),
+	BER_BVC("{SSHA384}"),
+	BER_BVC("{SSHA512}"),
+	BER_BVC("{SMD5}"),
+	BER_BVC("{CRYPT}"),
+	BER_BVC("{PBKDF2"),
+	BER_BVC("{ARGON2}"),
+	BER_BVNULL
+};
+
+static int
+pw_cache_scheme( struct berval *passwd )
+{
+	int i;
+
+	for ( i = 0; !BER_BVISNULL( &pw_cache_schemes[i] ); i++ ) {
+		if ( passwd->bv_len >= pw_cache_schemes[i].bv_len &&
+			!strncasecmp( passwd->bv_val, pw_cache_schemes[i].bv_val,
+				pw_cache_schemes[i].bv_len ) )
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+#define PW_CACHE_BUCKET(key)	\
+	(((key)[0] | (key)[1] << 8 | (key)[2] << 16 | (unsigned)(key)[3] << 24) \
+		& pw_cache.pw_hmask)
+
+static void
+pw_cache_key( struct berval *ndn, struct berval *passwd,
+	struct berval *cred, unsigned char *key )
+{
+	lutil_SHA1_CTX ctx;
+	unsigned char len[4];
+
+	lutil_SHA1Init( &ctx );
+	lutil_SHA1Update( &ctx, pw_cache.pw_salt, sizeof( pw_cache.pw_salt ) );
+
+#define PW_CACHE_ADD(bv) \
+	len[0] = (bv)->bv_len >> 24; len[1] = (bv)->bv_len >> 16; \
+	len[2] = (bv)->bv_len >> 8; len[3] = (bv)->bv_len; \
+	lutil_SHA1Update( &ctx, len, sizeof( len ) ); \
+	lutil_SHA1Update( &ctx, (const unsigned char *)(bv)->bv_val, (bv)->bv_len )
+
+	PW_CACHE_ADD( ndn );
+	PW_CACHE_ADD( passwd );
+	PW_CACHE_ADD( cred );
+#undef PW_CACHE_ADD
+
+	lutil_SHA1Final( key, &ctx );
+}
+
+/* caller must hold pw_mutex */
+static void
+pw_cache_unlink_lru( pw_cache_entry *pc )
+{
+	if ( pc->pc_lprev ) {
+		pc->pc_lprev->pc_lnext = pc->pc_lnext;
+	} else {
+		pw_cache.pw_mru = pc->pc_lnext;
+	}
+	if ( pc->pc_lnext ) {
+		pc->pc_lnext->pc_lprev = pc->pc_lprev;
+	} else {
+		pw_cache.pw_lru = pc->pc_lprev;
+	}
+}
+
+/* caller must hold pw_mutex */
+static void
+pw_cache_link_mru( pw_cache_entry *pc )
+{
+	pc->pc_lprev = NULL;
+	pc->pc_lnext = pw_cache.pw_mru;
+	if ( pw_cache.pw_mru ) {
+		pw_cache.pw_mru->pc_lprev = pc;
+	} else {
+		pw_cache.pw_lru = pc;
+	}
+	pw_cache.pw_mru = pc;
+}
+
+/* caller must hold pw_mutex */
+static void
+pw_cache_unlink_hash( pw_cache_entry *pc )
+{
+	pw_cache_entry **pcp;
+
+	for ( pcp = &pw_cache.pw_hash[PW_CACHE_BUCKET( pc->pc_key )];
+		*pcp != pc; pcp = &(*pcp)->pc_hnext )
+		;
+	*pcp = pc->pc_hnext;
+}
+
+static int
+pw_cache_find( unsigned char *key )
+{
+	pw_cache_entry *pc = NULL;
+
+	ldap_pvt_thread_mutex_lock( &pw_cache.pw_mutex );
+	if ( pw_cache.pw_hash != NULL ) {
+		for ( pc = pw_cache.pw_hash[PW_CACHE_BUCKET( key )];
+			pc != NULL; pc = pc->pc_hnext )
+		{
+			if ( !memcmp( pc->pc_key, key, LUTIL_SHA1_BYTES ) ) {
+				if ( pc != pw_cache.pw_mru ) {
+					pw_cache_unlink_lru( pc );
+					pw_cache_link_mru( pc );
+				}
+				break;
+			}
+		}
+	}
+	ldap_pvt_thread_mutex_unlock( &pw_cache.pw_mutex );
+
+	return pc != NULL;
+}
+
+static void
+pw_cache_add( unsigned char *key )
+{
+	pw_cache_entry *pc, **pcp;
+
+	ldap_pvt_thread_mutex_lock( &pw_cache.pw_mutex );
+	if ( pw_cache.pw_hash == NULL ) {
+		goto done;
+	}
+
+	/* someone else may have verified the same credentials meanwhile */
+	pcp = &pw_cache.pw_hash[PW_CACHE_BUCKET( key )];
+	for ( pc = *pcp; pc != NULL; pc = pc->pc_hnext ) {
+		if ( !memcmp( pc->pc_key, key, LUTIL_SHA1_BYTES ) ) {
+			goto done;
+		}
+	}
+
+	if ( pw_cache.pw_count >= slap_passwd_cache_max ) {
+		/* recycle the least recently used one */
+		pc = pw_cache.pw_lru;
+		pw_cache_unlink_lru( pc );
+		pw_cache_unlink_hash( pc );
+	} else {
+		pc = ch_malloc( sizeof( pw_cache_entry ) );
+		pw_cache.pw_count++;
+	}
+
+	AC_MEMCPY( pc->pc_key, key, LUTIL_SHA1_BYTES );
+	pc->pc_hnext = *pcp;
+	*pcp = pc;
+	pw_cache_link_mru( pc );
+
+done:
+	ldap_pvt_thread_mutex_unlock( &pw_cache.pw_mutex );
+}
+#endif /* LUTIL_SHA1_BYTES */
+
+/*
+ * Set the maximum number of cached verifications; 0 disables
+ * the cache and releases its memory.
+ */
+void
+slap_passwd_cache_size( unsigned max )
+{
+#ifdef LUTIL_SHA1_BYTES
+	pw_cache_entry *pc, **hash = NULL;
+	unsigned size = 0;
+
+	ldap_pvt_thread_mutex_lock( &pw_cache.pw_mutex );
+
+	/* trim the LRU list to the new size */
+	while ( pw_cache.pw_count > max ) {
+		pc = pw_cache.pw_lru;
+		pw_cache_unlink_lru( pc );
+		ch_free( pc );
+		pw_cache.pw_count--;
+	}
+
+	if ( max ) {
+		for ( size = 16; size < max && size < 0x80000000U; size <<= 1 )
+			;
+		hash = ch_calloc( size, sizeof( pw_cache_entry * ) );
+	}
+	ch_free( pw_cache.pw_hash );
+	pw_cache.pw_hash = hash;
+	pw_cache.pw_hmask = size - 1;
+
+	/* rehash whatever is left */
+	for ( pc = pw_cache.pw_mru; pc != NULL; pc = pc->pc_lnext ) {
+		unsigned i = PW_CACHE_BUCKET( pc->pc_key );
+		pc->pc_hnext = hash[i];
+		hash[i] = pc;
+	}
+
+	slap_passwd_cache_max = max;
+	ldap_pvt_thread_mutex_unlock( &pw_cache.pw_mutex );
+#else
+	slap_passwd_cache_max = max;
+#endif /* LUTIL_SHA1_BYTES */
+}
+
+/*
+ * Expensive schemes can be verified by a dedicated set of up to
+ * password-hash-threads worker threads, so that bind storms only keep
+ * that many CPUs busy hashing. These can't be a second thread pool
+ * since libldap_r only supports one, so they are started on demand
+ * and serve a plain FIFO of requests.
+ */
+typedef struct pw_task {
+	struct berval *pt_passwd;
+	struct berval *pt_cred;
+	const char *pt_text;
+	int pt_rc;
+	int pt_done;
+	ldap_pvt_thread_cond_t pt_cond;
+	LDAP_STAILQ_ENTRY(pw_task) pt_next;
+} pw_task;
+
+static struct {
+	ldap_pvt_thread_mutex_t pq_mutex;
+	ldap_pvt_thread_cond_t pq_cond;
+	LDAP_STAILQ_HEAD(pq_tasks, pw_task) pq_tasks;
+	int pq_threads;
+	int pq_idle;
+	int pq_shutdown;
+} pw_queue;
+
+static void *
+pw_worker( void *arg )
+{
+	pw_task *pt;
+
+	ldap_pvt_thread_mutex_lock( &pw_queue.pq_mutex );
+	for (;;) {
+		while ( LDAP_STAILQ_EMPTY( &pw_queue.pq_tasks ) &&
+			!pw_queue.pq_shutdown &&
+			pw_queue.pq_threads <= slap_passwd_threads )
+		{
+			pw_queue.pq_idle++;
+			ldap_pvt_thread_cond_wait( &pw_queue.pq_cond, &pw_queue.pq_mutex );
+			pw_queue.pq_idle--;
+		}
+		pt = LDAP_STAILQ_FIRST( &pw_queue.pq_tasks );
+		if ( pt == NULL ) {
+			/* shutting down, or there are too many of us */
+			break;
+		}
+		LDAP_STAILQ_REMOVE_HEAD( &pw_queue.pq_tasks, pt_next );
+		ldap_pvt_thread_mutex_unlock( &pw_queue.pq_mutex );
+
+		pt->pt_rc = lutil_passwd( pt->pt_passwd, pt->pt_cred,
+			NULL, &pt->pt_text );
+
+		ldap_pvt_thread_mutex_lock( &pw_queue.pq_mutex );
+		pt->pt_done = 1;
+		ldap_pvt_thread_cond_signal( &pt->pt_cond );
+	}
+	if ( --pw_queue.pq_threads == 0 ) {
+		/* wake slap_passwd_destroy() */
+		ldap_pvt_thread_cond_broadcast( &pw_queue.pq_cond );
+	}
+	ldap_pvt_thread_mutex_unlock( &pw_queue.pq_mutex );
+
+	return NULL;
+}
+
+static int
+pw_verify( struct berval *passwd, struct berval *cred, const char **text )
+{
+	pw_task pt;
+
+#ifdef SLAPD_SPASSWD
+	/* {SASL} needs the operation's thread context */
+	if ( passwd->bv_len >= STRLENOF( "{SASL}" ) &&
+		!strncasecmp( passwd->bv_val, "{SASL}", STRLENOF( "{SASL}" ) ) )
+	{
+		return lutil_passwd( passwd, cred, NULL, text );
+	}
+#endif
+
+	ldap_pvt_thread_mutex_lock( &pw_queue.pq_mutex );
+	if ( !pw_queue.pq_idle && pw_queue.pq_threads < slap_passwd_threads &&
+		!pw_queue.pq_shutdown )
+	{
+		ldap_pvt_thread_t tid;
+
+		if ( ldap_pvt_thread_create( &tid, 1, pw_worker, NULL ) == 0 ) {
+			pw_queue.pq_threads++;
+		}
+	}
+	if ( !pw_queue.pq_threads ) {
+		ldap_pvt_thread_mutex_unlock( &pw_queue.pq_mutex );
+		return lutil_passwd( passwd, cred, NULL, text );
+	}
+
+	pt.pt_passwd = passwd;
+	pt.pt_cred = cred;
+	pt.pt_text = NULL;
+	pt.pt_done = 0;
+	ldap_pvt_thread_cond_init( &pt.pt_cond );
+	LDAP_STAILQ_INSERT_TAIL( &pw_queue.pq_tasks, &pt, pt_next );
+	ldap_pvt_thread_cond_signal( &pw_queue.pq_cond );
+
+	while ( !pt.pt_done ) {
+		ldap_pvt_thread_cond_wait( &pt.pt_cond, &pw_queue.pq_mutex );
+	}
+	ldap_pvt_thread_mutex_unlock( &pw_queue.pq_mutex );
+	ldap_pvt_thread_cond_destroy( &pt.pt_cond );
+
+	if ( pt.pt_text ) {
+		*text = pt.pt_text;
+	}
+	return pt.pt_rc;
+}
+
+/*
+ * Set the number of threads verifying passwords on behalf of
+ * operations; 0 verifies them in the operation's own thread.
+ */
+void
+slap_passwd_hash_threads( int n )
+{
+	ldap_pvt_thread_mutex_lock( &pw_queue.pq_mutex );
+	slap_passwd_threads = n;
+	/* let surplus workers go */
+	ldap_pvt_thread_cond_broadcast( &pw_queue.pq_cond );
+	ldap_pvt_thread_mutex_unlock( &pw_queue.pq_mutex );
+}
+
 /*
  * if "e" is provided, access to each value of the password is checked first
  */
@@ -511,6 +878,10 @@ slap_passwd_check(
 	struct berval		*bv;
 	AccessControlState	acl_state = ACL_STATE_INIT;
 	char		credNul = cred->bv_val[cred->bv_len];
+#ifdef LUTIL_SHA1_BYTES
+	unsigned char	key[LUTIL_SHA1_BYTES];
+	int		cache;
+#endif
 
 #ifdef SLAPD_SPASSWD
 	void		*old_authctx = NULL;
@@ -529,7 +900,29 @@ slap_passwd_check(
 			continue;
 		}
 		
-		if ( !lutil_passwd( bv, cred, NULL, text ) ) {
+#ifdef LUTIL_SHA1_BYTES
+		cache = e != NULL && slap_passwd_cache_max &&
+			pw_cache_scheme( bv );
+		if ( cache ) {
+			pw_cache_key( &e->e_nname, bv, cred, key );
+			if ( pw_cache_find( key ) ) {
+				Debug( LDAP_DEBUG_TRACE, "slap_passwd_check: "
+					"\"%s\" verified by cache\n",
+					e->e_nname.bv_val, 0, 0 );
+				result = 0;
+				break;
+			}
+		}
+#endif
+
+		if ( !( slap_passwd_threads > 0 ? pw_verify( bv, cred, text )
+			: lutil_passwd( bv, cred, NULL, text ) ) )
+		{
+#ifdef LUTIL_SHA1_BYTES
+			if ( cache ) {
+				pw_cache_add( key );
+			}
+#endif
 			result = 0;
 			break;
 		}
@@ -650,6 +1043,38 @@ void slap_passwd_init()
 #ifdef SLAPD_CRYPT
 	ldap_pvt_thread_mutex_init( &passwd_mutex );
 	lutil_cryptptr = slapd_crypt;
+#endif
+	ldap_pvt_thread_mutex_init( &pw_queue.pq_mutex );
+	ldap_pvt_thread_cond_init( &pw_queue.pq_cond );
+	LDAP_STAILQ_INIT( &pw_queue.pq_tasks );
+#ifdef LUTIL_SHA1_BYTES
+	ldap_pvt_thread_mutex_init( &pw_cache.pw_mutex );
+	if ( lutil_entropy( pw_cache.pw_salt, sizeof( pw_cache.pw_salt ) ) ) {
+		/* no entropy source; still keep the salt unpredictable
+		 * to anyone without access to this process */
+		struct timeval tv;
+		gettimeofday( &tv, NULL );
+		AC_MEMCPY( pw_cache.pw_salt, &tv, sizeof( tv ) < sizeof( pw_cache.pw_salt )
+			? sizeof( tv ) : sizeof( pw_cache.pw_salt ) );
+		pw_cache.pw_salt[sizeof( pw_cache.pw_salt ) - 1] ^= getpid();
+	}
+#endif
+}
+
+void slap_passwd_destroy()
+{
+	ldap_pvt_thread_mutex_lock( &pw_queue.pq_mutex );
+	pw_queue.pq_shutdown = 1;
+	ldap_pvt_thread_cond_broadcast( &pw_queue.pq_cond );
+	while ( pw_queue.pq_threads ) {
+		ldap_pvt_thread_cond_wait( &pw_queue.pq_cond, &pw_queue.pq_mutex );
+	}
+	ldap_pvt_thread_mutex_unlock( &pw_queue.pq_mutex );
+	ldap_pvt_thread_cond_destroy( &pw_queue.pq_cond );
+	ldap_pvt_thread_mutex_destroy( &pw_queue.pq_mutex );
+#ifdef LUTIL_SHA1_BYTES
+	slap_passwd_cache_size( 0 );
+	ldap_pvt_thread_mutex_destroy( &pw_cache.pw_mutex );
 #endif
 }
 
@@ -806,11 +806,15 @@ LDAP_SLAPD_F (const char *) connection_state2str LDAP_P(( int state ))
 
 LDAP_SLAPD_F (int) connection_read_activate LDAP_P((ber_socket_t s));
 LDAP_SLAPD_F (int) connection_write LDAP_P((ber_socket_t s));
+LDAP_SLAPD_F (int) connection_flush_output LDAP_P(( Connection *c ));
+LDAP_SLAPD_F (int) connection_park_output LDAP_P((
+	Connection *c, BerElement *ber ));
 
 LDAP_SLAPD_F (void) connection_op_finish LDAP_P((
 	Operation *op ));
 
 LDAP_SLAPD_F (unsigned long) connections_nextid(void);
+LDAP_SLAPD_F (unsigned long) connections_active(void);
 
 LDAP_SLAPD_F (Connection *) connection_first LDAP_P(( ber_socket_t * ));
 LDAP_SLAPD_F (Connection *) connection_next LDAP_P((
@@ -1026,6 +1030,8 @@ LDAP_SLAPD_F (Entry *) str2entry LDAP_P(( char	*s ));
 LDAP_SLAPD_F (Entry *) str2entry2 LDAP_P(( char	*s, int checkvals ));
 LDAP_SLAPD_F (char *) entry2str LDAP_P(( Entry *e, int *len ));
 LDAP_SLAPD_F (char *) entry2str_wrap LDAP_P(( Entry *e, int *len, ber_len_t wrap ));
+LDAP_SLAPD_F (char *) entry2str_wrap_r LDAP_P(( Entry *e, char **ebufp,
+	int *emaxsizep, int *len, ber_len_t wrap ));
 
 LDAP_SLAPD_F (ber_len_t) entry_flatsize LDAP_P(( Entry *e, int norm ));
 LDAP_SLAPD_F (void) entry_partsize LDAP_P(( Entry *e, ber_len_t *len,
@@ -1497,6 +1503,11 @@ LDAP_SLAPD_F (Operation *) slap_op_alloc LDAP_P((
 	ber_tag_t tag, ber_int_t id, void *ctx ));
 
 LDAP_SLAPD_F (slap_op_t) slap_req2op LDAP_P(( ber_tag_t tag ));
+LDAP_SLAPD_F (void) slap_op_phase_end LDAP_P((
+	Operation *op, slap_phase_t phase, struct timeval *start ));
+LDAP_SLAPD_F (void) slap_op_phase_finish LDAP_P(( Operation *op ));
+LDAP_SLAPD_V (const char *) slap_phase_names[];
+LDAP_SLAPD_V (const char *) slap_phase_buckets[];
 
 /*
  * operational.c
@@ -1546,6 +1557,11 @@ LDAP_SLAPD_F (int) slap_passwd_parse(
 	const char		**text );
 
 LDAP_SLAPD_F (void) slap_passwd_init (void);
+LDAP_SLAPD_F (void) slap_passwd_destroy (void);
+LDAP_SLAPD_F (void) slap_passwd_cache_size( unsigned max );
+LDAP_SLAPD_F (void) slap_passwd_hash_threads( int n );
+LDAP_SLAPD_V (unsigned) slap_passwd_cache_max;
+LDAP_SLAPD_V (int) slap_passwd_threads;
 
 /*
  * phonetic.c
@@ -2050,6 +2066,7 @@ LDAP_SLAPD_V (unsigned int) index_intlen_strlen;
 
 LDAP_SLAPD_V (ber_len_t) sockbuf_max_incoming;
 LDAP_SLAPD_V (ber_len_t) sockbuf_max_incoming_auth;
+LDAP_SLAPD_V (ber_len_t) sockbuf_max_outgoing;
 LDAP_SLAPD_V (int)		slap_conn_max_pending;
 LDAP_SLAPD_V (int)		slap_conn_max_pending_auth;
 
@@ -2062,6 +2079,8 @@ LDAP_SLAPD_V (const char) 	Versionstr[];
 LDAP_SLAPD_V (int)		global_gentlehup;
 LDAP_SLAPD_V (int)		global_idletimeout;
 LDAP_SLAPD_V (int)		global_writetimeout;
+LDAP_SLAPD_V (int)		slap_optrace;
+LDAP_SLAPD_V (unsigned)		slap_slowop_threshold;
 LDAP_SLAPD_V (char *)	global_host;
 LDAP_SLAPD_V (struct berval)	global_host_bv;
 LDAP_SLAPD_V (char *)	global_realm;
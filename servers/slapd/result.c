@@ -331,7 +331,7 @@ slap_writewait_play(
 	}
 }
 
-static long send_ldap_ber(
+static long send_ldap_ber_int(
 	Operation *op,
 	BerElement *ber )
 {
@@ -371,11 +371,12 @@ static long send_ldap_ber(
 	/* Our turn */
 	conn->c_writing = 1;
 
-	/* write the pdu */
+	/* write the pdu, after any output parked earlier */
 	while( 1 ) {
 		int err;
 
-		if ( ber_flush2( conn->c_sb, ber, LBER_FLUSH_FREE_NEVER ) == 0 ) {
+		if ( connection_flush_output( conn ) == 0 &&
+			ber_flush2( conn->c_sb, ber, LBER_FLUSH_FREE_NEVER ) == 0 ) {
 			ret = bytes;
 			break;
 		}
@@ -403,6 +404,12 @@ fail:
 			return -1;
 		}
 
+		/* leave the rest to the listener if the backlog allows */
+		if ( connection_park_output( conn, ber ) == 0 ) {
+			ret = bytes;
+			break;
+		}
+
 		/* wait for socket to be write-ready */
 		conn->c_writewaiter = 1;
 		ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
@@ -443,6 +450,20 @@ fail:
 	return ret;
 }
 
+static long send_ldap_ber(
+	Operation *op,
+	BerElement *ber )
+{
+	struct timeval tv;
+	long ret;
+
+	SLAP_PHASE_BEGIN( tv );
+	ret = send_ldap_ber_int( op, ber );
+	SLAP_PHASE_END( op, SLAP_PHASE_WRITE, tv );
+
+	return ret;
+}
+
 static int
 send_ldap_control( BerElement *ber, LDAPControl *c )
 {
@@ -1021,6 +1042,8 @@ slap_send_search_entry( Operation *op, SlapReply *rs )
 	AccessControlState acl_state = ACL_STATE_INIT;
 	int			 attrsonly;
 	AttributeDescription *ad_entry = slap_schema.si_ad_entry;
+	struct timeval	tv_encode = { 0, 0 };
+	unsigned long	nested = 0;
 
 	/* a_flags: array of flags telling if the i-th element will be
 	 *          returned or filtered out
@@ -1081,6 +1104,9 @@ slap_send_search_entry( Operation *op, SlapReply *rs )
 		goto error_return;
 	}
 
+	SLAP_PHASE_BEGIN( tv_encode );
+	nested = op->o_phase[ SLAP_PHASE_ACL ] + op->o_phase[ SLAP_PHASE_WRITE ];
+
 	if ( op->o_res_ber ) {
 		/* read back control or LDAP_CONNECTIONLESS */
 	    ber = op->o_res_ber;
@@ -1504,6 +1530,13 @@ slap_send_search_entry( Operation *op, SlapReply *rs )
 	rc = LDAP_SUCCESS;
 
 error_return:;
+	if ( tv_encode.tv_sec ) {
+		/* leave out the ACL checks and the write done meanwhile */
+		op->o_phase[ SLAP_PHASE_ENCODE ] -= op->o_phase[ SLAP_PHASE_ACL ]
+			+ op->o_phase[ SLAP_PHASE_WRITE ] - nested;
+		SLAP_PHASE_END( op, SLAP_PHASE_ENCODE, tv_encode );
+	}
+
 	if ( op->o_callback ) {
 		(void)slap_cleanup_play( op, rs );
 	}
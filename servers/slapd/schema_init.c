@@ -923,7 +923,7 @@ octetStringSubstringsIndexer(
 	ber_len_t i, nkeys;
 	BerVarray keys;
 
-	HASH_CONTEXT HCany, HCini, HCfin;
+	HASH_CONTEXT HCany, HCini, HCfin, HCngr;
 	unsigned char HASHdigest[HASH_BYTES];
 	struct berval digest;
 	digest.bv_val = (char *)HASHdigest;
@@ -956,6 +956,12 @@ octetStringSubstringsIndexer(
 				nkeys += values[i].bv_len - (index_substr_if_minlen - 1);
 			}
 		}
+
+		if( ( flags & SLAP_INDEX_SUBSTR_NGRAM ) == SLAP_INDEX_SUBSTR_NGRAM ) {
+			if( values[i].bv_len >= SLAP_INDEX_SUBSTR_NGRAM_LEN ) {
+				nkeys += values[i].bv_len - (SLAP_INDEX_SUBSTR_NGRAM_LEN - 1);
+			}
+		}
 	}
 
 	if( nkeys == 0 ) {
@@ -972,11 +978,30 @@ octetStringSubstringsIndexer(
 		hashPreset( &HCini, prefix, SLAP_INDEX_SUBSTR_INITIAL_PREFIX, syntax, mr );
 	if( flags & SLAP_INDEX_SUBSTR_FINAL )
 		hashPreset( &HCfin, prefix, SLAP_INDEX_SUBSTR_FINAL_PREFIX, syntax, mr );
+	if( ( flags & SLAP_INDEX_SUBSTR_NGRAM ) == SLAP_INDEX_SUBSTR_NGRAM )
+		hashPreset( &HCngr, prefix, SLAP_INDEX_SUBSTR_NGRAM_PREFIX, syntax, mr );
 
 	nkeys = 0;
 	for ( i = 0; !BER_BVISNULL( &values[i] ); i++ ) {
 		ber_len_t j,max;
 
+		if( ( flags & SLAP_INDEX_SUBSTR_NGRAM ) == SLAP_INDEX_SUBSTR_NGRAM &&
+			( values[i].bv_len >= SLAP_INDEX_SUBSTR_NGRAM_LEN ) )
+		{
+			unsigned char gram[ SLAP_INDEX_SUBSTR_NGRAM_LEN + 1 ];
+
+			max = values[i].bv_len - (SLAP_INDEX_SUBSTR_NGRAM_LEN - 1);
+
+			for( j=0; j<max; j++ ) {
+				AC_MEMCPY( gram, &values[i].bv_val[j],
+					SLAP_INDEX_SUBSTR_NGRAM_LEN );
+				gram[ SLAP_INDEX_SUBSTR_NGRAM_LEN ] =
+					j % SLAP_INDEX_SUBSTR_NGRAM_POS;
+				hashIter( &HCngr, HASHdigest, gram, sizeof( gram ) );
+				ber_dupbv_x( &keys[nkeys++], &digest, ctx );
+			}
+		}
+
 		if( ( flags & SLAP_INDEX_SUBSTR_ANY ) &&
 			( values[i].bv_len >= index_substr_any_len ) )
 		{
@@ -1024,6 +1049,57 @@ octetStringSubstringsIndexer(
 	return LDAP_SUCCESS;
 }
 
+/* Positional n-gram keys for a single substring, used by backends that
+ * maintain SLAP_INDEX_SUBSTR_NGRAM: SLAP_INDEX_SUBSTR_NGRAM_POS groups of
+ * equal size, group o holding the keys the substring would have if it
+ * started at an offset congruent to o. The substring matches only where
+ * all keys of at least one group are present.
+ */
+static int
+octetStringNgramFilter(
+	Syntax *syntax,
+	MatchingRule *mr,
+	struct berval *prefix,
+	struct berval *value,
+	BerVarray *keysp,
+	void *ctx )
+{
+	ber_len_t j, o, m, nkeys = 0;
+	BerVarray keys;
+	HASH_CONTEXT HASHcontext;
+	unsigned char HASHdigest[HASH_BYTES];
+	unsigned char gram[ SLAP_INDEX_SUBSTR_NGRAM_LEN + 1 ];
+	struct berval digest;
+
+	if ( value->bv_len < SLAP_INDEX_SUBSTR_NGRAM_LEN ) {
+		*keysp = NULL;
+		return LDAP_SUCCESS;
+	}
+
+	digest.bv_val = (char *)HASHdigest;
+	digest.bv_len = HASH_LEN;
+
+	m = value->bv_len - (SLAP_INDEX_SUBSTR_NGRAM_LEN - 1);
+	keys = slap_sl_malloc( sizeof( struct berval ) *
+		(m * SLAP_INDEX_SUBSTR_NGRAM_POS + 1), ctx );
+
+	hashPreset( &HASHcontext, prefix, SLAP_INDEX_SUBSTR_NGRAM_PREFIX,
+		syntax, mr );
+	for ( o=0; o<SLAP_INDEX_SUBSTR_NGRAM_POS; o++ ) {
+		for ( j=0; j<m; j++ ) {
+			AC_MEMCPY( gram, &value->bv_val[j], SLAP_INDEX_SUBSTR_NGRAM_LEN );
+			gram[ SLAP_INDEX_SUBSTR_NGRAM_LEN ] =
+				(o + j) % SLAP_INDEX_SUBSTR_NGRAM_POS;
+			hashIter( &HASHcontext, HASHdigest, gram, sizeof( gram ) );
+			ber_dupbv_x( &keys[nkeys++], &digest, ctx );
+		}
+	}
+	BER_BVZERO( &keys[nkeys] );
+	*keysp = keys;
+
+	return LDAP_SUCCESS;
+}
+
 /* Substring index generation function: Assertion value -> index hash keys */
 static int
 octetStringSubstringsFilter (
@@ -6572,7 +6648,8 @@ static slap_mrule_defs_rec mrule_defs[] = {
 		SLAP_MR_SUBSTR, directoryStringSyntaxes,
 		NULL, UTF8StringNormalize, directoryStringSubstringsMatch,
 		octetStringSubstringsIndexer, octetStringSubstringsFilter,
-		"caseIgnoreMatch" },
+		"caseIgnoreMatch",
+		octetStringNgramFilter },
 
 	{"( 2.5.13.5 NAME 'caseExactMatch' "
 		"SYNTAX 1.3.6.1.4.1.1466.115.121.1.15 )",
@@ -6593,7 +6670,8 @@ static slap_mrule_defs_rec mrule_defs[] = {
 		SLAP_MR_SUBSTR, directoryStringSyntaxes,
 		NULL, UTF8StringNormalize, directoryStringSubstringsMatch,
 		octetStringSubstringsIndexer, octetStringSubstringsFilter,
-		"caseExactMatch" },
+		"caseExactMatch",
+		octetStringNgramFilter },
 
 	{"( 2.5.13.8 NAME 'numericStringMatch' "
 		"SYNTAX 1.3.6.1.4.1.1466.115.121.1.36 )",
@@ -6614,7 +6692,8 @@ static slap_mrule_defs_rec mrule_defs[] = {
 		SLAP_MR_SUBSTR, NULL,
 		NULL, numericStringNormalize, octetStringSubstringsMatch,
 		octetStringSubstringsIndexer, octetStringSubstringsFilter,
-		"numericStringMatch" },
+		"numericStringMatch",
+		octetStringNgramFilter },
 
 	{"( 2.5.13.11 NAME 'caseIgnoreListMatch' "
 		"SYNTAX 1.3.6.1.4.1.1466.115.121.1.41 )", /* Postal Address */
@@ -6676,7 +6755,8 @@ static slap_mrule_defs_rec mrule_defs[] = {
 		SLAP_MR_SUBSTR, NULL,
 		NULL, NULL, octetStringSubstringsMatch,
 		octetStringSubstringsIndexer, octetStringSubstringsFilter,
-		"octetStringMatch" },
+		"octetStringMatch",
+		octetStringNgramFilter },
 
 	{"( 2.5.13.20 NAME 'telephoneNumberMatch' "
 		"SYNTAX 1.3.6.1.4.1.1466.115.121.1.50 )",
@@ -6691,7 +6771,8 @@ static slap_mrule_defs_rec mrule_defs[] = {
 		SLAP_MR_SUBSTR, NULL,
 		NULL, telephoneNumberNormalize, octetStringSubstringsMatch,
 		octetStringSubstringsIndexer, octetStringSubstringsFilter,
-		"telephoneNumberMatch" },
+		"telephoneNumberMatch",
+		octetStringNgramFilter },
 
 	{"( 2.5.13.22 NAME 'presentationAddressMatch' "
 		"SYNTAX 1.3.6.1.4.1.1466.115.121.1.43 )",
@@ -6798,14 +6879,16 @@ static slap_mrule_defs_rec mrule_defs[] = {
 		SLAP_MR_SUBSTR, NULL,
 		NULL, IA5StringNormalize, directoryStringSubstringsMatch,
 		octetStringSubstringsIndexer, octetStringSubstringsFilter,
-		"caseIgnoreIA5Match" },
+		"caseIgnoreIA5Match",
+		octetStringNgramFilter },
 
 	{"( 1.3.6.1.4.1.4203.1.2.1 NAME 'caseExactIA5SubstringsMatch' "
 		"SYNTAX 1.3.6.1.4.1.1466.115.121.1.26 )",
 		SLAP_MR_SUBSTR, NULL,
 		NULL, IA5StringNormalize, directoryStringSubstringsMatch,
 		octetStringSubstringsIndexer, octetStringSubstringsFilter,
-		"caseExactIA5Match" },
+		"caseExactIA5Match",
+		octetStringNgramFilter },
 
 #ifdef SLAPD_AUTHPASSWD
 	/* needs updating */
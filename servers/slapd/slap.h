@@ -142,6 +142,7 @@ LDAP_BEGIN_DECL
 
 #define SLAP_SB_MAX_INCOMING_DEFAULT ((1<<18) - 1)
 #define SLAP_SB_MAX_INCOMING_AUTH ((1<<24) - 1)
+#define SLAP_SB_MAX_OUTGOING_DEFAULT ((1<<18) - 1)
 
 #define SLAP_CONN_MAX_PENDING_DEFAULT	100
 #define SLAP_CONN_MAX_PENDING_AUTH	1000
@@ -269,6 +270,8 @@ typedef struct slap_ssf_set {
 	| SLAP_INDEX_SUBSTR_INITIAL \
 	| SLAP_INDEX_SUBSTR_ANY \
 	| SLAP_INDEX_SUBSTR_FINAL )
+/* positional n-grams; not part of the default substring index */
+#define SLAP_INDEX_SUBSTR_NGRAM   ( SLAP_INDEX_SUBSTR | 0x0800UL )
 
 /* defaults for initial/final substring indices */
 #define SLAP_INDEX_SUBSTR_IF_MINLEN_DEFAULT	2
@@ -278,6 +281,13 @@ typedef struct slap_ssf_set {
 #define SLAP_INDEX_SUBSTR_ANY_LEN_DEFAULT		4
 #define SLAP_INDEX_SUBSTR_ANY_STEP_DEFAULT		2
 
+/* n-gram substring keys hash each n-gram together with its offset
+ * modulo SLAP_INDEX_SUBSTR_NGRAM_POS, so that a match requires the
+ * n-grams of an assertion to line up, not merely to be present.
+ */
+#define SLAP_INDEX_SUBSTR_NGRAM_LEN	3
+#define SLAP_INDEX_SUBSTR_NGRAM_POS	4
+
 /* default for ordered integer index keys */
 #define SLAP_INDEX_INTLEN_DEFAULT	4
 
@@ -294,6 +304,7 @@ typedef struct slap_ssf_set {
 #define SLAP_INDEX_SUBSTR_PREFIX	'*'		/* prefix for substring keys    */
 #define SLAP_INDEX_SUBSTR_INITIAL_PREFIX '^'
 #define SLAP_INDEX_SUBSTR_FINAL_PREFIX '$'
+#define SLAP_INDEX_SUBSTR_NGRAM_PREFIX '#'
 #define SLAP_INDEX_CONT_PREFIX		'.'		/* prefix for continuation keys */
 
 #define SLAP_SYNTAX_MATCHINGRULES_OID	 "1.3.6.1.4.1.1466.115.121.1.30"
@@ -527,6 +538,16 @@ typedef int slap_mr_filter_func LDAP_P((
 	BerVarray *keys,
 	void *memctx ));
 
+/* Positional n-gram keys (SLAP_INDEX_SUBSTR_NGRAM) for one component
+ * of a substring assertion */
+typedef int slap_mr_ngram_func LDAP_P((
+	Syntax *syntax,	/* syntax of stored value */
+	MatchingRule *mr,
+	struct berval *prefix,
+	struct berval *value,
+	BerVarray *keys,
+	void *memctx ));
+
 struct MatchingRule {
 	LDAPMatchingRule		smr_mrule;
 	MatchingRuleUse			*smr_mru;
@@ -632,6 +653,7 @@ struct MatchingRule {
 	slap_mr_match_func	*smr_match;
 	slap_mr_indexer_func	*smr_indexer;
 	slap_mr_filter_func	*smr_filter;
+	slap_mr_ngram_func	*smr_ngram;
 
 	/*
 	 * null terminated array of syntaxes compatible with this syntax
@@ -689,6 +711,9 @@ typedef struct slap_mrule_defs_rec {
 	/* For equality rule, this may refer to an associated approximate rule */
 	/* For non-equality rule, this may refer to an associated equality rule */
 	char *						mrd_associated;
+
+	/* For substring rules whose indexer can generate n-gram keys */
+	slap_mr_ngram_func *		mrd_ngram;
 } slap_mrule_defs_rec;
 
 typedef int (AttributeTypeSchemaCheckFN)(
@@ -1838,6 +1863,7 @@ struct BackendDB {
 #define		be_dn2id_get bd_info->bi_tool_dn2id_get
 #define		be_entry_modify	bd_info->bi_tool_entry_modify
 #define		be_entry_delete	bd_info->bi_tool_entry_delete
+#define		be_entry_scan	bd_info->bi_tool_entry_scan
 #endif
 
 	/* supported controls */
@@ -2224,6 +2250,14 @@ typedef ID (BI_tool_entry_modify) LDAP_P(( BackendDB *be, Entry *e,
 	struct berval *text ));
 typedef int (BI_tool_entry_delete) LDAP_P(( BackendDB *be, struct berval *ndn,
 	struct berval *text ));
+/* called for each entry of a part, then with id NOID and e NULL
+ * at the end of the part; e is NULL if the entry could not be read.
+ * A non-zero return stops the scan. If the backend stops it on an
+ * error of its own, it calls once more with part -1. */
+typedef int (BI_tool_entry_scan_cb) LDAP_P(( void *arg, int part, ID id, Entry *e ));
+typedef int (BI_tool_entry_scan) LDAP_P(( BackendDB *be, int nthreads, int nparts,
+	struct berval *base, int scope, Filter *f,
+	BI_tool_entry_scan_cb *cb, void *arg ));
 
 struct BackendInfo {
 	char	*bi_type; /* type of backend */
@@ -2327,6 +2361,7 @@ struct BackendInfo {
 	BI_tool_dn2id_get	*bi_tool_dn2id_get;
 	BI_tool_entry_modify	*bi_tool_entry_modify;
 	BI_tool_entry_delete	*bi_tool_entry_delete;
+	BI_tool_entry_scan	*bi_tool_entry_scan;
 
 #define SLAP_INDEX_ADD_OP		0x0001
 #define SLAP_INDEX_DELETE_OP	0x0002
@@ -2539,6 +2574,33 @@ typedef enum {
 	SLAP_OP_LAST
 } slap_op_t;
 
+/* phases of an operation timed when optrace is enabled */
+typedef enum slap_phase_t {
+	SLAP_PHASE_DECODE = 0,
+	SLAP_PHASE_QUEUE,
+	SLAP_PHASE_CANDIDATES,
+	SLAP_PHASE_ENTRY,
+	SLAP_PHASE_ACL,
+	SLAP_PHASE_ENCODE,
+	SLAP_PHASE_WRITE,
+	SLAP_PHASE_LAST
+} slap_phase_t;
+
+/* phase latency histogram buckets: <10us, <100us, ... <1s, >=1s */
+#define SLAP_PHASE_BUCKETS	7
+
+/* Bracket a timed phase; tv.tv_sec stays 0 when optrace is off, so
+ * toggling it in between is harmless. */
+#define SLAP_PHASE_BEGIN(tv) \
+	do { \
+		if ( slap_optrace ) gettimeofday( &(tv), NULL ); \
+		else (tv).tv_sec = 0; \
+	} while (0)
+#define SLAP_PHASE_END(op, phase, tv) \
+	do { \
+		if ( (tv).tv_sec ) slap_op_phase_end( (op), (phase), &(tv) ); \
+	} while (0)
+
 typedef struct slap_counters_t {
 	struct slap_counters_t	*sc_next;
 	ldap_pvt_thread_mutex_t	sc_mutex;
@@ -2552,6 +2614,7 @@ typedef struct slap_counters_t {
 #ifdef SLAPD_MONITOR
 	ldap_pvt_mp_t		sc_ops_completed_[SLAP_OP_LAST];
 	ldap_pvt_mp_t		sc_ops_initiated_[SLAP_OP_LAST];
+	unsigned long		sc_phase_hist[SLAP_PHASE_LAST][SLAP_PHASE_BUCKETS];
 #endif /* SLAPD_MONITOR */
 } slap_counters_t;
 
@@ -2574,6 +2637,9 @@ typedef struct Opheader {
 
 	slap_counters_t	*oh_counters;
 
+	/* usec spent in each phase, accumulated when optrace is on */
+	unsigned long	oh_phase[SLAP_PHASE_LAST];
+
 	char		oh_log_prefix[ /* sizeof("conn= op=") + 2*LDAP_PVT_INTTYPE_CHARS(unsigned long) */ SLAP_TEXT_BUFLEN ];
 
 #ifdef LDAP_SLAPI
@@ -2621,6 +2687,7 @@ struct Operation {
 #define o_tmpmemctx o_hdr->oh_tmpmemctx
 #define o_tmpmfuncs o_hdr->oh_tmpmfuncs
 #define o_counters o_hdr->oh_counters
+#define o_phase o_hdr->oh_phase
 
 #define	o_tmpalloc	o_tmpmfuncs->bmf_malloc
 #define o_tmpcalloc	o_tmpmfuncs->bmf_calloc
@@ -2861,7 +2928,7 @@ typedef struct Listener Listener;
 /*
  * represents a connection from an ldap client
  */
-/* structure state (protected by connections_mutex) */
+/* structure state (protected by c_mutex) */
 enum sc_struct_state {
 	SLAP_C_UNINITIALIZED = 0,	/* MUST BE ZERO (0) */
 	SLAP_C_UNUSED,
@@ -2893,6 +2960,15 @@ struct Connection {
 	time_t		c_activitytime;	/* when the connection was last used */
 	unsigned long		c_connid;	/* id of this connection for stats*/
 
+	/* idle timeout wheel, protected by its own mutex */
+	struct Connection	*c_idle_next;
+	struct Connection	**c_idle_prevp;
+
+	/* list of connections with parked output, likewise */
+	struct Connection	*c_out_next;
+	struct Connection	**c_out_prevp;
+	time_t		c_outtime;	/* parked output last made progress */
+
 	struct berval	c_peer_domain;	/* DNS name of client */
 	struct berval	c_peer_name;	/* peer name (trans=addr:port) */
 	Listener	*c_listener;
@@ -2928,6 +3004,7 @@ struct Connection {
 	ldap_pvt_thread_cond_t	c_write2_cv;	/* used to wait for sd write-ready*/
 
 	BerElement	*c_currentber;	/* ber we're attempting to read */
+	BerElement	*c_outber;	/* output parked while the socket was full */
 	int			c_writers;		/* number of writers waiting */
 	char		c_writing;		/* someone is writing */
 
@@ -3049,6 +3126,7 @@ struct Listener {
 #endif
 	int	sl_mute;	/* Listener is temporarily disabled due to emfile */
 	int	sl_busy;	/* Listener is busy (accept thread activated) */
+	int	sl_reuseport;	/* SO_REUSEPORT copy for listener thread n-1, or 0 */
 	ber_socket_t sl_sd;
 	Sockaddr sl_sa;
 #define sl_addr	sl_sa.sa_in_addr
@@ -56,23 +56,12 @@
 
 extern int slap_DN_strict;	/* dn.c */
 
-static char csnbuf[ LDAP_PVT_CSNSTR_BUFSIZE ];
-
 typedef struct Erec {
 	Entry *e;
 	unsigned long lineno;
 	unsigned long nextline;
 } Erec;
 
-typedef struct Trec {
-	Entry *e;
-	unsigned long lineno;
-	unsigned long nextline;
-	int rc;
-	int ready;
-} Trec;
-
-static Trec trec;
 static unsigned long sid = SLAP_SYNC_SID_MAX + 1;
 static int checkvals;
 static int enable_meter;
@@ -82,269 +71,374 @@ static OperationBuffer opbuf;
 static char *buf;
 static int lmax;
 
+/* With tool-threads > 1, LDIF is processed by a pipeline:
+ * one thread reads records, the parser threads turn them into
+ * entries and check them, and the main thread stamps and stores
+ * them. Records pass through a ring of slots and are consumed
+ * in the order they were read, so entry IDs are the same as for
+ * a single-threaded load.
+ */
+typedef struct Prec {
+	Erec pr_erec;
+	char *pr_buf;
+	int pr_lmax;
+	int pr_rc;
+	int pr_state;
+} Prec;
+
+#define PREC_FREE	0	/* available to the reader */
+#define PREC_READ	1	/* waiting for a parser */
+#define PREC_BUSY	2	/* being parsed */
+#define PREC_DONE	3	/* waiting for the main thread */
+
+static Prec *prec;
+static int prec_max;
+static unsigned long prec_read, prec_parse, prec_commit;
+
 static ldap_pvt_thread_mutex_t add_mutex;
-static ldap_pvt_thread_cond_t add_cond;
+static ldap_pvt_thread_cond_t read_cond, parse_cond, commit_cond;
 static int add_stop;
 
+static int ldif_threaded;
+
 /* returns:
  *	1: got a record
  *	0: EOF
  * -1: read failure
- * -2: parse failure
  */
 static int
-getrec0(Erec *erec)
+getrec_read( Erec *erec, char **bufp, int *lmaxp )
 {
-	const char *text;
 	int ldifrc;
-	char textbuf[SLAP_TEXT_BUFLEN] = { '\0' };
-	size_t textlen = sizeof textbuf;
-	struct berval csn;
-	Operation *op = &opbuf.ob_op;
-	op->o_hdr = &opbuf.ob_hdr;
-
-again:
-	erec->lineno = erec->nextline+1;
-	/* nextline is the line number of the end of the current entry */
-	ldifrc = ldif_read_record( ldiffp, &erec->nextline, &buf, &lmax );
-	if (ldifrc < 1)
-		return ldifrc < 0 ? -1 : 0;
-	{
-		BackendDB *bd;
-		Entry *e;
-		int prev_DN_strict;
 
-		if ( erec->lineno < jumpline )
-			goto again;
+	do {
+		erec->lineno = erec->nextline+1;
+		/* nextline is the line number of the end of the current entry */
+		ldifrc = ldif_read_record( ldiffp, &erec->nextline, bufp, lmaxp );
+		if (ldifrc < 1)
+			return ldifrc < 0 ? -1 : 0;
+	} while ( erec->lineno < jumpline );
 
-		if ( !dbnum ) {
-			prev_DN_strict = slap_DN_strict;
-			slap_DN_strict = 0;
-		}
-		e = str2entry2( buf, checkvals );
-		if ( !dbnum ) {
-			slap_DN_strict = prev_DN_strict;
-		}
+	if ( enable_meter )
+		lutil_meter_update( &meter,
+				 ftello( ldiffp->fp ),
+				 0);
 
-		if ( enable_meter )
-			lutil_meter_update( &meter,
-					 ftello( ldiffp->fp ),
-					 0);
+	return 1;
+}
 
-		if( e == NULL ) {
-			fprintf( stderr, "%s: could not parse entry (line=%lu)\n",
-				progname, erec->lineno );
-			return -2;
-		}
+/* returns:
+ *	1: got an entry
+ * -2: parse failure
+ */
+static int
+getrec_parse( Operation *op, Erec *erec, char *text )
+{
+	const char *errtext;
+	char textbuf[SLAP_TEXT_BUFLEN] = { '\0' };
+	size_t textlen = sizeof textbuf;
+	BackendDB *bd;
+	Entry *e;
+	int prev_DN_strict;
 
-		/* make sure the DN is not empty */
-		if( BER_BVISEMPTY( &e->e_nname ) &&
-			!BER_BVISEMPTY( be->be_nsuffix ))
-		{
-			fprintf( stderr, "%s: line %lu: "
-				"cannot add entry with empty dn=\"%s\"",
-				progname, erec->lineno, e->e_dn );
-			bd = select_backend( &e->e_nname, nosubordinates );
-			if ( bd ) {
-				BackendDB *bdtmp;
-				int dbidx = 0;
-				LDAP_STAILQ_FOREACH( bdtmp, &backendDB, be_next ) {
-					if ( bdtmp == bd ) break;
-					dbidx++;
-				}
+	if ( !dbnum ) {
+		prev_DN_strict = slap_DN_strict;
+		slap_DN_strict = 0;
+	}
+	e = str2entry2( text, checkvals );
+	if ( !dbnum ) {
+		slap_DN_strict = prev_DN_strict;
+	}
 
-				assert( bdtmp != NULL );
-				
-				fprintf( stderr, "; did you mean to use database #%d (%s)?",
-					dbidx,
-					bd->be_suffix[0].bv_val );
+	if( e == NULL ) {
+		fprintf( stderr, "%s: could not parse entry (line=%lu)\n",
+			progname, erec->lineno );
+		return -2;
+	}
 
+	/* make sure the DN is not empty */
+	if( BER_BVISEMPTY( &e->e_nname ) &&
+		!BER_BVISEMPTY( be->be_nsuffix ))
+	{
+		fprintf( stderr, "%s: line %lu: "
+			"cannot add entry with empty dn=\"%s\"",
+			progname, erec->lineno, e->e_dn );
+		bd = select_backend( &e->e_nname, nosubordinates );
+		if ( bd ) {
+			BackendDB *bdtmp;
+			int dbidx = 0;
+			LDAP_STAILQ_FOREACH( bdtmp, &backendDB, be_next ) {
+				if ( bdtmp == bd ) break;
+				dbidx++;
 			}
-			fprintf( stderr, "\n" );
-			entry_free( e );
-			return -2;
-		}
 
-		/* check backend */
-		bd = select_backend( &e->e_nname, nosubordinates );
-		if ( bd != be ) {
-			fprintf( stderr, "%s: line %lu: "
-				"database #%d (%s) not configured to hold \"%s\"",
-				progname, erec->lineno,
-				dbnum,
-				be->be_suffix[0].bv_val,
-				e->e_dn );
-			if ( bd ) {
-				BackendDB *bdtmp;
-				int dbidx = 0;
-				LDAP_STAILQ_FOREACH( bdtmp, &backendDB, be_next ) {
-					if ( bdtmp == bd ) break;
-					dbidx++;
-				}
+			assert( bdtmp != NULL );
+			
+			fprintf( stderr, "; did you mean to use database #%d (%s)?",
+				dbidx,
+				bd->be_suffix[0].bv_val );
 
-				assert( bdtmp != NULL );
-				
-				fprintf( stderr, "; did you mean to use database #%d (%s)?",
-					dbidx,
-					bd->be_suffix[0].bv_val );
+		}
+		fprintf( stderr, "\n" );
+		entry_free( e );
+		return -2;
+	}
 
-			} else {
-				fprintf( stderr, "; no database configured for that naming context" );
+	/* check backend */
+	bd = select_backend( &e->e_nname, nosubordinates );
+	if ( bd != be ) {
+		fprintf( stderr, "%s: line %lu: "
+			"database #%d (%s) not configured to hold \"%s\"",
+			progname, erec->lineno,
+			dbnum,
+			be->be_suffix[0].bv_val,
+			e->e_dn );
+		if ( bd ) {
+			BackendDB *bdtmp;
+			int dbidx = 0;
+			LDAP_STAILQ_FOREACH( bdtmp, &backendDB, be_next ) {
+				if ( bdtmp == bd ) break;
+				dbidx++;
 			}
-			fprintf( stderr, "\n" );
-			entry_free( e );
-			return -2;
-		}
 
-		if ( slap_tool_entry_check( progname, op, e, erec->lineno, &text, textbuf, textlen ) !=
-			LDAP_SUCCESS ) {
-			entry_free( e );
-			return -2;
+			assert( bdtmp != NULL );
+			
+			fprintf( stderr, "; did you mean to use database #%d (%s)?",
+				dbidx,
+				bd->be_suffix[0].bv_val );
+
+		} else {
+			fprintf( stderr, "; no database configured for that naming context" );
 		}
+		fprintf( stderr, "\n" );
+		entry_free( e );
+		return -2;
+	}
 
-		if ( SLAP_LASTMOD(be) ) {
-			time_t now = slap_get_time();
-			char uuidbuf[ LDAP_LUTIL_UUIDSTR_BUFSIZE ];
-			struct berval vals[ 2 ];
+	if ( slap_tool_entry_check( progname, op, e, erec->lineno, &errtext, textbuf, textlen ) !=
+		LDAP_SUCCESS ) {
+		entry_free( e );
+		return -2;
+	}
 
-			struct berval name, timestamp;
+	erec->e = e;
+	return 1;
+}
 
-			struct berval nvals[ 2 ];
-			struct berval nname;
-			char timebuf[ LDAP_LUTIL_GENTIME_BUFSIZE ];
+/* Add the operational attributes. Called from the main thread
+ * only, in LDIF order, so that generated CSNs are ascending.
+ */
+static void
+getrec_stamp( Entry *e )
+{
+	if ( SLAP_LASTMOD(be) ) {
+		static char csnbuf[ LDAP_PVT_CSNSTR_BUFSIZE ];
+		time_t now = slap_get_time();
+		char uuidbuf[ LDAP_LUTIL_UUIDSTR_BUFSIZE ];
+		struct berval vals[ 2 ];
 
-			enum {
-				GOT_NONE = 0x0,
-				GOT_CSN = 0x1,
-				GOT_UUID = 0x2,
-				GOT_ALL = (GOT_CSN|GOT_UUID)
-			} got = GOT_ALL;
+		struct berval name, timestamp, csn;
 
-			vals[1].bv_len = 0;
-			vals[1].bv_val = NULL;
+		struct berval nvals[ 2 ];
+		struct berval nname;
+		char timebuf[ LDAP_LUTIL_GENTIME_BUFSIZE ];
 
-			nvals[1].bv_len = 0;
-			nvals[1].bv_val = NULL;
+		enum {
+			GOT_NONE = 0x0,
+			GOT_CSN = 0x1,
+			GOT_UUID = 0x2,
+			GOT_ALL = (GOT_CSN|GOT_UUID)
+		} got = GOT_ALL;
 
-			csn.bv_len = ldap_pvt_csnstr( csnbuf, sizeof( csnbuf ), csnsid, 0 );
-			csn.bv_val = csnbuf;
+		vals[1].bv_len = 0;
+		vals[1].bv_val = NULL;
 
-			timestamp.bv_val = timebuf;
-			timestamp.bv_len = sizeof(timebuf);
+		nvals[1].bv_len = 0;
+		nvals[1].bv_val = NULL;
 
-			slap_timestamp( &now, &timestamp );
+		csn.bv_len = ldap_pvt_csnstr( csnbuf, sizeof( csnbuf ), csnsid, 0 );
+		csn.bv_val = csnbuf;
 
-			if ( BER_BVISEMPTY( &be->be_rootndn ) ) {
-				BER_BVSTR( &name, SLAPD_ANONYMOUS );
-				nname = name;
-			} else {
-				name = be->be_rootdn;
-				nname = be->be_rootndn;
-			}
+		timestamp.bv_val = timebuf;
+		timestamp.bv_len = sizeof(timebuf);
 
-			if( attr_find( e->e_attrs, slap_schema.si_ad_entryUUID )
-				== NULL )
-			{
-				got &= ~GOT_UUID;
-				vals[0].bv_len = lutil_uuidstr( uuidbuf, sizeof( uuidbuf ) );
-				vals[0].bv_val = uuidbuf;
-				attr_merge_normalize_one( e, slap_schema.si_ad_entryUUID, vals, NULL );
-			}
+		slap_timestamp( &now, &timestamp );
 
-			if( attr_find( e->e_attrs, slap_schema.si_ad_creatorsName )
-				== NULL )
-			{
-				vals[0] = name;
-				nvals[0] = nname;
-				attr_merge( e, slap_schema.si_ad_creatorsName, vals, nvals );
-			}
+		if ( BER_BVISEMPTY( &be->be_rootndn ) ) {
+			BER_BVSTR( &name, SLAPD_ANONYMOUS );
+			nname = name;
+		} else {
+			name = be->be_rootdn;
+			nname = be->be_rootndn;
+		}
 
-			if( attr_find( e->e_attrs, slap_schema.si_ad_createTimestamp )
-				== NULL )
-			{
-				vals[0] = timestamp;
-				attr_merge( e, slap_schema.si_ad_createTimestamp, vals, NULL );
-			}
+		if( attr_find( e->e_attrs, slap_schema.si_ad_entryUUID )
+			== NULL )
+		{
+			got &= ~GOT_UUID;
+			vals[0].bv_len = lutil_uuidstr( uuidbuf, sizeof( uuidbuf ) );
+			vals[0].bv_val = uuidbuf;
+			attr_merge_normalize_one( e, slap_schema.si_ad_entryUUID, vals, NULL );
+		}
 
-			if( attr_find( e->e_attrs, slap_schema.si_ad_entryCSN )
-				== NULL )
-			{
-				got &= ~GOT_CSN;
-				vals[0] = csn;
-				attr_merge( e, slap_schema.si_ad_entryCSN, vals, NULL );
-			}
+		if( attr_find( e->e_attrs, slap_schema.si_ad_creatorsName )
+			== NULL )
+		{
+			vals[0] = name;
+			nvals[0] = nname;
+			attr_merge( e, slap_schema.si_ad_creatorsName, vals, nvals );
+		}
 
-			if( attr_find( e->e_attrs, slap_schema.si_ad_modifiersName )
-				== NULL )
-			{
-				vals[0] = name;
-				nvals[0] = nname;
-				attr_merge( e, slap_schema.si_ad_modifiersName, vals, nvals );
-			}
+		if( attr_find( e->e_attrs, slap_schema.si_ad_createTimestamp )
+			== NULL )
+		{
+			vals[0] = timestamp;
+			attr_merge( e, slap_schema.si_ad_createTimestamp, vals, NULL );
+		}
 
-			if( attr_find( e->e_attrs, slap_schema.si_ad_modifyTimestamp )
-				== NULL )
-			{
-				vals[0] = timestamp;
-				attr_merge( e, slap_schema.si_ad_modifyTimestamp, vals, NULL );
-			}
+		if( attr_find( e->e_attrs, slap_schema.si_ad_entryCSN )
+			== NULL )
+		{
+			got &= ~GOT_CSN;
+			vals[0] = csn;
+			attr_merge( e, slap_schema.si_ad_entryCSN, vals, NULL );
+		}
 
-			if ( SLAP_SINGLE_SHADOW(be) && got != GOT_ALL ) {
-				char buf[SLAP_TEXT_BUFLEN];
+		if( attr_find( e->e_attrs, slap_schema.si_ad_modifiersName )
+			== NULL )
+		{
+			vals[0] = name;
+			nvals[0] = nname;
+			attr_merge( e, slap_schema.si_ad_modifiersName, vals, nvals );
+		}
 
-				snprintf( buf, sizeof(buf),
-					"%s%s%s",
-					( !(got & GOT_UUID) ? slap_schema.si_ad_entryUUID->ad_cname.bv_val : "" ),
-					( !(got & GOT_CSN) ? "," : "" ),
-					( !(got & GOT_CSN) ? slap_schema.si_ad_entryCSN->ad_cname.bv_val : "" ) );
+		if( attr_find( e->e_attrs, slap_schema.si_ad_modifyTimestamp )
+			== NULL )
+		{
+			vals[0] = timestamp;
+			attr_merge( e, slap_schema.si_ad_modifyTimestamp, vals, NULL );
+		}
 
-				Debug( LDAP_DEBUG_ANY, "%s: warning, missing attrs %s from entry dn=\"%s\"\n",
-					progname, buf, e->e_name.bv_val );
-			}
+		if ( SLAP_SINGLE_SHADOW(be) && got != GOT_ALL ) {
+			char buf[SLAP_TEXT_BUFLEN];
+
+			snprintf( buf, sizeof(buf),
+				"%s%s%s",
+				( !(got & GOT_UUID) ? slap_schema.si_ad_entryUUID->ad_cname.bv_val : "" ),
+				( !(got & GOT_CSN) ? "," : "" ),
+				( !(got & GOT_CSN) ? slap_schema.si_ad_entryCSN->ad_cname.bv_val : "" ) );
 
-			sid = slap_tool_update_ctxcsn_check( progname, e );
+			Debug( LDAP_DEBUG_ANY, "%s: warning, missing attrs %s from entry dn=\"%s\"\n",
+				progname, buf, e->e_name.bv_val );
 		}
-		erec->e = e;
+
+		sid = slap_tool_update_ctxcsn_check( progname, e );
 	}
-	return 1;
 }
 
 static void *
-getrec_thr(void *ctx)
+getrec_read_thr(void *ctx)
 {
+	Erec erec;
+	Prec *pr;
+	int rc;
+
+	erec.nextline = 0;
+
 	ldap_pvt_thread_mutex_lock( &add_mutex );
 	while (!add_stop) {
-		trec.rc = getrec0((Erec *)&trec);
-		trec.ready = 1;
-		while (trec.ready)
-			ldap_pvt_thread_cond_wait( &add_cond, &add_mutex );
-		/* eof or read failure */
-		if ( trec.rc == 0 || trec.rc == -1 )
+		pr = &prec[ prec_read % prec_max ];
+		if ( pr->pr_state != PREC_FREE ) {
+			ldap_pvt_thread_cond_wait( &read_cond, &add_mutex );
+			continue;
+		}
+		ldap_pvt_thread_mutex_unlock( &add_mutex );
+
+		rc = getrec_read( &erec, &pr->pr_buf, &pr->pr_lmax );
+
+		ldap_pvt_thread_mutex_lock( &add_mutex );
+		pr->pr_erec = erec;
+		pr->pr_erec.e = NULL;
+		pr->pr_rc = rc;
+		prec_read++;
+		if ( rc < 1 ) {
+			/* eof or read failure, nothing to parse */
+			pr->pr_state = PREC_DONE;
+			ldap_pvt_thread_cond_signal( &commit_cond );
 			break;
+		}
+		pr->pr_state = PREC_READ;
+		ldap_pvt_thread_cond_signal( &parse_cond );
 	}
 	ldap_pvt_thread_mutex_unlock( &add_mutex );
 	return NULL;
 }
 
-static int ldif_threaded;
+static void *
+getrec_parse_thr(void *ctx)
+{
+	OperationBuffer opb;
+	Operation *op = &opb.ob_op;
+	Prec *pr;
+
+	memset( &opb, 0, sizeof( opb ));
+	op->o_hdr = &opb.ob_hdr;
+
+	ldap_pvt_thread_mutex_lock( &add_mutex );
+	while (!add_stop) {
+		pr = &prec[ prec_parse % prec_max ];
+		if ( prec_parse == prec_read || pr->pr_state != PREC_READ ) {
+			ldap_pvt_thread_cond_wait( &parse_cond, &add_mutex );
+			continue;
+		}
+		pr->pr_state = PREC_BUSY;
+		prec_parse++;
+		ldap_pvt_thread_mutex_unlock( &add_mutex );
+
+		pr->pr_rc = getrec_parse( op, &pr->pr_erec, pr->pr_buf );
+
+		ldap_pvt_thread_mutex_lock( &add_mutex );
+		pr->pr_state = PREC_DONE;
+		if ( pr == &prec[ prec_commit % prec_max ] )
+			ldap_pvt_thread_cond_signal( &commit_cond );
+	}
+	ldap_pvt_thread_mutex_unlock( &add_mutex );
+	return NULL;
+}
 
 static int
 getrec(Erec *erec)
 {
+	Prec *pr;
 	int rc;
-	if ( !ldif_threaded )
-		return getrec0(erec);
-
-	while (!trec.ready)
-		ldap_pvt_thread_yield();
-	erec->e = trec.e;
-	erec->lineno = trec.lineno;
-	erec->nextline = trec.nextline;
-	trec.ready = 0;
-	rc = trec.rc;
+
+	if ( !ldif_threaded ) {
+		Operation *op = &opbuf.ob_op;
+		op->o_hdr = &opbuf.ob_hdr;
+
+		rc = getrec_read( erec, &buf, &lmax );
+		if ( rc == 1 )
+			rc = getrec_parse( op, erec, buf );
+		return rc;
+	}
+
 	ldap_pvt_thread_mutex_lock( &add_mutex );
+	pr = &prec[ prec_commit % prec_max ];
+	while ( prec_commit == prec_read || pr->pr_state != PREC_DONE )
+		ldap_pvt_thread_cond_wait( &commit_cond, &add_mutex );
+	rc = pr->pr_rc;
+	erec->lineno = pr->pr_erec.lineno;
+	erec->nextline = pr->pr_erec.nextline;
+	if ( rc == 1 )
+		erec->e = pr->pr_erec.e;
+	/* the EOF record stays put, there is nothing after it */
+	if ( rc == 1 || rc == -2 ) {
+		pr->pr_erec.e = NULL;
+		pr->pr_state = PREC_FREE;
+		prec_commit++;
+		ldap_pvt_thread_cond_signal( &read_cond );
+	}
 	ldap_pvt_thread_mutex_unlock( &add_mutex );
-	ldap_pvt_thread_cond_signal( &add_cond );
 	return rc;
 }
 
@@ -355,7 +449,8 @@ slapadd( int argc, char **argv )
 	size_t textlen = sizeof textbuf;
 	Erec erec;
 	struct berval bvtext;
-	ldap_pvt_thread_t thr;
+	ldap_pvt_thread_t thr, *pthr = NULL;
+	int i, nparse = 0;
 	ID id;
 	Entry *prev = NULL;
 
@@ -427,11 +522,21 @@ slapadd( int argc, char **argv )
 		enable_meter = 0;
 	}
 
-	if ( slap_tool_thread_max > 1 ) {
+	/* cn=config entries can't be parsed ahead of the ones before
+	 * them, which may load the modules and schema they use */
+	if ( slap_tool_thread_max > 1 && dbnum ) {
+		nparse = slap_tool_thread_max - 1;
+		prec_max = nparse * 16;
+		prec = ch_calloc( prec_max, sizeof( Prec ));
+		pthr = ch_malloc( nparse * sizeof( ldap_pvt_thread_t ));
 		ldap_pvt_thread_mutex_init( &add_mutex );
-		ldap_pvt_thread_cond_init( &add_cond );
-		ldap_pvt_thread_create( &thr, 0, getrec_thr, NULL );
+		ldap_pvt_thread_cond_init( &read_cond );
+		ldap_pvt_thread_cond_init( &parse_cond );
+		ldap_pvt_thread_cond_init( &commit_cond );
 		ldif_threaded = 1;
+		ldap_pvt_thread_create( &thr, 0, getrec_read_thr, NULL );
+		for ( i = 0; i < nparse; i++ )
+			ldap_pvt_thread_create( &pthr[i], 0, getrec_parse_thr, NULL );
 	}
 
 	erec.nextline = 0;
@@ -445,6 +550,8 @@ slapadd( int argc, char **argv )
 			break;
 		}
 
+		getrec_stamp( erec.e );
+
 		if ( !dryrun ) {
 			/*
 			 * Initialize text buffer
@@ -482,10 +589,23 @@ slapadd( int argc, char **argv )
 	if ( ldif_threaded ) {
 		ldap_pvt_thread_mutex_lock( &add_mutex );
 		add_stop = 1;
-		trec.ready = 0;
-		ldap_pvt_thread_cond_signal( &add_cond );
+		ldap_pvt_thread_cond_broadcast( &read_cond );
+		ldap_pvt_thread_cond_broadcast( &parse_cond );
 		ldap_pvt_thread_mutex_unlock( &add_mutex );
 		ldap_pvt_thread_join( thr, NULL );
+		for ( i = 0; i < nparse; i++ )
+			ldap_pvt_thread_join( pthr[i], NULL );
+		for ( i = 0; i < prec_max; i++ ) {
+			if ( prec[i].pr_erec.e )
+				entry_free( prec[i].pr_erec.e );
+			ch_free( prec[i].pr_buf );
+		}
+		ch_free( prec );
+		ch_free( pthr );
+		ldap_pvt_thread_cond_destroy( &read_cond );
+		ldap_pvt_thread_cond_destroy( &parse_cond );
+		ldap_pvt_thread_cond_destroy( &commit_cond );
+		ldap_pvt_thread_mutex_destroy( &add_mutex );
 	}
 	if ( erec.e ) entry_free( erec.e );
 
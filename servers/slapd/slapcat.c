@@ -40,6 +40,188 @@ slapcat_sig( int sig )
 	gotsig=1;
 }
 
+/* Parallel export, for backends with a tool_entry_scan hook.
+ * Parts are formatted into per-part buffers and written out in
+ * part order, or, with shards, each part goes to its own file.
+ */
+typedef struct cat_part {
+	int cp_part;		/* part using this slot, or -1 */
+	int cp_done;
+	char *cp_buf;
+	int cp_len, cp_size;
+	char *cp_ebuf;		/* for entry2str_wrap_r */
+	int cp_esize;
+} cat_part;
+
+#define CAT_FLUSH_SIZE	(1024*1024)
+
+static cat_part *cat_parts;
+static int cat_nslots;
+static int cat_written;
+static int cat_rc;
+static ldap_pvt_thread_mutex_t cat_mutex;
+static ldap_pvt_thread_cond_t cat_cond;
+
+static void
+cat_append( cat_part *cp, const char *str, int len )
+{
+	if ( cp->cp_len + len > cp->cp_size ) {
+		cp->cp_size = ( cp->cp_len + len ) * 2;
+		cp->cp_buf = ch_realloc( cp->cp_buf, cp->cp_size );
+	}
+	memcpy( cp->cp_buf + cp->cp_len, str, len );
+	cp->cp_len += len;
+}
+
+static int
+cat_write( cat_part *cp, LDIFFP *fp )
+{
+	if ( cp->cp_len && fwrite( cp->cp_buf, cp->cp_len, 1, fp->fp ) != 1 ) {
+		fprintf( stderr, "slapcat: error writing output.\n" );
+		return -1;
+	}
+	cp->cp_len = 0;
+	return 0;
+}
+
+/* Stop the scan, waking any thread waiting for a slot */
+static int
+cat_stop( int rc )
+{
+	ldap_pvt_thread_mutex_lock( &cat_mutex );
+	if ( !cat_rc )
+		cat_rc = rc;
+	rc = cat_rc;
+	ldap_pvt_thread_cond_broadcast( &cat_cond );
+	ldap_pvt_thread_mutex_unlock( &cat_mutex );
+	return rc;
+}
+
+static int
+slapcat_scan_cb( void *arg, int part, ID id, Entry *e )
+{
+	cat_part *cp;
+	char buf[64];
+	char *data;
+	int len, rc = 0;
+
+	/* the backend gave up */
+	if ( part < 0 ) {
+		ldap_pvt_thread_mutex_lock( &cat_mutex );
+		*(int *)arg = EXIT_FAILURE;
+		ldap_pvt_thread_mutex_unlock( &cat_mutex );
+		return cat_stop( -1 );
+	}
+
+	if ( gotsig )
+		return cat_stop( -1 );
+
+	if ( ldif_shards > 1 ) {
+		cp = &cat_parts[ part ];
+	} else {
+		cp = &cat_parts[ part % cat_nslots ];
+		if ( cp->cp_part != part ) {
+			/* wait for the previous user of the slot to be written */
+			ldap_pvt_thread_mutex_lock( &cat_mutex );
+			while ( cp->cp_part != -1 && !cat_rc )
+				ldap_pvt_thread_cond_wait( &cat_cond, &cat_mutex );
+			cp->cp_part = part;
+			rc = cat_rc;
+			ldap_pvt_thread_mutex_unlock( &cat_mutex );
+			if ( rc )
+				return rc;
+		}
+	}
+
+	if ( id == NOID ) {
+		/* end of part */
+		if ( ldif_shards > 1 ) {
+			rc = cat_write( cp, ldif_shardfp[ part ] );
+			if ( rc ) rc = cat_stop( rc );
+			return rc;
+		}
+		ldap_pvt_thread_mutex_lock( &cat_mutex );
+		cp->cp_done = 1;
+		for ( cp = &cat_parts[ cat_written % cat_nslots ];
+			cp->cp_part == cat_written && cp->cp_done && !cat_rc;
+			cp = &cat_parts[ cat_written % cat_nslots ] )
+		{
+			cat_rc = cat_write( cp, ldiffp );
+			cp->cp_part = -1;
+			cp->cp_done = 0;
+			cat_written++;
+		}
+		rc = cat_rc;
+		ldap_pvt_thread_cond_broadcast( &cat_cond );
+		ldap_pvt_thread_mutex_unlock( &cat_mutex );
+		return rc;
+	}
+
+	if ( e == NULL ) {
+		len = snprintf( buf, sizeof( buf ), "# no data for entry id=%08lx\n\n", (long) id );
+		cat_append( cp, buf, len );
+		ldap_pvt_thread_mutex_lock( &cat_mutex );
+		*(int *)arg = EXIT_FAILURE;
+		rc = cat_rc;
+		ldap_pvt_thread_mutex_unlock( &cat_mutex );
+		if ( !continuemode )
+			rc = cat_stop( -1 );
+		return rc;
+	}
+
+	if ( verbose ) {
+		len = snprintf( buf, sizeof( buf ), "# id=%08lx\n", (long) id );
+		cat_append( cp, buf, len );
+	}
+
+	data = entry2str_wrap_r( e, &cp->cp_ebuf, &cp->cp_esize, &len, ldif_wrap );
+	cat_append( cp, data, len );
+	cat_append( cp, "\n", 1 );
+
+	/* a shard's part is not ordered against others, write as we go */
+	if ( ldif_shards > 1 && cp->cp_len >= CAT_FLUSH_SIZE ) {
+		rc = cat_write( cp, ldif_shardfp[ part ] );
+		if ( rc ) rc = cat_stop( rc );
+	}
+
+	return rc;
+}
+
+static int
+slapcat_scan( int nthreads )
+{
+	int i, rc = EXIT_SUCCESS;
+
+	if ( ldif_shards > 1 ) {
+		cat_nslots = ldif_shards;
+	} else {
+		/* bounds the number of parts buffered ahead of the writer */
+		cat_nslots = nthreads * 4;
+	}
+	cat_parts = ch_calloc( cat_nslots, sizeof( cat_part ));
+	for ( i = 0; i < cat_nslots; i++ )
+		cat_parts[i].cp_part = -1;
+	ldap_pvt_thread_mutex_init( &cat_mutex );
+	ldap_pvt_thread_cond_init( &cat_cond );
+
+	if ( be->be_entry_scan( be, nthreads, ldif_shards > 1 ? ldif_shards : 0,
+		sub_ndn.bv_len ? &sub_ndn : NULL, scope, filter,
+		slapcat_scan_cb, &rc ) || cat_rc )
+	{
+		rc = EXIT_FAILURE;
+	}
+
+	ldap_pvt_thread_cond_destroy( &cat_cond );
+	ldap_pvt_thread_mutex_destroy( &cat_mutex );
+	for ( i = 0; i < cat_nslots; i++ ) {
+		ch_free( cat_parts[i].cp_buf );
+		ch_free( cat_parts[i].cp_ebuf );
+	}
+	ch_free( cat_parts );
+
+	return rc;
+}
+
 int
 slapcat( int argc, char **argv )
 {
@@ -80,6 +262,17 @@ slapcat( int argc, char **argv )
 		exit( EXIT_FAILURE );
 	}
 
+	if (( slap_tool_thread_max > 1 || ldif_shards > 1 ) &&
+		be->be_entry_scan && !SLAP_GLUE_INSTANCE( be ))
+	{
+		rc = slapcat_scan( slap_tool_thread_max );
+		goto done;
+	} else if ( ldif_shards > 1 ) {
+		fprintf( stderr, "%s: database doesn't support shards.\n",
+			progname );
+		exit( EXIT_FAILURE );
+	}
+
 	op.o_bd = be;
 	if ( !requestBSF && be->be_entry_first ) {
 		id = be->be_entry_first( be );
@@ -167,6 +360,7 @@ slapcat( int argc, char **argv )
 		}
 	}
 
+done:
 	be->be_entry_close( be );
 
 	if ( slap_tool_destroy())
@@ -250,6 +250,22 @@ parse_slapopt( int tool, int *mode )
 			break;
 		}
 
+	} else if ( strncasecmp( optarg, "shards", len ) == 0 ) {
+		switch ( tool ) {
+		case SLAPCAT: {
+			unsigned int u;
+			if ( lutil_atou( &u, p ) || u < 1 ) {
+				Debug( LDAP_DEBUG_ANY, "unable to parse shards=\"%s\".\n", p, 0, 0 );
+				return -1;
+			}
+			ldif_shards = u;
+			} break;
+
+		default:
+			Debug( LDAP_DEBUG_ANY, "shards meaningless for tool.\n", 0, 0, 0 );
+			break;
+		}
+
 	} else {
 		return -1;
 	}
@@ -649,7 +665,27 @@ slap_tool_init(
 		break;
 	}
 
-	if ( ldiffile == NULL ) {
+	if ( ldif_shards > 1 ) {
+		/* one file per part, <ldiffile>.<n> */
+		char *fname;
+
+		if ( ldiffile == NULL ) {
+			fprintf( stderr, "%s: shards requires -l\n", progname );
+			usage( tool, progname );
+		}
+		fname = ch_malloc( strlen( ldiffile ) + STRLENOF( ".4294967295" ) + 1 );
+		ldif_shardfp = ch_calloc( ldif_shards, sizeof( LDIFFP * ));
+		for ( i = 0; i < ldif_shards; i++ ) {
+			sprintf( fname, "%s.%d", ldiffile, i );
+			if (( ldif_shardfp[i] = ldif_open( fname, "w" )) == NULL ) {
+				perror( fname );
+				exit( EXIT_FAILURE );
+			}
+		}
+		ch_free( fname );
+		ldiffp = ldif_shardfp[0];
+
+	} else if ( ldiffile == NULL ) {
 		dummy.fp = writer ? stdout : stdin;
 		ldiffp = &dummy;
 
@@ -967,6 +1003,14 @@ int slap_tool_destroy( void )
 	if ( ldiffp && ldiffp != &dummy ) {
 		ldif_close( ldiffp );
 	}
+	if ( ldif_shardfp ) {
+		int i;
+		/* the first one was ldiffp */
+		for ( i = 1; i < ldif_shards; i++ )
+			ldif_close( ldif_shardfp[i] );
+		ch_free( ldif_shardfp );
+		ldif_shardfp = NULL;
+	}
 	return rc;
 }
 
@@ -73,6 +73,10 @@ typedef struct cookie_state {
 #define RETRYNUM_VALID(n)	((n) >= RETRYNUM_FOREVER)	/* valid retrynum */
 #define RETRYNUM_FINITE(n)	((n) > RETRYNUM_FOREVER)	/* not forever */
 
+#define SYNCREPL_TXNBATCH	500	/* default changes per txn / cookie write */
+
+struct syncapply;
+
 typedef struct syncinfo_s {
 	struct syncinfo_s	*si_next;
 	BackendDB		*si_be;
@@ -120,6 +124,13 @@ typedef struct syncinfo_s {
 	int			si_syncdata;
 	int			si_logstate;
 	int			si_lazyCommit;
+	int			si_txnbatch;	/* changes per txn / cookie write */
+	int			si_applythreads;	/* delta changes applied at once */
+	int			si_applyrc;	/* first failed background apply */
+	int			si_napplying;
+	struct syncapply	*si_applying;	/* changes being applied */
+	ldap_pvt_thread_mutex_t	si_applymutex;
+	ldap_pvt_thread_cond_t	si_applycond;	/* a change finished */
 	int			si_got;
 	int			si_strict_refresh;	/* stop listening during fallback refresh */
 	int			si_too_old;
@@ -143,6 +154,10 @@ static int presentlist_free( Avlnode *av );
 static void syncrepl_del_nonpresent( Operation *, syncinfo_t *, BerVarray, struct sync_cookie *, int );
 static int syncrepl_message_to_op(
 					syncinfo_t *, Operation *, LDAPMessage * );
+static int syncrepl_apply_msg(
+					syncinfo_t *, Operation *, LDAPMessage **,
+					struct sync_cookie * );
+static int syncrepl_apply_drain( syncinfo_t * );
 static int syncrepl_message_to_entry(
 					syncinfo_t *, Operation *, LDAPMessage *,
 					Modifications **, Entry **, int, struct berval* );
@@ -809,6 +824,83 @@ compare_csns( struct sync_cookie *sc1, struct sync_cookie *sc2, int *which )
 
 #define	SYNC_PAUSED	-3
 
+/* A delta-sync change could not be applied; fall back to a full
+ * refresh to get back in sync.
+ */
+static int
+syncrepl_log_fallback( syncinfo_t *si )
+{
+	si->si_logstate = SYNCLOG_FALLBACK;
+	ldap_abandon_ext( si->si_ld, si->si_msgid, NULL, NULL );
+	if (si->si_strict_refresh) {
+		slap_suspend_listeners();
+		connections_drop();
+	}
+	return LDAP_SYNC_REFRESH_REQUIRED;
+}
+
+/* Wait for any delta-sync changes being applied in the background.
+ * If one of them failed, forget the cookie that covers it and fall back.
+ */
+static int
+syncrepl_apply_check( syncinfo_t *si, struct sync_cookie *pend, int *npend )
+{
+	if ( syncrepl_apply_drain( si ) == LDAP_SUCCESS )
+		return LDAP_SUCCESS;
+
+	slap_sync_cookie_free( pend, 0 );
+	*npend = 0;
+	Debug( LDAP_DEBUG_SYNC, "do_syncrep2: %s delta-sync lost sync, switching to REFRESH\n",
+		si->si_ridtxt, 0, 0 );
+	if ( !si->si_ld )
+		return LDAP_OTHER;
+	return syncrepl_log_fallback( si );
+}
+
+/* Commit the refresh changes batched into the current backend txn */
+static void
+syncrepl_txn_commit( syncinfo_t *si, Operation *op )
+{
+	if ( si->si_refreshCount ) {
+		LDAP_SLIST_REMOVE( &op->o_extra, si->si_refreshTxn, OpExtra, oe_next );
+		op->o_bd->bd_info->bi_op_txn( op, SLAP_TXN_COMMIT, &si->si_refreshTxn );
+		si->si_refreshCount = 0;
+		si->si_refreshTxn = NULL;
+	}
+}
+
+/* Write a cookie whose save was deferred, if any */
+static int
+syncrepl_save_cookie( syncinfo_t *si, Operation *op,
+	struct sync_cookie *pend, int *npend )
+{
+	int rc;
+
+	/* never claim a change that hasn't been committed */
+	rc = syncrepl_apply_drain( si );
+	if ( rc == LDAP_SUCCESS && pend->ctxcsn ) {
+		rc = syncrepl_updateCookie( si, op, pend, 0 );
+	}
+	slap_sync_cookie_free( pend, 0 );
+	*npend = 0;
+	return rc;
+}
+
+/* Note the cookie of a change that was just applied. It is written
+ * once every si_txnbatch changes, and when we run out of changes to
+ * apply, instead of after every single one.
+ */
+static int
+syncrepl_pend_cookie( syncinfo_t *si, Operation *op,
+	struct sync_cookie *sc, struct sync_cookie *pend, int *npend )
+{
+	slap_sync_cookie_free( pend, 0 );
+	slap_dup_sync_cookie( pend, sc );
+	if ( ++*npend < si->si_txnbatch )
+		return LDAP_SUCCESS;
+	return syncrepl_save_cookie( si, op, pend, npend );
+}
+
 static int
 do_syncrep2(
 	Operation *op,
@@ -821,9 +913,11 @@ do_syncrep2(
 
 	struct sync_cookie	syncCookie = { NULL };
 	struct sync_cookie	syncCookie_req = { NULL };
+	struct sync_cookie	syncCookie_pend = { NULL };
 
 	int		rc,
-			err = LDAP_SUCCESS;
+			err = LDAP_SUCCESS,
+			npend = 0;
 
 	Modifications	*modlist = NULL;
 
@@ -870,6 +964,12 @@ do_syncrep2(
 			rc = -2;
 			goto done;
 		}
+		/* everything before a result or sync info must be in place */
+		if ( ldap_msgtype( msg ) != LDAP_RES_SEARCH_ENTRY &&
+			( rc = syncrepl_apply_check( si, &syncCookie_pend, &npend )) !=
+			LDAP_SUCCESS ) {
+			goto done;
+		}
 		switch( ldap_msgtype( msg ) ) {
 		case LDAP_RES_SEARCH_ENTRY:
 			ldap_get_entry_controls( si->si_ld, msg, &rctrls );
@@ -1026,26 +1126,31 @@ do_syncrep2(
 			rc = 0;
 			if ( si->si_syncdata && si->si_logstate == SYNCLOG_LOGGING ) {
 				modlist = NULL;
-				if ( ( rc = syncrepl_message_to_op( si, op, msg ) ) == LDAP_SUCCESS &&
+				/* with applythreads, the failure may be that of an
+				 * earlier change still being applied in the background
+				 */
+				if ( ( rc = syncrepl_apply_msg( si, op, &msg, &syncCookie ) ) == LDAP_SUCCESS &&
 					syncCookie.ctxcsn )
 				{
-					rc = syncrepl_updateCookie( si, op, &syncCookie, 0 );
-				} else switch ( rc ) {
+					rc = syncrepl_pend_cookie( si, op, &syncCookie,
+						&syncCookie_pend, &npend );
+				}
+				if ( rc != LDAP_SUCCESS && si->si_applythreads > 1 ) {
+					/* the changes pended since the last cookie write
+					 * may not all have been applied */
+					slap_sync_cookie_free( &syncCookie_pend, 0 );
+					npend = 0;
+				}
+				switch ( rc ) {
 					case LDAP_ALREADY_EXISTS:
 					case LDAP_NO_SUCH_OBJECT:
 					case LDAP_NO_SUCH_ATTRIBUTE:
 					case LDAP_TYPE_OR_VALUE_EXISTS:
 					case LDAP_NOT_ALLOWED_ON_NONLEAF:
-						rc = LDAP_SYNC_REFRESH_REQUIRED;
-						si->si_logstate = SYNCLOG_FALLBACK;
-						ldap_abandon_ext( si->si_ld, si->si_msgid, NULL, NULL );
+						rc = syncrepl_log_fallback( si );
 						bdn.bv_val[bdn.bv_len] = '\0';
 						Debug( LDAP_DEBUG_SYNC, "do_syncrep2: %s delta-sync lost sync on (%s), switching to REFRESH\n",
 							si->si_ridtxt, bdn.bv_val, 0 );
-						if (si->si_strict_refresh) {
-							slap_suspend_listeners();
-							connections_drop();
-						}
 						break;
 					default:
 						break;
@@ -1057,22 +1162,33 @@ do_syncrep2(
 					syncstate, syncUUID, syncCookie.ctxcsn ) ) == LDAP_SUCCESS &&
 					syncCookie.ctxcsn )
 				{
-					rc = syncrepl_updateCookie( si, op, &syncCookie, 0 );
+					rc = syncrepl_pend_cookie( si, op, &syncCookie,
+						&syncCookie_pend, &npend );
 				}
 			}
 			if ( punlock >= 0 ) {
 				/* on failure, revert pending CSN */
 				if ( rc != LDAP_SUCCESS ) {
-					int i;
-					ldap_pvt_thread_mutex_lock( &si->si_cookieState->cs_mutex );
-					for ( i = 0; i<si->si_cookieState->cs_num; i++ ) {
-						if ( si->si_cookieState->cs_sids[i] == si->si_cookieState->cs_psids[punlock] ) {
-							ber_bvreplace( &si->si_cookieState->cs_pvals[punlock],
-								&si->si_cookieState->cs_vals[i] );
+					struct berval *csn = NULL;
+					int i, sid = si->si_cookieState->cs_psids[punlock];
+
+					/* changes pended in the current batch are applied
+					 * but not yet in cs_vals; revert to the last of them */
+					for ( i = 0; i<syncCookie_pend.numcsns; i++ ) {
+						if ( syncCookie_pend.sids[i] == sid ) {
+							csn = &syncCookie_pend.ctxcsn[i];
 							break;
 						}
 					}
-					if ( i == si->si_cookieState->cs_num )
+					ldap_pvt_thread_mutex_lock( &si->si_cookieState->cs_mutex );
+					for ( i = 0; !csn && i<si->si_cookieState->cs_num; i++ ) {
+						if ( si->si_cookieState->cs_sids[i] == sid ) {
+							csn = &si->si_cookieState->cs_vals[i];
+						}
+					}
+					if ( csn )
+						ber_bvreplace( &si->si_cookieState->cs_pvals[punlock], csn );
+					else
 						si->si_cookieState->cs_pvals[punlock].bv_val[0] = '\0';
 					ldap_pvt_thread_mutex_unlock( &si->si_cookieState->cs_mutex );
 				}
@@ -1201,16 +1317,12 @@ do_syncrep2(
 					si->si_presentlist = NULL;
 				}
 			}
+			syncrepl_save_cookie( si, op, &syncCookie_pend, &npend );
 			if ( syncCookie.ctxcsn && match < 0 && err == LDAP_SUCCESS )
 			{
 				rc = syncrepl_updateCookie( si, op, &syncCookie, 1 );
 			}
-			if ( si->si_refreshCount ) {
-				LDAP_SLIST_REMOVE( &op->o_extra, si->si_refreshTxn, OpExtra, oe_next );
-				op->o_bd->bd_info->bi_op_txn( op, SLAP_TXN_COMMIT, &si->si_refreshTxn );
-				si->si_refreshCount = 0;
-				si->si_refreshTxn = NULL;
-			}
+			syncrepl_txn_commit( si, op );
 			si->si_refreshEnd = slap_get_time();
 			if ( err == LDAP_SUCCESS
 				&& si->si_logstate == SYNCLOG_FALLBACK ) {
@@ -1294,12 +1406,8 @@ do_syncrep2(
 						si->si_refreshDone = 1;
 					}
 					if ( si->si_refreshDone ) {
-						if ( si->si_refreshCount ) {
-							LDAP_SLIST_REMOVE( &op->o_extra, si->si_refreshTxn, OpExtra, oe_next );
-							op->o_bd->bd_info->bi_op_txn( op, SLAP_TXN_COMMIT, &si->si_refreshTxn );
-							si->si_refreshCount = 0;
-							si->si_refreshTxn = NULL;
-						}
+						syncrepl_save_cookie( si, op, &syncCookie_pend, &npend );
+						syncrepl_txn_commit( si, op );
 						si->si_refreshEnd = slap_get_time();
 	Debug( LDAP_DEBUG_ANY, "do_syncrep1: %s finished refresh\n",
 		si->si_ridtxt, 0, 0 );
@@ -1432,14 +1540,14 @@ do_syncrep2(
 		ldap_msgfree( msg );
 		msg = NULL;
 		if ( ldap_pvt_thread_pool_pausing( &connection_pool )) {
+			if (( rc = syncrepl_apply_check( si, &syncCookie_pend, &npend )) !=
+				LDAP_SUCCESS ) {
+				goto done;
+			}
 			slap_sync_cookie_free( &syncCookie, 0 );
 			slap_sync_cookie_free( &syncCookie_req, 0 );
-			if ( si->si_refreshCount ) {
-				LDAP_SLIST_REMOVE( &op->o_extra, si->si_refreshTxn, OpExtra, oe_next );
-				op->o_bd->bd_info->bi_op_txn( op, SLAP_TXN_COMMIT, &si->si_refreshTxn );
-				si->si_refreshCount = 0;
-				si->si_refreshTxn = NULL;
-			}
+			syncrepl_save_cookie( si, op, &syncCookie_pend, &npend );
+			syncrepl_txn_commit( si, op );
 			return SYNC_PAUSED;
 		}
 	}
@@ -1460,6 +1568,15 @@ done:
 	slap_sync_cookie_free( &syncCookie, 0 );
 	slap_sync_cookie_free( &syncCookie_req, 0 );
 
+	/* a background change failed after its message was handled */
+	if ( syncrepl_apply_check( si, &syncCookie_pend, &npend ) != LDAP_SUCCESS &&
+		rc == LDAP_SUCCESS )
+		rc = LDAP_SYNC_REFRESH_REQUIRED;
+
+	/* whatever was applied stays applied, record it */
+	syncrepl_save_cookie( si, op, &syncCookie_pend, &npend );
+	syncrepl_txn_commit( si, op );
+
 	if ( msg ) ldap_msgfree( msg );
 
 	if ( rc && rc != LDAP_SYNC_REFRESH_REQUIRED && si->si_ld ) {
@@ -2434,7 +2551,9 @@ syncrepl_message_to_op(
 		} else if ( !ber_bvstrcasecmp( &bv,
 			&slap_schema.si_ad_entryCSN->ad_cname ) )
 		{
-			slap_queue_csn( op, bvals );
+			/* background changes had it queued in log order */
+			if ( BER_BVISNULL( &op->o_csn ))
+				slap_queue_csn( op, bvals );
 			do_graduate = 1;
 		}
 		ch_free( bvals );
@@ -2592,6 +2711,273 @@ done:
 	return rc;
 }
 
+/* Parallel apply of delta-sync changes.
+ *
+ * Adds, modifies and deletes name their target entry in the log record.
+ * Two such changes can't affect each other unless one target is the
+ * same as, or above or below, the other. Changes with no such conflict
+ * against anything in flight are handed to the thread pool. Anything
+ * else (modrdn, or a record we can't classify) waits for all changes
+ * in flight and is applied inline. Cookies are only written after
+ * draining, so a saved cookie never covers an uncommitted change.
+ * The change's CSN is queued before it is handed off, so CSNs are
+ * pending in log order and contextCSN never moves past a change
+ * that is still in flight.
+ */
+typedef struct syncapply {
+	struct syncapply	*sa_next;
+	syncinfo_t	*sa_si;
+	LDAPMessage	*sa_msg;
+	struct sync_cookie	sa_cookie;
+	struct berval	sa_ndn;		/* target of the change */
+	OperationBuffer	sa_opbuf;	/* the CSN is queued on this op */
+} syncapply;
+
+/* Get the target and CSN of an add, modify or delete log record */
+static int
+syncrepl_apply_target(
+	syncinfo_t	*si,
+	Operation	*op,
+	LDAPMessage	*msg,
+	struct berval	*target,
+	struct berval	*csn )
+{
+	BerElement	*ber = NULL;
+	logschema	*ls;
+	struct berval	bdn, bv, bv2, dn, ndn, *bvals = NULL;
+	ber_tag_t	tag = LBER_DEFAULT;
+	int		rc;
+
+	BER_BVZERO( target );
+	BER_BVZERO( csn );
+
+	if ( si->si_syncdata == SYNCDATA_ACCESSLOG )
+		ls = &accesslog_sc;
+	else
+		ls = &changelog_sc;
+
+	if ( ldap_get_dn_ber( si->si_ld, msg, &ber, &bdn ) != LDAP_SUCCESS )
+		return -1;
+
+	while (( rc = ldap_get_attribute_ber( si->si_ld, msg, ber, &bv, &bvals ) )
+		== LDAP_SUCCESS ) {
+		if ( bv.bv_val == NULL )
+			break;
+
+		if ( !ber_bvstrcasecmp( &bv, &ls->ls_dn ) ) {
+			bdn = bvals[0];
+			REWRITE_DN( si, bdn, bv2, dn, ndn );
+			if ( rc == LDAP_SUCCESS ) {
+				ch_free( target->bv_val );
+				ber_dupbv( target, &ndn );
+				slap_sl_free( ndn.bv_val, op->o_tmpmemctx );
+				slap_sl_free( dn.bv_val, op->o_tmpmemctx );
+			}
+		} else if ( !ber_bvstrcasecmp( &bv, &ls->ls_req ) ) {
+			int i = verb_to_mask( bvals[0].bv_val, modops );
+			if ( i >= 0 )
+				tag = modops[i].mask;
+		} else if ( !ber_bvstrcasecmp( &bv,
+			&slap_schema.si_ad_entryCSN->ad_cname ) )
+		{
+			ch_free( csn->bv_val );
+			ber_dupbv( csn, bvals );
+		}
+		ch_free( bvals );
+	}
+	ber_free( ber, 0 );
+
+	switch ( tag ) {
+	case LDAP_REQ_ADD:
+	case LDAP_REQ_MODIFY:
+	case LDAP_REQ_DELETE:
+		if ( !BER_BVISNULL( target ))
+			return 0;
+		break;
+	}
+	ch_free( target->bv_val );
+	BER_BVZERO( target );
+	ch_free( csn->bv_val );
+	BER_BVZERO( csn );
+	return -1;
+}
+
+/* Wait until fewer than max changes are in flight, and if a target
+ * is given, none of them conflicts with it. Called and returns with
+ * si_applymutex held.
+ */
+static void
+syncrepl_apply_wait( syncinfo_t *si, int max, struct berval *ndn )
+{
+	syncapply *sa;
+
+	for (;;) {
+		if ( si->si_napplying < max ) {
+			if ( !ndn )
+				break;
+			for ( sa = si->si_applying; sa; sa = sa->sa_next ) {
+				if ( dnIsSuffix( ndn, &sa->sa_ndn ) ||
+					dnIsSuffix( &sa->sa_ndn, ndn ))
+					break;
+			}
+			if ( !sa )
+				break;
+		}
+		/* Don't hold up a pause, the changes may not have started yet */
+		ldap_pvt_thread_pool_idle( &connection_pool );
+		ldap_pvt_thread_cond_wait( &si->si_applycond, &si->si_applymutex );
+		ldap_pvt_thread_pool_unidle( &connection_pool );
+	}
+}
+
+/* Wait for all changes in flight, return the first failure if any */
+static int
+syncrepl_apply_drain( syncinfo_t *si )
+{
+	int rc;
+
+	if ( si->si_applythreads < 2 )
+		return LDAP_SUCCESS;
+
+	ldap_pvt_thread_mutex_lock( &si->si_applymutex );
+	syncrepl_apply_wait( si, 1, NULL );
+	rc = si->si_applyrc;
+	si->si_applyrc = LDAP_SUCCESS;
+	ldap_pvt_thread_mutex_unlock( &si->si_applymutex );
+
+	return rc;
+}
+
+static void
+syncapply_free( syncapply *sa )
+{
+	slap_sync_cookie_free( &sa->sa_cookie, 0 );
+	ch_free( sa->sa_ndn.bv_val );
+	ch_free( sa );
+}
+
+static void *
+syncrepl_apply_task( void *ctx, void *arg )
+{
+	syncapply *sa = arg, **sp;
+	syncinfo_t *si = sa->sa_si;
+	Connection conn = {0};
+	Operation *op = &sa->sa_opbuf.ob_op;
+	struct berval csn = op->o_csn;
+	int rc;
+
+	connection_fake_init( &conn, &sa->sa_opbuf, ctx );
+	op->o_connid = SLAPD_SYNC_RID2SYNCCONN(si->si_rid);
+	op->o_managedsait = SLAP_CONTROL_NONCRITICAL;
+	op->o_bd = si->si_be;
+	op->o_dn = op->o_bd->be_rootdn;
+	op->o_ndn = op->o_bd->be_rootndn;
+	if ( !si->si_schemachecking )
+		op->o_no_schema_check = 1;
+	if ( sa->sa_cookie.ctxcsn )
+		op->o_controls[slap_cids.sc_LDAPsync] = &sa->sa_cookie;
+	if ( !BER_BVISNULL( &csn )) {
+		ber_dupbv_x( &op->o_csn, &csn, op->o_tmpmemctx );
+		ch_free( csn.bv_val );
+	}
+
+	rc = syncrepl_message_to_op( si, op, sa->sa_msg );
+	ldap_msgfree( sa->sa_msg );
+	/* in case it failed before getting to the CSN */
+	slap_graduate_commit_csn( op );
+	op->o_tmpfree( op->o_csn.bv_val, op->o_tmpmemctx );
+	BER_BVZERO( &op->o_csn );
+
+	ldap_pvt_thread_mutex_lock( &si->si_applymutex );
+	if ( rc != LDAP_SUCCESS && si->si_applyrc == LDAP_SUCCESS )
+		si->si_applyrc = rc;
+	for ( sp = &si->si_applying; *sp != sa; sp = &(*sp)->sa_next )
+		;
+	*sp = sa->sa_next;
+	si->si_napplying--;
+	ldap_pvt_thread_cond_signal( &si->si_applycond );
+	ldap_pvt_thread_mutex_unlock( &si->si_applymutex );
+
+	syncapply_free( sa );
+	return NULL;
+}
+
+/* Apply a delta-sync change, in the background if it is independent
+ * of everything in flight. Takes ownership of *msgp when it does.
+ * A failure may be that of an earlier background change.
+ */
+static int
+syncrepl_apply_msg(
+	syncinfo_t	*si,
+	Operation	*op,
+	LDAPMessage	**msgp,
+	struct sync_cookie	*sc )
+{
+	syncapply *sa, **sp;
+	Operation *aop;
+	struct berval ndn, csn;
+	int rc;
+
+	if ( si->si_applythreads < 2 )
+		return syncrepl_message_to_op( si, op, *msgp );
+
+	if ( syncrepl_apply_target( si, op, *msgp, &ndn, &csn )) {
+		rc = syncrepl_apply_drain( si );
+		if ( rc == LDAP_SUCCESS )
+			rc = syncrepl_message_to_op( si, op, *msgp );
+		return rc;
+	}
+
+	ldap_pvt_thread_mutex_lock( &si->si_applymutex );
+	syncrepl_apply_wait( si, si->si_applythreads, &ndn );
+	rc = si->si_applyrc;
+	if ( rc != LDAP_SUCCESS ) {
+		si->si_applyrc = LDAP_SUCCESS;
+		ldap_pvt_thread_mutex_unlock( &si->si_applymutex );
+		ch_free( ndn.bv_val );
+		ch_free( csn.bv_val );
+		return rc;
+	}
+	sa = ch_calloc( 1, sizeof( syncapply ));
+	sa->sa_si = si;
+	sa->sa_msg = *msgp;
+	sa->sa_ndn = ndn;
+	if ( sc->ctxcsn )
+		slap_dup_sync_cookie( &sa->sa_cookie, sc );
+	aop = &sa->sa_opbuf.ob_op;
+	if ( !BER_BVISNULL( &csn )) {
+		aop->o_hdr = &sa->sa_opbuf.ob_hdr;
+		aop->o_bd = si->si_be;
+		slap_queue_csn( aop, &csn );
+		ch_free( csn.bv_val );
+	}
+	sa->sa_next = si->si_applying;
+	si->si_applying = sa;
+	si->si_napplying++;
+	ldap_pvt_thread_mutex_unlock( &si->si_applymutex );
+
+	if ( ldap_pvt_thread_pool_submit( &connection_pool,
+		syncrepl_apply_task, sa ) == 0 ) {
+		*msgp = NULL;
+		return LDAP_SUCCESS;
+	}
+
+	/* Couldn't queue it, do it here */
+	ldap_pvt_thread_mutex_lock( &si->si_applymutex );
+	for ( sp = &si->si_applying; *sp != sa; sp = &(*sp)->sa_next )
+		;
+	*sp = sa->sa_next;
+	si->si_napplying--;
+	ldap_pvt_thread_mutex_unlock( &si->si_applymutex );
+	if ( !BER_BVISNULL( &aop->o_csn )) {
+		slap_graduate_commit_csn( aop );
+		ch_free( aop->o_csn.bv_val );
+	}
+	syncapply_free( sa );
+
+	return syncrepl_message_to_op( si, op, *msgp );
+}
+
 static int
 syncrepl_message_to_entry(
 	syncinfo_t	*si,
@@ -3076,13 +3462,10 @@ syncrepl_entry(
 	if ( !si->si_refreshDone ) {
 		if ( si->si_lazyCommit )
 			op->o_lazyCommit = SLAP_CONTROL_NONCRITICAL;
-		if ( si->si_refreshCount == 500 ) {
-			LDAP_SLIST_REMOVE( &op->o_extra, si->si_refreshTxn, OpExtra, oe_next );
-			op->o_bd->bd_info->bi_op_txn( op, SLAP_TXN_COMMIT, &si->si_refreshTxn );
-			si->si_refreshCount = 0;
-			si->si_refreshTxn = NULL;
+		if ( si->si_refreshCount >= si->si_txnbatch ) {
+			syncrepl_txn_commit( si, op );
 		}
-		if ( op->o_bd->bd_info->bi_op_txn ) {
+		if ( op->o_bd->bd_info->bi_op_txn && si->si_txnbatch > 1 ) {
 			if ( !si->si_refreshCount ) {
 				op->o_bd->bd_info->bi_op_txn( op, SLAP_TXN_BEGIN, &si->si_refreshTxn );
 			}
@@ -4675,6 +5058,8 @@ syncinfo_free( syncinfo_t *sie, int free_all )
 		}
 
 		ldap_pvt_thread_mutex_destroy( &sie->si_mutex );
+		ldap_pvt_thread_mutex_destroy( &sie->si_applymutex );
+		ldap_pvt_thread_cond_destroy( &sie->si_applycond );
 
 		bindconf_free( &sie->si_bindconf );
 
@@ -4845,6 +5230,8 @@ config_suffixm( ConfigArgs *c, syncinfo_t *si )
 #define SUFFIXMSTR		"suffixmassage"
 #define	STRICT_REFRESH	"strictrefresh"
 #define LAZY_COMMIT		"lazycommit"
+#define TXNBATCHSTR		"txnbatch"
+#define APPLYTHREADSSTR		"applythreads"
 
 /* FIXME: undocumented */
 #define EXATTRSSTR		"exattrs"
@@ -5351,6 +5738,28 @@ parse_syncrepl_line(
 					STRLENOF( LAZY_COMMIT ) ) )
 		{
 			si->si_lazyCommit = 1;
+		} else if ( !strncasecmp( c->argv[ i ], TXNBATCHSTR "=",
+					STRLENOF( TXNBATCHSTR "=" ) ) )
+		{
+			val = c->argv[ i ] + STRLENOF( TXNBATCHSTR "=" );
+			if ( lutil_atoi( &si->si_txnbatch, val ) != 0 || si->si_txnbatch < 1 ) {
+				snprintf( c->cr_msg, sizeof( c->cr_msg ),
+					"invalid txnbatch value \"%s\".\n",
+					val );
+				Debug( LDAP_DEBUG_ANY, "%s: %s.\n", c->log, c->cr_msg, 0 );
+				return 1;
+			}
+		} else if ( !strncasecmp( c->argv[ i ], APPLYTHREADSSTR "=",
+					STRLENOF( APPLYTHREADSSTR "=" ) ) )
+		{
+			val = c->argv[ i ] + STRLENOF( APPLYTHREADSSTR "=" );
+			if ( lutil_atoi( &si->si_applythreads, val ) != 0 || si->si_applythreads < 1 ) {
+				snprintf( c->cr_msg, sizeof( c->cr_msg ),
+					"invalid applythreads value \"%s\".\n",
+					val );
+				Debug( LDAP_DEBUG_ANY, "%s: %s.\n", c->log, c->cr_msg, 0 );
+				return 1;
+			}
 		} else if ( !bindconf_parse( c->argv[i], &si->si_bindconf ) ) {
 			si->si_got |= GOT_BINDCONF;
 		} else {
@@ -5471,10 +5880,14 @@ add_syncrepl(
 	si->si_manageDSAit = 0;
 	si->si_tlimit = 0;
 	si->si_slimit = 0;
+	si->si_txnbatch = SYNCREPL_TXNBATCH;
+	si->si_applythreads = 1;
 
 	si->si_presentlist = NULL;
 	LDAP_LIST_INIT( &si->si_nonpresentlist );
 	ldap_pvt_thread_mutex_init( &si->si_mutex );
+	ldap_pvt_thread_mutex_init( &si->si_applymutex );
+	ldap_pvt_thread_cond_init( &si->si_applycond );
 
 	rc = parse_syncrepl_line( c, si );
 
@@ -5766,6 +6179,18 @@ syncrepl_unparse( syncinfo_t *si, struct berval *bv )
 		ptr = lutil_strcopy( ptr, " " LAZY_COMMIT );
 	}
 
+	if ( si->si_txnbatch != SYNCREPL_TXNBATCH ) {
+		len = snprintf( ptr, WHATSLEFT, " " TXNBATCHSTR "=%d", si->si_txnbatch );
+		if ( WHATSLEFT <= len ) return;
+		ptr += len;
+	}
+
+	if ( si->si_applythreads > 1 ) {
+		len = snprintf( ptr, WHATSLEFT, " " APPLYTHREADSSTR "=%d", si->si_applythreads );
+		if ( WHATSLEFT <= len ) return;
+		ptr += len;
+	}
+
 	bc.bv_len = ptr - buf;
 	bc.bv_val = buf;
 	ber_dupbv( bv, &bc );
@@ -95,6 +95,7 @@ RCONF=$DATADIR/slapd-referrals.conf
 SRMASTERCONF=$DATADIR/slapd-syncrepl-master.conf
 DSRMASTERCONF=$DATADIR/slapd-deltasync-master.conf
 DSRSLAVECONF=$DATADIR/slapd-deltasync-slave.conf
+DSRPARSLAVECONF=$DATADIR/slapd-deltasync-parallel-slave.conf
 PPOLICYCONF=$DATADIR/slapd-ppolicy.conf
 PROXYCACHECONF=$DATADIR/slapd-proxycache.conf
 PROXYAUTHZCONF=$DATADIR/slapd-proxyauthz.conf
@@ -144,6 +145,8 @@ PASSWDCONF=$DATADIR/slapd-passwd.conf
 UNDOCONF=$DATADIR/slapd-config-undo.conf
 NAKEDCONF=$DATADIR/slapd-config-naked.conf
 VALREGEXCONF=$DATADIR/slapd-valregex.conf
+REWRITECONF1=$DATADIR/rewrite1.conf
+REWRITECONF2=$DATADIR/rewrite2.conf
 
 DYNAMICCONF=$DATADIR/slapd-dynamic.ldif
 
@@ -183,6 +186,7 @@ SLAPCAT="$TESTWD/../servers/slapd/slapd -Tc -d 0 $LDAP_VERBOSE"
 SLAPINDEX="$TESTWD/../servers/slapd/slapd -Ti -d 0 $LDAP_VERBOSE"
 SLAPMODIFY="$TESTWD/../servers/slapd/slapd -Tm -d 0 $LDAP_VERBOSE"
 SLAPPASSWD="$TESTWD/../servers/slapd/slapd -Tpasswd"
+REWRITE="$TESTWD/../libraries/librewrite/rewrite"
 
 unset DIFF_OPTIONS
 # NOTE: -u/-c is not that portable...
@@ -353,6 +357,7 @@ MTREADOUT=$TESTDIR/mtread.out
 # original outputs for cmp
 PROXYCACHEOUT=$DATADIR/proxycache.out
 REFERRALOUT=$DATADIR/referrals.out
+REWRITEOUT=$DATADIR/rewrite.out
 SEARCHOUTMASTER=$DATADIR/search.out.master
 SEARCHOUTX=$DATADIR/search.out.xsearch
 COMPSEARCHOUT=$DATADIR/compsearch.out